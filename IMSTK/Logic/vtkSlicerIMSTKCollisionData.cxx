@@ -0,0 +1,166 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKCollisionData.h"
+#include "vtkSlicerIMSTKFileCache.h"
+#include "vtkSlicerIMSTKGeometryCache.h"
+#include "vtkSlicerIMSTKMappedFile.h"
+
+// iMSTK includes
+#include <imstkImageData.h>
+#include <imstkSurfaceMesh.h>
+#include <imstkSurfaceMeshDistanceTransform.h>
+
+// STD includes
+#include <cstring>
+
+const char* vtkSlicerIMSTKCollisionData::SignedDistanceFieldName = "SignedDistanceField";
+
+namespace
+{
+//----------------------------------------------------------------------------
+const char SignedDistanceFieldMagic[8] = { 'I', 'M', 'S', 'T', 'K', 'S', 'D', 'F' };
+const std::uint32_t SignedDistanceFieldVersion = 1;
+
+//----------------------------------------------------------------------------
+struct FileHeader
+{
+  vtkSlicerIMSTKFileCache::FileHeader Common;
+  std::int32_t Dimensions[4];
+  double Spacing[3];
+  double Origin[3];
+};
+
+/// Fraction of the mesh size added around it in the distance field
+const double Padding = 0.1;
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKFileCache::Storage GetStorage()
+{
+  vtkSlicerIMSTKFileCache::Storage storage;
+  storage.Name = vtkSlicerIMSTKCollisionData::SignedDistanceFieldName;
+  storage.FileName = &vtkSlicerIMSTKCollisionData::GetSignedDistanceFieldFileName;
+  storage.Read = [](const std::string& fileName, std::uint64_t contentHash)
+  {
+    return std::shared_ptr<void>(vtkSlicerIMSTKCollisionData::ReadSignedDistanceField(fileName, contentHash));
+  };
+  storage.Write = [](const std::string& fileName, std::uint64_t contentHash, const std::shared_ptr<void>& data)
+  {
+    return vtkSlicerIMSTKCollisionData::WriteSignedDistanceField(fileName, contentHash,
+      *std::static_pointer_cast<imstk::ImageData>(data));
+  };
+  return storage;
+}
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<imstk::ImageData> vtkSlicerIMSTKCollisionData::Precompute(vtkSlicerIMSTKGeometryCache* cache,
+  const std::string& key, vtkPolyData* polyData, const std::string& directory)
+{
+  return std::static_pointer_cast<imstk::ImageData>(vtkSlicerIMSTKFileCache::Precompute(
+    cache, key, polyData, GetStorage(), directory,
+    [](std::shared_ptr<imstk::SurfaceMesh> mesh)
+    {
+      return mesh->getNumTriangles() > 0 ? std::shared_ptr<void>(ComputeSignedDistanceField(mesh)) : nullptr;
+    }));
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<imstk::ImageData> vtkSlicerIMSTKCollisionData::Find(vtkSlicerIMSTKGeometryCache* cache,
+  const std::string& key, const std::string& directory)
+{
+  return std::static_pointer_cast<imstk::ImageData>(vtkSlicerIMSTKFileCache::Find(cache, key, GetStorage(), directory));
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<imstk::ImageData> vtkSlicerIMSTKCollisionData::ComputeSignedDistanceField(std::shared_ptr<imstk::SurfaceMesh> mesh)
+{
+  imstk::Vec3d min, max;
+  mesh->computeBoundingBox(min, max);
+  const imstk::Vec3d padding = (max - min) * Padding;
+  min -= padding;
+  max += padding;
+  imstk::Vec6d bounds;
+  bounds << min[0], max[0], min[1], max[1], min[2], max[2];
+
+  auto distanceTransform = std::make_shared<imstk::SurfaceMeshDistanceTransform>();
+  distanceTransform->setInputMesh(mesh);
+  distanceTransform->setDimensions(Resolution, Resolution, Resolution);
+  distanceTransform->setBounds(bounds);
+  distanceTransform->update();
+  std::shared_ptr<imstk::ImageData> image = distanceTransform->getOutputImage();
+  if (!image)
+  {
+    return nullptr;
+  }
+  // Signed distance fields are sampled as doubles
+  return image->getScalarType() == IMSTK_DOUBLE ? image : image->cast(IMSTK_DOUBLE);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKCollisionData::WriteSignedDistanceField(const std::string& fileName,
+  std::uint64_t contentHash, const imstk::ImageData& image)
+{
+  FileHeader header = {};
+  header.Common = vtkSlicerIMSTKFileCache::MakeHeader(SignedDistanceFieldMagic, SignedDistanceFieldVersion,
+    sizeof(FileHeader), contentHash);
+  for (int i = 0; i < 3; i++)
+  {
+    header.Dimensions[i] = image.getDimensions()[i];
+    header.Spacing[i] = image.getSpacing()[i];
+    header.Origin[i] = image.getOrigin()[i];
+  }
+  const std::size_t numberOfValues = static_cast<std::size_t>(header.Dimensions[0]) * header.Dimensions[1] * header.Dimensions[2];
+  return vtkSlicerIMSTKFileCache::WriteFile(fileName, sizeof(FileHeader) + numberOfValues * sizeof(double),
+    [&header, &image, numberOfValues](char* data)
+    {
+      std::memcpy(data, &header, sizeof(header));
+      std::memcpy(data + sizeof(header), image.getScalarPointer(), numberOfValues * sizeof(double));
+    });
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<imstk::ImageData> vtkSlicerIMSTKCollisionData::ReadSignedDistanceField(
+  const std::string& fileName, std::uint64_t contentHash)
+{
+  vtkSlicerIMSTKMappedFile file;
+  if (!vtkSlicerIMSTKFileCache::OpenFile(file, fileName, vtkSlicerIMSTKFileCache::MakeHeader(
+    SignedDistanceFieldMagic, SignedDistanceFieldVersion, sizeof(FileHeader), contentHash)))
+  {
+    return nullptr;
+  }
+  FileHeader header;
+  std::memcpy(&header, file.GetData(), sizeof(header));
+  const std::size_t numberOfValues = static_cast<std::size_t>(header.Dimensions[0]) * header.Dimensions[1] * header.Dimensions[2];
+  if (file.GetSize() < sizeof(FileHeader) + numberOfValues * sizeof(double))
+  {
+    return nullptr;
+  }
+  auto image = std::make_shared<imstk::ImageData>();
+  image->allocate(IMSTK_DOUBLE, 1,
+    imstk::Vec3i(header.Dimensions[0], header.Dimensions[1], header.Dimensions[2]),
+    imstk::Vec3d(header.Spacing[0], header.Spacing[1], header.Spacing[2]),
+    imstk::Vec3d(header.Origin[0], header.Origin[1], header.Origin[2]));
+  std::memcpy(image->getScalarPointer(), file.GetData() + sizeof(header), numberOfValues * sizeof(double));
+  return image;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIMSTKCollisionData::GetSignedDistanceFieldFileName(const std::string& directory, std::uint64_t contentHash)
+{
+  return vtkSlicerIMSTKFileCache::GetFileName(directory, contentHash, ".sdf");
+}
@@ -0,0 +1,81 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKCollisionData_h
+#define __vtkSlicerIMSTKCollisionData_h
+
+// STD includes
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+class vtkPolyData;
+class vtkSlicerIMSTKGeometryCache;
+
+namespace imstk
+{
+  class ImageData;
+  class SurfaceMesh;
+}
+
+/// \brief Collision acceleration data of the model geometries, computed
+/// ahead of the simulations.
+///
+/// The signed distance field of a model is stored in memory and on disk by
+/// vtkSlicerIMSTKFileCache, in a file named after the content hash of the
+/// geometry.
+///
+/// File format (native byte order): FileHeader, then the distances as
+/// doubles, x fastest.
+///
+/// All methods are thread-safe.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKCollisionData
+{
+public:
+  /// Name of the derived data in the geometry cache
+  static const char* SignedDistanceFieldName;
+
+  /// Number of samples along each axis of the distance fields
+  static const int Resolution = 64;
+
+  /// Return the distance field of \a polyData, from memory, disk, or computed
+  /// (slow) and then stored in both. \a directory may be empty, in which
+  /// case nothing is read from or written to disk.
+  static std::shared_ptr<imstk::ImageData> Precompute(vtkSlicerIMSTKGeometryCache* cache,
+    const std::string& key, vtkPolyData* polyData, const std::string& directory);
+
+  /// Return the distance field of the geometry cached as \a key if it was
+  /// precomputed, from memory or disk, or null. Never computes it.
+  static std::shared_ptr<imstk::ImageData> Find(vtkSlicerIMSTKGeometryCache* cache,
+    const std::string& key, const std::string& directory);
+
+  static std::shared_ptr<imstk::ImageData> ComputeSignedDistanceField(std::shared_ptr<imstk::SurfaceMesh> mesh);
+
+  static bool WriteSignedDistanceField(const std::string& fileName, std::uint64_t contentHash,
+    const imstk::ImageData& image);
+
+  /// Return null if the file does not exist or was written for another content
+  static std::shared_ptr<imstk::ImageData> ReadSignedDistanceField(const std::string& fileName,
+    std::uint64_t contentHash);
+
+  /// File of the distance field of a geometry in \a directory
+  static std::string GetSignedDistanceFieldFileName(const std::string& directory, std::uint64_t contentHash);
+};
+
+#endif
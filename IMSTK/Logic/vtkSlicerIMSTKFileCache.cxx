@@ -0,0 +1,196 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKFileCache.h"
+#include "vtkSlicerIMSTKGeometryCache.h"
+#include "vtkSlicerIMSTKMappedFile.h"
+
+// VTK includes
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <process.h>
+# include <windows.h>
+#else
+# include <unistd.h>
+#endif
+
+namespace
+{
+//----------------------------------------------------------------------------
+/// Name of a temporary file next to \a fileName, unique to the calling
+/// process, thread and call
+std::string GetTemporaryFileName(const std::string& fileName)
+{
+  static std::atomic<unsigned long long> counter(0);
+#ifdef _WIN32
+  const long long processId = _getpid();
+#else
+  const long long processId = getpid();
+#endif
+  std::ostringstream name;
+  name << fileName << "." << processId << "." << std::hash<std::thread::id>()(std::this_thread::get_id())
+    << "." << counter.fetch_add(1) << ".tmp";
+  return name.str();
+}
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<void> vtkSlicerIMSTKFileCache::Find(vtkSlicerIMSTKGeometryCache* cache, const std::string& key,
+  const Storage& storage, const std::string& directory)
+{
+  std::shared_ptr<void> data = cache->GetDerivedData(key, storage.Name);
+  if (data && (!storage.Accept || storage.Accept(data)))
+  {
+    return data;
+  }
+  if (directory.empty())
+  {
+    return nullptr;
+  }
+  const std::uint64_t contentHash = cache->GetContentHash(key);
+  if (contentHash == 0)
+  {
+    return nullptr;
+  }
+  data = storage.Read(storage.FileName(directory, contentHash), contentHash);
+  if (!data || (storage.Accept && !storage.Accept(data)))
+  {
+    return nullptr;
+  }
+  cache->SetDerivedData(key, storage.Name, data);
+  return data;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<void> vtkSlicerIMSTKFileCache::Precompute(vtkSlicerIMSTKGeometryCache* cache, const std::string& key,
+  vtkPolyData* polyData, const Storage& storage, const std::string& directory,
+  const std::function<std::shared_ptr<void>(std::shared_ptr<imstk::SurfaceMesh>)>& compute)
+{
+  std::shared_ptr<imstk::SurfaceMesh> mesh = cache->GetSurfaceMesh(key, polyData);
+  if (!mesh)
+  {
+    return nullptr;
+  }
+  const std::uint64_t contentHash = cache->GetContentHash(key);
+  std::shared_ptr<void> data = Find(cache, key, storage, directory);
+  if (data)
+  {
+    return data;
+  }
+
+  data = compute(mesh);
+  if (!data)
+  {
+    return nullptr;
+  }
+  // The geometry may have changed during the computation
+  if (cache->GetContentHash(key) == contentHash)
+  {
+    cache->SetDerivedData(key, storage.Name, data);
+  }
+  if (!directory.empty())
+  {
+    vtksys::SystemTools::MakeDirectory(directory);
+    storage.Write(storage.FileName(directory, contentHash), contentHash, data);
+  }
+  return data;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIMSTKFileCache::GetFileName(const std::string& directory, std::uint64_t contentHash,
+  const std::string& suffix)
+{
+  std::ostringstream fileName;
+  fileName << directory << "/" << std::hex << contentHash << suffix;
+  return fileName.str();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKFileCache::FileHeader vtkSlicerIMSTKFileCache::MakeHeader(const char magic[8], std::uint32_t version,
+  std::size_t headerSize, std::uint64_t contentHash)
+{
+  FileHeader header = {};
+  std::memcpy(header.Magic, magic, sizeof(header.Magic));
+  header.Version = version;
+  header.HeaderSize = static_cast<std::uint32_t>(headerSize);
+  header.ContentHash = contentHash;
+  return header;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKFileCache::WriteFile(const std::string& fileName, std::size_t size,
+  const std::function<void(char* data)>& fill)
+{
+  // Written aside then renamed, readers never see a partial file. Writers
+  // of the same file, in this process or another one, each write their
+  // own temporary file, the last rename wins.
+  const std::string temporaryFileName = GetTemporaryFileName(fileName);
+  {
+    vtkSlicerIMSTKMappedFile file;
+    if (!file.Open(temporaryFileName, vtkSlicerIMSTKMappedFile::ReadWrite, size))
+    {
+      std::remove(temporaryFileName.c_str());
+      return false;
+    }
+    fill(file.GetData());
+  }
+#ifdef _WIN32
+  const bool renamed = MoveFileExA(temporaryFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  const bool renamed = std::rename(temporaryFileName.c_str(), fileName.c_str()) == 0;
+#endif
+  if (!renamed)
+  {
+    std::remove(temporaryFileName.c_str());
+  }
+  return renamed;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKFileCache::OpenFile(vtkSlicerIMSTKMappedFile& file, const std::string& fileName,
+  const FileHeader& header)
+{
+  if (!file.Open(fileName, vtkSlicerIMSTKMappedFile::ReadOnly)
+    || file.GetSize() < std::max<std::size_t>(sizeof(FileHeader), header.HeaderSize))
+  {
+    file.Close();
+    return false;
+  }
+  FileHeader fileHeader;
+  std::memcpy(&fileHeader, file.GetData(), sizeof(fileHeader));
+  if (std::memcmp(fileHeader.Magic, header.Magic, sizeof(header.Magic)) != 0
+    || fileHeader.Version != header.Version || fileHeader.HeaderSize != header.HeaderSize
+    || fileHeader.ContentHash != header.ContentHash)
+  {
+    file.Close();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,111 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKFileCache_h
+#define __vtkSlicerIMSTKFileCache_h
+
+// STD includes
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+class vtkPolyData;
+class vtkSlicerIMSTKGeometryCache;
+class vtkSlicerIMSTKMappedFile;
+
+namespace imstk
+{
+  class SurfaceMesh;
+}
+
+/// \brief Data derived from the geometries, kept in memory and on disk.
+///
+/// The data is stored as derived data of the vtkSlicerIMSTKGeometryCache
+/// entry of the geometry, so it is discarded when the geometry changes. It
+/// is also written to a directory, in a file named after the content hash of
+/// the geometry, and mapped back from there when the same geometry is seen
+/// again, even across sessions. Used by vtkSlicerIMSTKCollisionData and
+/// vtkSlicerIMSTKVolumeMesh.
+///
+/// Files start with a FileHeader and are written to a temporary file unique
+/// to each writer then renamed, so that readers never see a partial file,
+/// even when the same file is written by several threads or processes.
+///
+/// All methods are thread-safe.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKFileCache
+{
+public:
+  /// How one kind of derived data is named, read and written
+  struct Storage
+  {
+    /// Name of the derived data in the geometry cache
+    std::string Name;
+    /// File of the data of a geometry in a directory
+    std::function<std::string(const std::string& directory, std::uint64_t contentHash)> FileName;
+    /// Return null if the file does not exist or was written for another
+    /// content
+    std::function<std::shared_ptr<void>(const std::string& fileName, std::uint64_t contentHash)> Read;
+    std::function<bool(const std::string& fileName, std::uint64_t contentHash, const std::shared_ptr<void>& data)> Write;
+    /// Optional, return false if data found in memory or on disk cannot be
+    /// used, for instance because it was computed with other parameters
+    std::function<bool(const std::shared_ptr<void>& data)> Accept;
+  };
+
+  /// Common start of the files, in native byte order
+  struct FileHeader
+  {
+    char Magic[8];
+    std::uint32_t Version;
+    /// Size of the whole header of the file
+    std::uint32_t HeaderSize;
+    std::uint64_t ContentHash;
+  };
+
+  /// Return the data of the geometry cached as \a key if it was computed,
+  /// from memory or disk, or null. Never computes it. \a directory may be
+  /// empty, in which case nothing is read from disk.
+  static std::shared_ptr<void> Find(vtkSlicerIMSTKGeometryCache* cache, const std::string& key,
+    const Storage& storage, const std::string& directory);
+
+  /// Return the data of \a polyData, from memory, disk, or computed by
+  /// \a compute from the cached mesh and then stored in both. \a directory
+  /// may be empty, in which case nothing is read from or written to disk.
+  static std::shared_ptr<void> Precompute(vtkSlicerIMSTKGeometryCache* cache, const std::string& key,
+    vtkPolyData* polyData, const Storage& storage, const std::string& directory,
+    const std::function<std::shared_ptr<void>(std::shared_ptr<imstk::SurfaceMesh>)>& compute);
+
+  /// \a directory, then the content hash in hexadecimal and \a suffix
+  static std::string GetFileName(const std::string& directory, std::uint64_t contentHash, const std::string& suffix);
+
+  /// Header of a file of \a headerSize bytes of header
+  static FileHeader MakeHeader(const char magic[8], std::uint32_t version, std::size_t headerSize,
+    std::uint64_t contentHash);
+
+  /// Write \a size bytes, filled by \a fill, to \a fileName, replacing it
+  /// atomically
+  static bool WriteFile(const std::string& fileName, std::size_t size, const std::function<void(char* data)>& fill);
+
+  /// Map \a fileName for reading if it starts with the magic, version,
+  /// header size and content hash of \a header, and holds the whole header
+  static bool OpenFile(vtkSlicerIMSTKMappedFile& file, const std::string& fileName, const FileHeader& header);
+};
+
+#endif
@@ -0,0 +1,259 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKGeometryCache.h"
+#include "vtkSlicerIMSTKGeometryConversion.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// iMSTK includes
+#include <imstkSurfaceMesh.h>
+#include <imstkVecDataArray.h>
+
+// STD includes
+#include <algorithm>
+
+namespace
+{
+//----------------------------------------------------------------------------
+const std::uint64_t FNVOffsetBasis = 14695981039346656037ULL;
+const std::uint64_t FNVPrime = 1099511628211ULL;
+
+//----------------------------------------------------------------------------
+std::uint64_t HashBytes(std::uint64_t hash, const void* data, std::size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; i++)
+  {
+    hash = (hash ^ bytes[i]) * FNVPrime;
+  }
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+std::uint64_t HashArray(std::uint64_t hash, vtkDataArray* array)
+{
+  if (!array)
+  {
+    return hash;
+  }
+  const vtkIdType numberOfValues = array->GetNumberOfValues();
+  hash = HashBytes(hash, &numberOfValues, sizeof(numberOfValues));
+  return HashBytes(hash, array->GetVoidPointer(0),
+    static_cast<std::size_t>(numberOfValues) * array->GetDataTypeSize());
+}
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKGeometryCache::vtkSlicerIMSTKGeometryCache() = default;
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKGeometryCache::~vtkSlicerIMSTKGeometryCache() = default;
+
+//----------------------------------------------------------------------------
+std::shared_ptr<imstk::SurfaceMesh> vtkSlicerIMSTKGeometryCache::GetSurfaceMesh(const std::string& key, vtkPolyData* polyData)
+{
+  if (!polyData)
+  {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Update(key, polyData).Mesh;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<imstk::SurfaceMesh> vtkSlicerIMSTKGeometryCache::GetSurfaceMeshCopy(const std::string& key, vtkPolyData* polyData)
+{
+  if (!polyData)
+  {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return vtkSlicerIMSTKGeometryConversion::Copy(this->Update(key, polyData).Mesh);
+}
+
+//----------------------------------------------------------------------------
+std::uint64_t vtkSlicerIMSTKGeometryCache::GetContentHash(const std::string& key)
+{
+  // Hash a snapshot sharing the arrays of the entry without holding the
+  // lock, so that hashing large meshes does not block the other callers
+  vtkSmartPointer<vtkPolyData> snapshot;
+  vtkMTimeType pointsMTime = 0;
+  vtkMTimeType polysMTime = 0;
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    auto it = this->Entries.find(key);
+    if (it == this->Entries.end() || !it->second.Source)
+    {
+      return 0;
+    }
+    const Entry& entry = it->second;
+    if (entry.ContentHash != 0)
+    {
+      return entry.ContentHash;
+    }
+    snapshot = vtkSmartPointer<vtkPolyData>::New();
+    snapshot->ShallowCopy(entry.Source);
+    pointsMTime = entry.PointsMTime;
+    polysMTime = entry.PolysMTime;
+  }
+  const std::uint64_t hash = ComputeContentHash(snapshot);
+
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  auto it = this->Entries.find(key);
+  // The geometry may have changed meanwhile, the hash is then only returned
+  if (it != this->Entries.end() && it->second.Source
+    && it->second.PointsMTime == pointsMTime && it->second.PolysMTime == polysMTime)
+  {
+    it->second.ContentHash = hash;
+  }
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKGeometryCache::SetDerivedData(const std::string& key, const std::string& name, std::shared_ptr<void> data)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  auto it = this->Entries.find(key);
+  if (it != this->Entries.end())
+  {
+    it->second.DerivedData[name] = data;
+  }
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<void> vtkSlicerIMSTKGeometryCache::GetDerivedData(const std::string& key, const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  auto it = this->Entries.find(key);
+  if (it == this->Entries.end())
+  {
+    return nullptr;
+  }
+  auto derived = it->second.DerivedData.find(name);
+  return derived != it->second.DerivedData.end() ? derived->second : nullptr;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKGeometryCache::Remove(const std::string& key)
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Entries.erase(key);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKGeometryCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Entries.clear();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKGeometryCache::Statistics vtkSlicerIMSTKGeometryCache::GetStatistics()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Counters;
+}
+
+//----------------------------------------------------------------------------
+std::uint64_t vtkSlicerIMSTKGeometryCache::ComputeContentHash(vtkPolyData* polyData)
+{
+  std::uint64_t hash = FNVOffsetBasis;
+  if (!polyData)
+  {
+    return hash;
+  }
+  if (polyData->GetPoints())
+  {
+    hash = HashArray(hash, polyData->GetPoints()->GetData());
+  }
+  if (polyData->GetPolys())
+  {
+    hash = HashArray(hash, polyData->GetPolys()->GetOffsetsArray());
+    hash = HashArray(hash, polyData->GetPolys()->GetConnectivityArray());
+  }
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKGeometryCache::Entry& vtkSlicerIMSTKGeometryCache::Update(const std::string& key, vtkPolyData* polyData)
+{
+  Entry& entry = this->Entries[key];
+  vtkPoints* points = polyData->GetPoints();
+  vtkCellArray* polys = polyData->GetPolys();
+  const vtkMTimeType pointsMTime = points ? points->GetMTime() : 0;
+  const vtkMTimeType polysMTime = polys ? polys->GetMTime() : 0;
+  const bool samePolys = entry.Mesh && entry.PolysMTime == polysMTime;
+  if (samePolys && entry.PointsMTime == pointsMTime)
+  {
+    this->Counters.Hits++;
+    return entry;
+  }
+
+  // Adopted vertices can only be updated if the points array was modified
+  // in place. The source shares the points, compare with the mesh buffers
+  // rather than with it.
+  if (samePolys && points && static_cast<vtkIdType>(entry.Mesh->getNumVertices()) == points->GetNumberOfPoints()
+    && static_cast<vtkIdType>(entry.Mesh->getInitialVertexPositions()->size()) == points->GetNumberOfPoints()
+    && (!entry.Adopted || vtkSlicerIMSTKGeometryConversion::IsAdopted(entry.Mesh, polyData)))
+  {
+    // Only the point coordinates changed
+    UpdatePoints(entry, polyData);
+    this->Counters.PointUpdates++;
+  }
+  else
+  {
+    entry.Mesh = vtkSlicerIMSTKGeometryConversion::ToSurfaceMesh(polyData, true);
+    entry.Adopted = vtkSlicerIMSTKGeometryConversion::IsAdopted(entry.Mesh, polyData);
+    this->Counters.Conversions++;
+  }
+  if (!entry.Source)
+  {
+    entry.Source = vtkSmartPointer<vtkPolyData>::New();
+  }
+  entry.Source->ShallowCopy(polyData);
+  entry.PointsMTime = pointsMTime;
+  entry.PolysMTime = polysMTime;
+  entry.ContentHash = 0;
+  entry.DerivedData.clear();
+  return entry;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKGeometryCache::UpdatePoints(Entry& entry, vtkPolyData* polyData)
+{
+  vtkDataArray* points = polyData->GetPoints()->GetData();
+  std::shared_ptr<imstk::VecDataArray<double, 3>> initialVertices = entry.Mesh->getInitialVertexPositions();
+  std::shared_ptr<imstk::VecDataArray<double, 3>> vertices = entry.Mesh->getVertexPositions();
+  double* initial = initialVertices->getPointer()->data();
+  const vtkIdType numberOfPoints = points->GetNumberOfTuples();
+  if (!entry.Adopted)
+  {
+    for (vtkIdType i = 0; i < numberOfPoints; i++)
+    {
+      points->GetTuple(i, initial + 3 * i);
+    }
+  }
+  if (vertices != initialVertices)
+  {
+    std::copy(initial, initial + 3 * numberOfPoints, vertices->getPointer()->data());
+  }
+}
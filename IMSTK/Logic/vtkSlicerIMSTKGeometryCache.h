@@ -0,0 +1,131 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKGeometryCache_h
+#define __vtkSlicerIMSTKGeometryCache_h
+
+// VTK includes
+#include <vtkType.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+class vtkPolyData;
+
+namespace imstk
+{
+  class SurfaceMesh;
+}
+
+/// \brief Cache of MRML geometries converted to iMSTK.
+///
+/// Entries are identified by a key, typically the ID of the model node the
+/// polydata belongs to. A conversion is only performed when the points or
+/// the polygons changed since the last request: if only the point
+/// coordinates changed (same number of points, same polygons), the cached
+/// mesh is updated in place instead of being converted again.
+/// Changes are detected from the modification times of the points and
+/// polygons, so a shallow copy of a cached polydata is also a cache hit.
+///
+/// Cached meshes adopt the points of the polydata when they are doubles
+/// (see vtkSlicerIMSTKGeometryConversion), so in-place point updates cost
+/// no conversion at all.
+///
+/// Data derived from a geometry (e.g. collision acceleration structures) can
+/// be attached to its entry, it is discarded as soon as the geometry changes.
+///
+/// All methods are thread-safe.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKGeometryCache
+{
+public:
+  struct Statistics
+  {
+    /// Requests served from the cache without any conversion
+    std::uint64_t Hits = 0;
+    /// Requests where only point coordinates were updated
+    std::uint64_t PointUpdates = 0;
+    /// Requests that required a full conversion
+    std::uint64_t Conversions = 0;
+  };
+
+  vtkSlicerIMSTKGeometryCache();
+  ~vtkSlicerIMSTKGeometryCache();
+
+  /// Return the mesh converted from \a polyData, converting or updating it
+  /// only if needed. The returned mesh is shared by all the callers and
+  /// must not be modified, see GetSurfaceMeshCopy() for meshes used by a
+  /// simulation.
+  std::shared_ptr<imstk::SurfaceMesh> GetSurfaceMesh(const std::string& key, vtkPolyData* polyData);
+
+  /// Same as GetSurfaceMesh() but return an independent copy of the cached
+  /// mesh. Copying the vertex and index buffers is much cheaper than
+  /// converting from VTK.
+  std::shared_ptr<imstk::SurfaceMesh> GetSurfaceMeshCopy(const std::string& key, vtkPolyData* polyData);
+
+  /// Hash of the point coordinates and polygons of the cached geometry, computed
+  /// on first request without blocking the other methods. Returns 0 if \a key
+  /// is not in the cache.
+  std::uint64_t GetContentHash(const std::string& key);
+
+  /// Attach data derived from the geometry of \a key, under \a name.
+  /// Does nothing if \a key is not in the cache.
+  void SetDerivedData(const std::string& key, const std::string& name, std::shared_ptr<void> data);
+  /// Return the data attached under \a name, or nullptr if there is none or
+  /// if the geometry changed since it was attached.
+  std::shared_ptr<void> GetDerivedData(const std::string& key, const std::string& name);
+
+  void Remove(const std::string& key);
+  void Clear();
+
+  Statistics GetStatistics();
+
+  /// 64-bit FNV-1a hash of the point coordinates and polygons of \a polyData
+  static std::uint64_t ComputeContentHash(vtkPolyData* polyData);
+
+private:
+  struct Entry
+  {
+    /// Shallow copy of the converted polydata, sharing its arrays
+    vtkSmartPointer<vtkPolyData> Source;
+    vtkMTimeType PointsMTime = 0;
+    vtkMTimeType PolysMTime = 0;
+    std::shared_ptr<imstk::SurfaceMesh> Mesh;
+    /// True if the initial vertices of Mesh are the points of Source
+    bool Adopted = false;
+    std::uint64_t ContentHash = 0;
+    std::map<std::string, std::shared_ptr<void>> DerivedData;
+  };
+
+  Entry& Update(const std::string& key, vtkPolyData* polyData);
+  static void UpdatePoints(Entry& entry, vtkPolyData* polyData);
+
+  std::mutex Mutex;
+  std::map<std::string, Entry> Entries;
+  Statistics Counters;
+
+  vtkSlicerIMSTKGeometryCache(const vtkSlicerIMSTKGeometryCache&) = delete;
+  void operator=(const vtkSlicerIMSTKGeometryCache&) = delete;
+};
+
+#endif
@@ -0,0 +1,320 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKGeometryConversion.h"
+
+// iMSTK includes
+#include <imstkDataArray.h>
+#include <imstkGeometryUtilities.h>
+#include <imstkSurfaceMesh.h>
+#include <imstkVecDataArray.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+namespace
+{
+//----------------------------------------------------------------------------
+/// Values converted by each SMP task
+const vtkIdType Grain = 1 << 16;
+
+//----------------------------------------------------------------------------
+template <typename TInput, typename TOutput>
+void ConvertValues(const TInput* input, TOutput* output, vtkIdType numberOfValues)
+{
+  vtkSMPTools::For(0, numberOfValues, Grain,
+    [input, output](vtkIdType begin, vtkIdType end)
+    {
+      const TInput* VTK_RESTRICT in = input + begin;
+      TOutput* VTK_RESTRICT out = output + begin;
+      const vtkIdType count = end - begin;
+      for (vtkIdType i = 0; i < count; i++)
+      {
+        out[i] = static_cast<TOutput>(in[i]);
+      }
+    });
+}
+
+//----------------------------------------------------------------------------
+/// Copy \a array into a new iMSTK array, or return null if the number of
+/// components does not match.
+template <typename T, int N>
+std::shared_ptr<imstk::VecDataArray<T, N>> ConvertArray(vtkDataArray* array)
+{
+  if (!array || array->GetNumberOfComponents() != N)
+  {
+    return nullptr;
+  }
+  const vtkIdType numberOfTuples = array->GetNumberOfTuples();
+  auto result = std::make_shared<imstk::VecDataArray<T, N>>(static_cast<int>(numberOfTuples));
+  T* output = result->getPointer()->data();
+  switch (array->GetDataType())
+  {
+    case VTK_FLOAT:
+      ConvertValues(static_cast<const float*>(array->GetVoidPointer(0)), output, numberOfTuples * N);
+      break;
+    case VTK_DOUBLE:
+      ConvertValues(static_cast<const double*>(array->GetVoidPointer(0)), output, numberOfTuples * N);
+      break;
+    default:
+      vtkSMPTools::For(0, numberOfTuples, Grain / N,
+        [array, output](vtkIdType begin, vtkIdType end)
+        {
+          for (vtkIdType i = begin; i < end; i++)
+          {
+            for (int c = 0; c < N; c++)
+            {
+              output[i * N + c] = static_cast<T>(array->GetComponent(i, c));
+            }
+          }
+        });
+      break;
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------
+/// Wrap the memory of \a array, which must hold \a numberOfTuples tuples
+/// of N values of type T. The iMSTK array keeps \a array alive.
+template <typename T, int N>
+std::shared_ptr<imstk::VecDataArray<T, N>> AdoptArray(vtkDataArray* array, vtkIdType numberOfTuples)
+{
+  vtkSmartPointer<vtkDataArray> keepAlive = array;
+  std::shared_ptr<imstk::VecDataArray<T, N>> result(new imstk::VecDataArray<T, N>(),
+    [keepAlive](imstk::VecDataArray<T, N>* adopted) { delete adopted; });
+  result->setData(static_cast<typename imstk::VecDataArray<T, N>::VecType*>(array->GetVoidPointer(0)),
+    static_cast<int>(numberOfTuples));
+  return result;
+}
+
+//----------------------------------------------------------------------------
+/// Return true if all the cells described by \a offsets are triangles
+template <typename TOffset>
+bool AreTriangles(const TOffset* offsets, vtkIdType numberOfCells)
+{
+  for (vtkIdType i = 0; i <= numberOfCells; i++)
+  {
+    if (offsets[i] != static_cast<TOffset>(3 * i))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+/// Convert \a array to a VTK array named \a name
+template <typename TOutput, typename TArray, typename T, int N>
+vtkSmartPointer<TArray> ToVTKArray(const imstk::VecDataArray<T, N>& array, const char* name)
+{
+  vtkSmartPointer<TArray> result = vtkSmartPointer<TArray>::New();
+  result->SetName(name);
+  result->SetNumberOfComponents(N);
+  result->SetNumberOfTuples(array.size());
+  ConvertValues(array.getPointer()->data(), static_cast<TOutput*>(result->GetPointer(0)),
+    static_cast<vtkIdType>(array.size()) * N);
+  return result;
+}
+
+//----------------------------------------------------------------------------
+/// Set a copy of \a array as the vertex attribute \a name of \a mesh if it
+/// is a TArray. Return false otherwise.
+template <typename TArray>
+bool CopyVertexAttribute(imstk::SurfaceMesh& mesh, const std::string& name,
+  const std::shared_ptr<imstk::AbstractDataArray>& array)
+{
+  std::shared_ptr<TArray> typedArray = std::dynamic_pointer_cast<TArray>(array);
+  if (!typedArray)
+  {
+    return false;
+  }
+  mesh.setVertexAttribute(name, std::make_shared<TArray>(*typedArray));
+  return true;
+}
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<imstk::SurfaceMesh> vtkSlicerIMSTKGeometryConversion::ToSurfaceMesh(vtkPolyData* polyData, bool adopt)
+{
+  if (!polyData || !polyData->GetPoints())
+  {
+    return nullptr;
+  }
+  vtkCellArray* polys = polyData->GetPolys();
+  const vtkIdType numberOfTriangles = polys ? polys->GetNumberOfCells() : 0;
+  const bool storage64Bit = polys && polys->IsStorage64Bit();
+  const bool triangles = polys && polyData->GetNumberOfStrips() == 0
+    && (storage64Bit
+      ? AreTriangles(polys->GetOffsetsArray64()->GetPointer(0), numberOfTriangles)
+      : AreTriangles(polys->GetOffsetsArray32()->GetPointer(0), numberOfTriangles));
+  if (!triangles)
+  {
+    return imstk::GeometryUtils::copyToSurfaceMesh(polyData);
+  }
+
+  vtkDataArray* points = polyData->GetPoints()->GetData();
+  std::shared_ptr<imstk::VecDataArray<double, 3>> vertices = adopt && points->GetDataType() == VTK_DOUBLE
+    ? AdoptArray<double, 3>(points, points->GetNumberOfTuples())
+    : ConvertArray<double, 3>(points);
+
+  std::shared_ptr<imstk::VecDataArray<int, 3>> indices;
+  if (adopt && !storage64Bit)
+  {
+    indices = AdoptArray<int, 3>(polys->GetConnectivityArray32(), numberOfTriangles);
+  }
+  else
+  {
+    indices = std::make_shared<imstk::VecDataArray<int, 3>>(static_cast<int>(numberOfTriangles));
+    int* output = indices->getPointer()->data();
+    if (storage64Bit)
+    {
+      ConvertValues(polys->GetConnectivityArray64()->GetPointer(0), output, 3 * numberOfTriangles);
+    }
+    else
+    {
+      ConvertValues(polys->GetConnectivityArray32()->GetPointer(0), output, 3 * numberOfTriangles);
+    }
+  }
+
+  auto mesh = std::make_shared<imstk::SurfaceMesh>();
+  mesh->initialize(vertices, indices);
+
+  vtkPointData* pointData = polyData->GetPointData();
+  if (auto normals = ConvertArray<double, 3>(pointData->GetNormals()))
+  {
+    const char* name = pointData->GetNormals()->GetName() ? pointData->GetNormals()->GetName() : "Normals";
+    mesh->setVertexAttribute(name, normals);
+    mesh->setVertexNormals(name);
+  }
+  if (auto tcoords = ConvertArray<float, 2>(pointData->GetTCoords()))
+  {
+    const char* name = pointData->GetTCoords()->GetName() ? pointData->GetTCoords()->GetName() : "TCoords";
+    mesh->setVertexAttribute(name, tcoords);
+    mesh->setVertexTCoords(name);
+  }
+  return mesh;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkSlicerIMSTKGeometryConversion::ToPolyData(std::shared_ptr<imstk::SurfaceMesh> mesh)
+{
+  if (!mesh || !mesh->getVertexPositions() || !mesh->getTriangleIndices())
+  {
+    return nullptr;
+  }
+  vtkNew<vtkPoints> points;
+  points->SetData(ToVTKArray<double, vtkDoubleArray>(*mesh->getVertexPositions(), "Points"));
+
+  const imstk::VecDataArray<int, 3>& indices = *mesh->getTriangleIndices();
+  const vtkIdType numberOfTriangles = indices.size();
+  vtkNew<vtkTypeInt32Array> connectivity;
+  connectivity->SetNumberOfValues(3 * numberOfTriangles);
+  ConvertValues(indices.getPointer()->data(), connectivity->GetPointer(0), 3 * numberOfTriangles);
+  vtkNew<vtkTypeInt32Array> offsets;
+  offsets->SetNumberOfValues(numberOfTriangles + 1);
+  vtkTypeInt32* offsetValues = offsets->GetPointer(0);
+  vtkSMPTools::For(0, numberOfTriangles + 1, Grain,
+    [offsetValues](vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType i = begin; i < end; i++)
+      {
+        offsetValues[i] = static_cast<vtkTypeInt32>(3 * i);
+      }
+    });
+  vtkNew<vtkCellArray> polys;
+  polys->SetData(offsets, connectivity);
+
+  vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+  polyData->SetPoints(points);
+  polyData->SetPolys(polys);
+  if (std::shared_ptr<imstk::VecDataArray<double, 3>> normals = mesh->getVertexNormals())
+  {
+    polyData->GetPointData()->SetNormals(ToVTKArray<float, vtkFloatArray>(*normals, "Normals"));
+  }
+  if (std::shared_ptr<imstk::VecDataArray<float, 2>> tcoords = mesh->getVertexTCoords())
+  {
+    polyData->GetPointData()->SetTCoords(ToVTKArray<float, vtkFloatArray>(*tcoords, "TCoords"));
+  }
+  return polyData;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<imstk::SurfaceMesh> vtkSlicerIMSTKGeometryConversion::Copy(std::shared_ptr<imstk::SurfaceMesh> mesh)
+{
+  if (!mesh)
+  {
+    return nullptr;
+  }
+  auto copy = std::make_shared<imstk::SurfaceMesh>();
+  copy->initialize(
+    std::make_shared<imstk::VecDataArray<double, 3>>(*mesh->getInitialVertexPositions()),
+    std::make_shared<imstk::VecDataArray<int, 3>>(*mesh->getTriangleIndices()));
+
+  // Vertex attributes, as converted by imstk::GeometryUtils. VecDataArray
+  // derives from DataArray so the vector types are tried first.
+  for (const auto& attribute : mesh->getVertexAttributes())
+  {
+    const std::string& name = attribute.first;
+    const std::shared_ptr<imstk::AbstractDataArray>& array = attribute.second;
+    const bool copied = CopyVertexAttribute<imstk::VecDataArray<double, 3>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::VecDataArray<float, 3>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::VecDataArray<double, 2>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::VecDataArray<float, 2>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::VecDataArray<double, 4>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::VecDataArray<float, 4>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::VecDataArray<int, 3>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::DataArray<double>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::DataArray<float>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::DataArray<int>>(*copy, name, array)
+      || CopyVertexAttribute<imstk::DataArray<unsigned char>>(*copy, name, array);
+    if (!copied)
+    {
+      // Unknown array type, share it rather than dropping it
+      copy->setVertexAttribute(name, array);
+    }
+  }
+  if (!mesh->getActiveVertexNormals().empty())
+  {
+    copy->setVertexNormals(mesh->getActiveVertexNormals());
+  }
+  if (!mesh->getActiveVertexTangents().empty())
+  {
+    copy->setVertexTangents(mesh->getActiveVertexTangents());
+  }
+  if (!mesh->getActiveVertexTCoords().empty())
+  {
+    copy->setVertexTCoords(mesh->getActiveVertexTCoords());
+  }
+  return copy;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKGeometryConversion::IsAdopted(std::shared_ptr<imstk::SurfaceMesh> mesh, vtkPolyData* polyData)
+{
+  return mesh && mesh->getInitialVertexPositions() && polyData && polyData->GetPoints()
+    && static_cast<const void*>(mesh->getInitialVertexPositions()->getPointer())
+      == polyData->GetPoints()->GetData()->GetVoidPointer(0);
+}
@@ -0,0 +1,70 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKGeometryConversion_h
+#define __vtkSlicerIMSTKGeometryConversion_h
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <memory>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+class vtkPolyData;
+
+namespace imstk
+{
+  class SurfaceMesh;
+}
+
+/// \brief Conversion of triangle meshes between VTK and iMSTK.
+///
+/// Replacement for imstk::GeometryUtils::copyToSurfaceMesh() and
+/// copyToVtkPolyData() for large meshes: points, triangles, normals and
+/// texture coordinates are converted in parallel with vtkSMPTools, in tight
+/// loops the compiler vectorizes.
+///
+/// Meshes with polygons other than triangles are converted by
+/// imstk::GeometryUtils.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKGeometryConversion
+{
+public:
+  /// Convert \a polyData to an iMSTK surface mesh.
+  /// If \a adopt is true, the initial vertices of the mesh reference the
+  /// VTK points instead of a copy when they are doubles, and so do the
+  /// triangles when the cells use 32 bits storage. The adopted VTK arrays
+  /// are kept alive by the mesh, and must not be modified while it is in use.
+  static std::shared_ptr<imstk::SurfaceMesh> ToSurfaceMesh(vtkPolyData* polyData, bool adopt = false);
+
+  /// Convert \a mesh to a VTK polydata, with 32 bits cell storage so that
+  /// the triangles are copied as they are.
+  static vtkSmartPointer<vtkPolyData> ToPolyData(std::shared_ptr<imstk::SurfaceMesh> mesh);
+
+  /// Return a mesh with copies of the initial vertices, triangles and vertex
+  /// attributes of \a mesh, with the same active normals, tangents and
+  /// texture coordinates. Copying these buffers is much cheaper than
+  /// converting from VTK.
+  static std::shared_ptr<imstk::SurfaceMesh> Copy(std::shared_ptr<imstk::SurfaceMesh> mesh);
+
+  /// Return true if the initial vertices of \a mesh reference the points of
+  /// \a polyData, see ToSurfaceMesh()
+  static bool IsAdopted(std::shared_ptr<imstk::SurfaceMesh> mesh, vtkPolyData* polyData);
+};
+
+#endif
@@ -0,0 +1,203 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKLevelOfDetail.h"
+#include "vtkSlicerIMSTKGeometryCache.h"
+#include "vtkSlicerIMSTKGeometryConversion.h"
+
+// iMSTK includes
+#include <imstkSurfaceMesh.h>
+#include <imstkVecDataArray.h>
+
+// VTK includes
+#include <vtkGenericCell.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkSMPThreadLocalObject.h>
+#include <vtkSMPTools.h>
+#include <vtkStaticCellLocator.h>
+#include <vtkTriangleFilter.h>
+
+namespace
+{
+//----------------------------------------------------------------------------
+/// Barycentric coordinates of \a point, which lies in the plane of the
+/// triangle (\a v0, \a v1, \a v2)
+void ComputeWeights(const imstk::Vec3d& point, const imstk::Vec3d& v0, const imstk::Vec3d& v1,
+  const imstk::Vec3d& v2, double* weights)
+{
+  const imstk::Vec3d e0 = v1 - v0;
+  const imstk::Vec3d e1 = v2 - v0;
+  const imstk::Vec3d p = point - v0;
+  const double d00 = e0.dot(e0);
+  const double d01 = e0.dot(e1);
+  const double d11 = e1.dot(e1);
+  const double denominator = d00 * d11 - d01 * d01;
+  if (denominator <= 0.0)
+  {
+    // Degenerate triangle
+    weights[0] = weights[1] = weights[2] = 1.0 / 3.0;
+    return;
+  }
+  const double d20 = p.dot(e0);
+  const double d21 = p.dot(e1);
+  weights[1] = (d11 * d20 - d01 * d21) / denominator;
+  weights[2] = (d00 * d21 - d01 * d20) / denominator;
+  weights[0] = 1.0 - weights[1] - weights[2];
+}
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLevelOfDetail::Level::Apply(const imstk::VecDataArray<double, 3>& vertices,
+  const imstk::VecDataArray<int, 3>& triangles, double* output) const
+{
+  const imstk::Vec3d* decimatedVertices = vertices.getPointer();
+  const imstk::Vec3i* decimatedTriangles = triangles.getPointer();
+  const int* triangleIds = this->Triangles.data();
+  const double* weights = this->Weights.data();
+  const double* offsets = this->Offsets.data();
+  vtkSMPTools::For(0, this->GetNumberOfPoints(),
+    [=](vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType i = begin; i < end; i++)
+      {
+        const imstk::Vec3i& triangle = decimatedTriangles[triangleIds[i]];
+        const imstk::Vec3d& v0 = decimatedVertices[triangle[0]];
+        const imstk::Vec3d& v1 = decimatedVertices[triangle[1]];
+        const imstk::Vec3d& v2 = decimatedVertices[triangle[2]];
+        const double* w = weights + 3 * i;
+        imstk::Vec3d point = w[0] * v0 + w[1] * v1 + w[2] * v2;
+        const imstk::Vec3d normal = (v1 - v0).cross(v2 - v0);
+        const double norm = normal.norm();
+        if (norm > 0.0)
+        {
+          point += (offsets[i] / norm) * normal;
+        }
+        output[3 * i] = point[0];
+        output[3 * i + 1] = point[1];
+        output[3 * i + 2] = point[2];
+      }
+    });
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<const vtkSlicerIMSTKLevelOfDetail::Level> vtkSlicerIMSTKLevelOfDetail::Get(
+  vtkSlicerIMSTKGeometryCache* cache, const std::string& key, vtkPolyData* polyData, int numberOfTriangles)
+{
+  std::shared_ptr<imstk::SurfaceMesh> mesh = cache->GetSurfaceMesh(key, polyData);
+  if (!mesh || mesh->getNumTriangles() <= numberOfTriangles)
+  {
+    return nullptr;
+  }
+  const std::string name = GetDerivedDataName(numberOfTriangles);
+  std::shared_ptr<const Level> level = std::static_pointer_cast<const Level>(cache->GetDerivedData(key, name));
+  if (level)
+  {
+    return level;
+  }
+  const std::uint64_t contentHash = cache->GetContentHash(key);
+  std::shared_ptr<Level> computed = Compute(polyData, numberOfTriangles);
+  // The geometry may have changed during the computation
+  if (computed && cache->GetContentHash(key) == contentHash)
+  {
+    cache->SetDerivedData(key, name, computed);
+  }
+  return computed;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<vtkSlicerIMSTKLevelOfDetail::Level> vtkSlicerIMSTKLevelOfDetail::Compute(vtkPolyData* polyData, int numberOfTriangles)
+{
+  if (!polyData || !polyData->GetPoints() || numberOfTriangles <= 0)
+  {
+    return nullptr;
+  }
+  // Point IDs are kept, only the polygons are triangulated
+  vtkNew<vtkTriangleFilter> triangulate;
+  triangulate->SetInputData(polyData);
+  triangulate->PassVertsOff();
+  triangulate->PassLinesOff();
+  triangulate->Update();
+  const vtkIdType inputTriangles = triangulate->GetOutput()->GetNumberOfPolys();
+  if (inputTriangles <= numberOfTriangles)
+  {
+    return nullptr;
+  }
+
+  vtkNew<vtkQuadricDecimation> decimation;
+  decimation->SetInputConnection(triangulate->GetOutputPort());
+  decimation->SetTargetReduction(1.0 - static_cast<double>(numberOfTriangles) / inputTriangles);
+  decimation->VolumePreservationOn();
+  decimation->Update();
+  vtkPolyData* decimated = decimation->GetOutput();
+
+  // The decimation only outputs triangles, so cell IDs are triangle IDs
+  auto level = std::make_shared<Level>();
+  level->Mesh = vtkSlicerIMSTKGeometryConversion::ToSurfaceMesh(decimated);
+  if (!level->Mesh || level->Mesh->getNumTriangles() == 0)
+  {
+    return nullptr;
+  }
+
+  vtkNew<vtkStaticCellLocator> locator;
+  locator->SetDataSet(decimated);
+  locator->BuildLocator();
+
+  const vtkIdType numberOfPoints = polyData->GetNumberOfPoints();
+  level->Triangles.resize(numberOfPoints);
+  level->Weights.resize(3 * numberOfPoints);
+  level->Offsets.resize(numberOfPoints);
+  const imstk::Vec3d* vertices = level->Mesh->getInitialVertexPositions()->getPointer();
+  const imstk::Vec3i* triangles = level->Mesh->getTriangleIndices()->getPointer();
+  vtkPoints* points = polyData->GetPoints();
+  vtkSMPThreadLocalObject<vtkGenericCell> cells;
+  Level* output = level.get();
+  vtkSMPTools::For(0, numberOfPoints,
+    [&](vtkIdType begin, vtkIdType end)
+    {
+      vtkGenericCell* cell = cells.Local();
+      for (vtkIdType i = begin; i < end; i++)
+      {
+        double point[3], closest[3], distance2;
+        vtkIdType cellId;
+        int subId;
+        points->GetPoint(i, point);
+        locator->FindClosestPoint(point, closest, cell, cellId, subId, distance2);
+
+        const imstk::Vec3i& triangle = triangles[cellId];
+        const imstk::Vec3d& v0 = vertices[triangle[0]];
+        const imstk::Vec3d& v1 = vertices[triangle[1]];
+        const imstk::Vec3d& v2 = vertices[triangle[2]];
+        const imstk::Vec3d projection(closest[0], closest[1], closest[2]);
+        output->Triangles[i] = static_cast<int>(cellId);
+        ComputeWeights(projection, v0, v1, v2, &output->Weights[3 * i]);
+        const imstk::Vec3d normal = (v1 - v0).cross(v2 - v0);
+        const double norm = normal.norm();
+        output->Offsets[i] = norm > 0.0
+          ? (imstk::Vec3d(point[0], point[1], point[2]) - projection).dot(normal) / norm : 0.0;
+      }
+    });
+  return level;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIMSTKLevelOfDetail::GetDerivedDataName(int numberOfTriangles)
+{
+  return "LevelOfDetail" + std::to_string(numberOfTriangles);
+}
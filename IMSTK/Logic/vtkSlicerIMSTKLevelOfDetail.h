@@ -0,0 +1,86 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKLevelOfDetail_h
+#define __vtkSlicerIMSTKLevelOfDetail_h
+
+// STD includes
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+class vtkPolyData;
+class vtkSlicerIMSTKGeometryCache;
+
+namespace imstk
+{
+  class SurfaceMesh;
+  template<typename T, int N> class VecDataArray;
+}
+
+/// \brief Decimated meshes for collision and physics, with the map carrying
+/// their motion back to the full resolution model.
+///
+/// Each vertex of the full resolution mesh is attached to its closest
+/// triangle of the decimated mesh, by the barycentric coordinates of its
+/// projection and its signed distance along the triangle normal. Moving the
+/// decimated vertices and applying the map moves the full resolution
+/// vertices with the surface, including its details.
+///
+/// Levels are stored as derived data of the vtkSlicerIMSTKGeometryCache
+/// entry of the model, so they are computed once per geometry and target.
+///
+/// All methods are thread-safe.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKLevelOfDetail
+{
+public:
+  struct Level
+  {
+    /// Decimated mesh, shared by all the users: it must be copied before
+    /// being simulated or transformed.
+    std::shared_ptr<imstk::SurfaceMesh> Mesh;
+    /// Per full resolution vertex: closest decimated triangle, barycentric
+    /// coordinates in it (3 values) and offset along its normal
+    std::vector<int> Triangles;
+    std::vector<double> Weights;
+    std::vector<double> Offsets;
+
+    int GetNumberOfPoints() const { return static_cast<int>(this->Triangles.size()); }
+
+    /// Compute the full resolution vertices from the decimated \a vertices
+    /// and \a triangles, which must have the topology of Mesh. \a output
+    /// holds GetNumberOfPoints() points.
+    void Apply(const imstk::VecDataArray<double, 3>& vertices,
+      const imstk::VecDataArray<int, 3>& triangles, double* output) const;
+  };
+
+  /// Return the level of \a polyData with at most about \a numberOfTriangles
+  /// triangles, from the cache or computed (slow) and then cached.
+  /// Returns null if \a polyData does not have more triangles than that.
+  static std::shared_ptr<const Level> Get(vtkSlicerIMSTKGeometryCache* cache,
+    const std::string& key, vtkPolyData* polyData, int numberOfTriangles);
+
+  /// Same as Get() without any cache
+  static std::shared_ptr<Level> Compute(vtkPolyData* polyData, int numberOfTriangles);
+
+  /// Name of the derived data in the geometry cache
+  static std::string GetDerivedDataName(int numberOfTriangles);
+};
+
+#endif
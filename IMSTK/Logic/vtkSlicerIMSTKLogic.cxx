@@ -18,279 +18,3767 @@
 // IMSTK Logic includes
 #include "vtkSlicerIMSTKLogic.h"
 #include "vtkSlicerIMSTKLogicConfigure.h" // For Slicer_iMSTK_USE_OpenHaptics, Slicer_iMSTK_USE_RENDERING_VTK
+#include "vtkSlicerIMSTKCollisionData.h"
+#include "vtkSlicerIMSTKGeometryCache.h"
+#include "vtkSlicerIMSTKGeometryConversion.h"
+#include "vtkSlicerIMSTKLevelOfDetail.h"
+#include "vtkSlicerIMSTKPoseRingBuffer.h"
+#include "vtkSlicerIMSTKPoseSharedMemory.h"
+#include "vtkSlicerIMSTKReplayDeviceClient.h"
+#include "vtkSlicerIMSTKSceneBuilder.h"
+#include "vtkSlicerIMSTKScheduler.h"
+#include "vtkSlicerIMSTKSessionLog.h"
+#include "vtkSlicerIMSTKSnapshot.h"
+#include "vtkSlicerIMSTKTraceBuffer.h"
+#include "vtkSlicerIMSTKTripleBuffer.h"
+#include "vtkSlicerIMSTKVolumeMesh.h"
 
 // MRML includes
 #include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLModelNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLSegmentationNode.h>
+#include <vtkMRMLTransformableNode.h>
+#include <vtkMRMLTransformNode.h>
 
 // iMSTK includes
 #include "imstkCamera.h"
 #include "imstkCollidingObject.h"
+#include "imstkCollisionData.h"
 #include "imstkDirectionalLight.h"
 #include "imstkDummyClient.h"
-#include "imstkGeometryUtilities.h"
 #ifdef Slicer_iMSTK_USE_OpenHaptics
 # include "imstkHapticDeviceClient.h"
 # include "imstkHapticDeviceManager.h"
 #endif
 #include "imstkKeyboardSceneControl.h"
+#include "imstkModule.h"
 #include "imstkMouseSceneControl.h"
 #include "imstkNew.h"
+#include "imstkPointSet.h"
+#include "imstkRigidBodyModel2.h"
+#include "imstkRigidObject2.h"
 #include "imstkScene.h"
 #include "imstkSceneManager.h"
 #include "imstkSceneObjectController.h"
 #include "imstkSceneObject.h"
 #include "imstkSimulationManager.h"
 #include "imstkSurfaceMesh.h"
+#include "imstkTetrahedralMesh.h"
+#include "imstkVecDataArray.h"
 #include "imstkVisualModel.h"
 #ifdef Slicer_iMSTK_USE_RENDERING_VTK
 # include "imstkVTKViewer.h"
 #endif
 
 // VTK includes
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
 #include <vtkIntArray.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkRenderWindow.h>
+#include <vtkSegmentation.h>
+#include <vtkSegmentationConverter.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// TBB includes
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
 
 // STD includes
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkSlicerIMSTKLogic::vtkInternal
+{
+public:
+  typedef std::chrono::steady_clock ClockType;
+
+  /// Pose published by a simulation
+  struct Pose
+  {
+    /// Row-major 4x4 matrix, as expected by vtkMatrix4x4::DeepCopy
+    std::array<double, 16> Matrix;
+    ClockType::time_point Timestamp;
+  };
+
+  /// Changes made by the main thread to the objects of a running scene,
+  /// applied by the scene manager thread before its next step
+  struct ChangeQueue
+  {
+    std::mutex Mutex;
+    std::vector<std::function<void()>> Changes;
+    /// Changes being applied, swapped with Changes so that both vectors keep
+    /// their capacity. Only accessed by the scene manager thread.
+    std::vector<std::function<void()>> Applying;
+    /// Set while there are changes, so that steps do not lock for nothing
+    std::atomic<bool> Pending{ false };
+
+    void Push(std::function<void()> change)
+    {
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      this->Changes.push_back(std::move(change));
+      this->Pending.store(true, std::memory_order_release);
+    }
+
+    void Apply()
+    {
+      if (!this->Pending.load(std::memory_order_acquire))
+      {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        this->Applying.swap(this->Changes);
+        this->Pending.store(false, std::memory_order_relaxed);
+      }
+      for (const std::function<void()>& change : this->Applying)
+      {
+        change();
+      }
+      this->Applying.clear();
+    }
+  };
+
+  /// Synchronization settings and counters of one simulation.
+  /// Settings are written by the main thread and read by the scene manager
+  /// thread, counters are updated by both.
+  struct SyncState
+  {
+    std::atomic<int> Mode{ vtkSlicerIMSTKLogic::SyncFixedRate };
+    std::atomic<double> PublishPeriod{ 1.0 / 60.0 };
+
+    std::atomic<std::uint64_t> Updates{ 0 };
+    std::atomic<std::uint64_t> Dropped{ 0 };
+    std::atomic<std::uint64_t> Coalesced{ 0 };
+    std::atomic<std::uint64_t> Published{ 0 };
+
+    void ResetCounters()
+    {
+      this->Updates = 0;
+      this->Dropped = 0;
+      this->Coalesced = 0;
+      this->Published = 0;
+    }
+  };
+
+  /// Hot path measurements of one simulation, all durations in microseconds.
+  /// Each statistics has a single writer: the scene manager thread for the
+  /// step and callback measurements, the main thread for the latency.
+  struct Instrumentation
+  {
+    vtkSlicerIMSTKRollingStatistics StepDuration;
+    vtkSlicerIMSTKRollingStatistics CallbackDuration;
+    vtkSlicerIMSTKRollingStatistics PoseLatency;
+    vtkSlicerIMSTKRollingStatistics ActualDt;
+    std::atomic<double> RequestedDt{ 0.0 };
+
+    /// Trace is allocated when tracing is first enabled, then kept across
+    /// restarts, and must only be used when Tracing is set
+    std::atomic<bool> Tracing{ false };
+    std::shared_ptr<vtkSlicerIMSTKTraceBuffer> Trace;
+
+    /// Only accessed by the scene manager thread
+    ClockType::time_point StepStart;
+    ClockType::time_point PreviousStepStart;
+
+    static double ToMicroseconds(ClockType::duration duration)
+    {
+      return std::chrono::duration<double, std::micro>(duration).count();
+    }
+  };
+
+  /// State shared by everything that publishes simulation data to MRML.
+  /// BeginUpdate()/EndUpdate() are called by the scene manager thread around
+  /// the filling of the observer mailbox.
+  /// Observers are owned by the callbacks connected to the scene manager,
+  /// which cannot be disconnected: they live as long as the scene manager.
+  /// Once detached from their simulation (see DetachObservers()), they are
+  /// inactive and their callbacks do nothing.
+  struct Observer
+  {
+    std::atomic<bool> Active{ true };
+    std::shared_ptr<SyncState> Sync;
+    std::shared_ptr<Instrumentation> Stats;
+    /// Records what is applied to MRML, stream is the index of the observer
+    std::shared_ptr<vtkSlicerIMSTKSessionLog> Recorder;
+    int Stream = 0;
+    /// Only accessed by the scene manager thread
+    ClockType::time_point LastPublish;
+    ClockType::time_point UpdateStart;
+
+    /// Returns false if this update must be skipped
+    bool BeginUpdate()
+    {
+      if (!this->Active.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      this->UpdateStart = ClockType::now();
+      this->Sync->Updates.fetch_add(1, std::memory_order_relaxed);
+      if (this->Sync->Mode.load(std::memory_order_relaxed) == vtkSlicerIMSTKLogic::SyncFixedRate)
+      {
+        const std::chrono::duration<double> elapsed = this->UpdateStart - this->LastPublish;
+        if (elapsed.count() < this->Sync->PublishPeriod.load(std::memory_order_relaxed))
+        {
+          this->Sync->Dropped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        this->LastPublish = this->UpdateStart;
+      }
+      return true;
+    }
+
+    /// \a published is the result of vtkSlicerIMSTKTripleBuffer::Publish()
+    void EndUpdate(bool published)
+    {
+      if (!this->Active.load(std::memory_order_acquire))
+      {
+        return;
+      }
+      if (!published)
+      {
+        this->Sync->Coalesced.fetch_add(1, std::memory_order_relaxed);
+      }
+      const ClockType::time_point end = ClockType::now();
+      this->Stats->CallbackDuration.Add(Instrumentation::ToMicroseconds(end - this->UpdateStart));
+      if (this->Stats->Tracing.load(std::memory_order_acquire))
+      {
+        this->Stats->Trace->Record("Publish", this->UpdateStart, end);
+      }
+    }
+
+    /// Called by the main thread once published data reached MRML
+    void Applied(ClockType::time_point timestamp)
+    {
+      this->Sync->Published.fetch_add(1, std::memory_order_relaxed);
+      this->Stats->PoseLatency.Add(Instrumentation::ToMicroseconds(ClockType::now() - timestamp));
+    }
+  };
+
+  /// Link between one simulated pose and the MRML transform node displaying it.
+  /// The mailbox is written by the scene manager thread and drained by
+  /// vtkSlicerIMSTKLogic::processPendingUpdates() on the main thread.
+  /// Device poses are instead sampled at the device rate into PoseSamples,
+  /// and interpolated at the display time by the main thread.
+  struct TransformObserver : public Observer
+  {
+    vtkSlicerIMSTKTripleBuffer<Pose> Mailbox;
+    std::shared_ptr<vtkSlicerIMSTKPoseRingBuffer> PoseSamples;
+    /// Last pose applied from PoseSamples, only accessed by the main thread
+    Pose AppliedPose;
+    vtkWeakPointer<vtkMRMLLinearTransformNode> TransformNode;
+    vtkNew<vtkMatrix4x4> Matrix;
+    bool ToParent = false;
+
+    void EndUpdate()
+    {
+      if (!this->Active.load(std::memory_order_acquire))
+      {
+        return;
+      }
+      this->Mailbox.GetWriteBuffer().Timestamp = this->UpdateStart;
+      this->Observer::EndUpdate(this->Mailbox.Publish());
+    }
+  };
+
+  /// Link between a deformable surface mesh and the MRML model node displaying it.
+  /// Connectivity is copied once, only vertex positions (and optionally
+  /// normals) are streamed. Each mailbox slot holds preallocated arrays that
+  /// the model adopts without copy when the slot reaches the main thread.
+  struct MeshObserver : public Observer
+  {
+    struct Frame
+    {
+      /// Unused when the points are bound to the iMSTK vertex buffer
+      vtkSmartPointer<vtkDoubleArray> Points;
+      vtkSmartPointer<vtkFloatArray> Normals;
+      ClockType::time_point Timestamp;
+    };
+    vtkSlicerIMSTKTripleBuffer<Frame> Mailbox;
+    vtkWeakPointer<vtkMRMLModelNode> ModelNode;
+    vtkSmartPointer<vtkPolyData> PolyData;
+    std::shared_ptr<imstk::VecDataArray<double, 3>> Vertices;
+    std::shared_ptr<imstk::VecDataArray<int, 3>> Triangles;
+    bool UpdateNormals = false;
+    /// Points are bound to the iMSTK vertex buffer, nothing is copied and
+    /// frames only carry normals and a modification notice.
+    bool SharedBuffer = false;
+    /// If set, Vertices are computed from the simulated decimated mesh
+    std::shared_ptr<const vtkSlicerIMSTKLevelOfDetail::Level> LevelOfDetail;
+    std::shared_ptr<imstk::VecDataArray<double, 3>> DecimatedVertices;
+    std::shared_ptr<imstk::VecDataArray<int, 3>> DecimatedTriangles;
+
+    void Allocate(vtkIdType numberOfPoints);
+    void ApplyLevelOfDetail()
+    {
+      this->LevelOfDetail->Apply(*this->DecimatedVertices, *this->DecimatedTriangles,
+        this->Vertices->getPointer()->data());
+    }
+    void CopyPoints();
+    void ComputeNormals();
+    /// Give the model its own copy of the points bound to the iMSTK vertex
+    /// buffer, which does not outlive the observer
+    void Detach();
+
+    void EndUpdate()
+    {
+      if (!this->Active.load(std::memory_order_acquire))
+      {
+        return;
+      }
+      this->Mailbox.GetWriteBuffer().Timestamp = this->UpdateStart;
+      this->Observer::EndUpdate(this->Mailbox.Publish());
+    }
+  };
+
+  /// Link between the geometries of several rigid bodies and the MRML
+  /// transform nodes displaying them, published with a single callback.
+  /// Transforms are gathered in a structure-of-arrays frame: element e
+  /// (row-major) of transform i is stored at index e * Count + i.
+  struct TransformBatch : public Observer
+  {
+    struct Frame
+    {
+      std::vector<double> Elements;
+      ClockType::time_point Timestamp;
+    };
+    vtkSlicerIMSTKTripleBuffer<Frame> Mailbox;
+    std::size_t Count = 0;
+    /// Keep the geometries alive, the callback only uses the raw pointers
+    std::vector<std::shared_ptr<imstk::Geometry>> Geometries;
+    std::vector<imstk::Geometry*> GeometryPointers;
+    std::vector<vtkWeakPointer<vtkMRMLLinearTransformNode>> TransformNodes;
+    /// If not empty, origin of each geometry in the coordinates of the
+    /// displayed model: the transform of the model is the one of the
+    /// geometry followed by a translation by minus the origin
+    std::vector<std::array<double, 3>> Origins;
+
+    /// Last transforms applied to MRML, only accessed by the main thread
+    std::vector<double> AppliedElements;
+    vtkNew<vtkMatrix4x4> Matrix;
+
+    /// Shared memory the transforms are also written to at every step, if
+    /// any, with the index of each transform in it
+    std::shared_ptr<vtkSlicerIMSTKPoseSharedMemory> PoseExport;
+    std::vector<int> PoseExportIndices;
+    /// Row-major transforms one after the other, only accessed by the scene
+    /// manager thread
+    std::vector<double> PoseExportElements;
+
+    void Allocate();
+    /// Write the transforms at elements[e * elementStride + i * transformStride]
+    void Gather(double* elements, std::size_t elementStride, std::size_t transformStride) const;
+    void Apply();
+    void Export();
+
+    void EndUpdate()
+    {
+      if (!this->Active.load(std::memory_order_acquire))
+      {
+        return;
+      }
+      this->Mailbox.GetWriteBuffer().Timestamp = this->UpdateStart;
+      this->Observer::EndUpdate(this->Mailbox.Publish());
+    }
+  };
+
+  /// Link between the collision data of a scene and the MRML model node
+  /// displaying their contacts as vertices, with the contact normals and
+  /// penetration depths as point data.
+  /// Contacts are gathered by the scene manager thread, at most every
+  /// Period, into frames preallocated for Capacity contacts. Frames only
+  /// hold the current contacts one after the other, and are only published
+  /// when the contacts changed, so that a scene at rest costs nothing to the
+  /// main thread.
+  struct ContactObserver
+  {
+    /// See Observer::Active
+    std::atomic<bool> Active{ true };
+
+    struct Frame
+    {
+      /// Structure-of-arrays, only the first NumberOfContacts are used
+      std::vector<double> Points;
+      std::vector<double> Normals;
+      std::vector<double> Depths;
+      vtkIdType NumberOfContacts = 0;
+      ClockType::time_point Timestamp;
+    };
+    vtkSlicerIMSTKTripleBuffer<Frame> Mailbox;
+    std::vector<std::shared_ptr<imstk::CollisionData>> CollisionData;
+    /// First geometry of each collision data, and the same geometry if it
+    /// is a point set, resolved when the geometry changes
+    std::vector<imstk::Geometry*> Geometries;
+    std::vector<imstk::PointSet*> PointSets;
+    vtkIdType Capacity = 0;
+    ClockType::duration Period;
+
+    /// Only accessed by the scene manager thread
+    ClockType::time_point LastGather;
+    /// Contacts of the last published frame
+    Frame Published;
+
+    /// Only accessed by the main thread. The arrays of the model reference
+    /// the frame last consumed, vertex cells reference Offsets and
+    /// Connectivity.
+    vtkWeakPointer<vtkMRMLModelNode> ModelNode;
+    vtkSmartPointer<vtkPolyData> PolyData;
+    vtkNew<vtkDoubleArray> Points;
+    vtkNew<vtkDoubleArray> Normals;
+    vtkNew<vtkDoubleArray> Depths;
+    std::vector<vtkIdType> Offsets;
+    std::vector<vtkIdType> Connectivity;
+    vtkNew<vtkIdTypeArray> OffsetsView;
+    vtkNew<vtkIdTypeArray> ConnectivityView;
+
+    void Allocate();
+    /// Fill the write buffer with the current contacts. Returns false if
+    /// they did not change since the last published frame.
+    bool Gather();
+    void Apply();
+    /// Give the model its own copy of the arrays referencing the frames and
+    /// cells of the observer, which do not outlive it
+    void Detach();
+  };
+
+  struct Simulation
+  {
+    std::string Name;
+    std::shared_ptr<imstk::SceneManager> SceneManager;
+    std::vector<std::shared_ptr<TransformBatch>> TransformBatches;
+    std::vector<std::shared_ptr<TransformObserver>> TransformObservers;
+    std::vector<std::shared_ptr<MeshObserver>> MeshObservers;
+    std::vector<std::shared_ptr<ContactObserver>> ContactObservers;
+    /// Model displaying the contacts of the built scenes, kept across resets
+    vtkWeakPointer<vtkMRMLModelNode> ContactModelNode;
+    std::shared_ptr<SyncState> Sync = std::make_shared<SyncState>();
+    std::shared_ptr<Instrumentation> Stats = std::make_shared<Instrumentation>();
+    /// Kept across resets so that a recording can span restarts
+    std::shared_ptr<vtkSlicerIMSTKSessionLog> Recorder = std::make_shared<vtkSlicerIMSTKSessionLog>();
+    /// Transforms of the batches after each step of the last batch run
+    vtkSmartPointer<vtkDoubleArray> BatchTrajectory;
+
+    /// Changes applied to the running scene, see setParameterNode()
+    std::shared_ptr<ChangeQueue> Changes = std::make_shared<ChangeQueue>();
+    /// Objects built from model nodes, with the description of the models
+    /// they are up to date with
+    std::vector<vtkSlicerIMSTKSceneBuilder::ObjectDescription> Descriptions;
+    std::vector<std::shared_ptr<imstk::SceneObject>> Objects;
+    std::vector<std::shared_ptr<imstk::SceneObjectController>> Controllers;
+    /// Nodes of runObjectCtrlDummyClientExample(), compared with the
+    /// references of the parameter node
+    std::string InputModelID;
+    std::string OutputTransformID;
+    /// Parameters applied to the scene, 0 if not set
+    double TimeStep = 0.0;
+    double TranslationScaling = 0.0;
+    /// Kept across resets
+    vtkWeakPointer<vtkMRMLNode> ParameterNode;
+    /// Rebuild and restart the simulation, for the changes that cannot be
+    /// applied to the running scene
+    std::function<void()> Rebuild;
+
+    /// Modules stepped by the shared scheduler, with their lane
+    std::vector<std::pair<std::shared_ptr<imstk::Module>, int>> Modules;
+    /// Other periodic tasks, such as device sampling, run by the scheduler
+    /// even if the modules are run by a driver
+    std::vector<std::pair<vtkSlicerIMSTKScheduler::TaskType, int>> Samplers;
+    std::vector<int> TaskIds;
+    /// Number of modules initialized by their first step since the last start
+    std::shared_ptr<std::atomic<int>> InitializedModules = std::make_shared<std::atomic<int>>(0);
+    /// Runs the modules instead of the scheduler when an iMSTK viewer is used
+    std::shared_ptr<imstk::SimulationManager> Driver;
+    /// Modules added to the driver, initialized by it in its thread
+    std::vector<std::shared_ptr<imstk::Module>> DriverModules;
+    /// Thread running the driver, joined when the simulation is stopped
+    std::thread Thread;
+    std::shared_ptr<std::atomic<bool>> Finished;
+    bool Paused = false;
+    /// Slots of PoseExport written by the current build
+    std::set<int> ExportedPoses;
+  };
+
+  ~vtkInternal();
+
+  Simulation* FindSimulation(imstk::SceneManager* sceneManager);
+
+  /// Set how the modules of \a simulation are run: on the shared scheduler
+  /// when \a headless, otherwise by a driver also running a hidden viewer.
+  /// The scene manager goes to the physics lane, device managers to the
+  /// haptics lane.
+  void SetupModules(Simulation& simulation,
+    const std::vector<std::shared_ptr<imstk::Module>>& deviceManagers, bool headless);
+
+  /// False for simulations whose scene manager is advanced by the caller
+  static bool HasModules(const Simulation& simulation);
+  static bool IsRunning(const Simulation& simulation);
+
+  /// Run the modules of \a simulation
+  void StartModules(Simulation& simulation);
+
+  /// Stop the modules of \a simulation and wait for their steps to complete.
+  /// The scene is kept and can be started again.
+  void StopModules(Simulation& simulation);
+
+  void SetPaused(Simulation& simulation, bool paused);
+
+  /// Deactivate the observers of \a simulation and detach their models from
+  /// the memory of the observers, before they are released
+  static void DetachObservers(Simulation& simulation);
+
+  /// Publish the initial state of \a observer, set its polydata to its model
+  /// and stream the vertices of each step of \a sceneManager to it
+  void AddMeshObserver(Simulation& simulation, std::shared_ptr<imstk::SceneManager> sceneManager,
+    std::shared_ptr<MeshObserver> observer);
+
+  /// Display the contacts of \a collisionData with \a modelNode, gathered
+  /// every \a period seconds after the steps of the scene of \a simulation
+  void AddContactObserver(Simulation& simulation,
+    const std::vector<std::shared_ptr<imstk::CollisionData>>& collisionData,
+    vtkMRMLModelNode* modelNode, vtkIdType capacity, double period);
+
+  /// Copy the state of \a objects and \a controllers to \a snapshot, see
+  /// vtkSlicerIMSTKSnapshot for the records. Called between two steps.
+  static void CaptureState(const std::vector<std::shared_ptr<imstk::SceneObject>>& objects,
+    const std::vector<std::shared_ptr<imstk::SceneObjectController>>& controllers,
+    vtkSlicerIMSTKSnapshot& snapshot);
+
+  /// Set the state of \a objects and \a controllers from \a snapshot.
+  /// Records of missing objects, or whose size does not match, are ignored.
+  /// Called between two steps.
+  static void RestoreState(const vtkSlicerIMSTKSnapshot& snapshot,
+    const std::vector<std::shared_ptr<imstk::SceneObject>>& objects,
+    const std::vector<std::shared_ptr<imstk::SceneObjectController>>& controllers);
+
+  /// Run \a change on the scene of \a simulation: at once if it is stopped,
+  /// otherwise before its next step
+  static void PushChange(Simulation& simulation, std::function<void()> change);
+
+  /// Advance the stopped \a simulation by \a numberOfSteps steps of \a dt
+  /// in the calling thread, gathering its transform batches after each step.
+  /// \a onStep, if any, is called after each step with the number of steps
+  /// done.
+  vtkSlicerIMSTKLogic::BatchStatistics RunBatch(Simulation& simulation, int numberOfSteps, double dt,
+    bool reset, const std::function<void(int)>& onStep);
+
+  /// Statistics and changes of the steps of a scene manager, shared with
+  /// the callbacks connected to it once, see ResetSimulation()
+  struct StepHook
+  {
+    /// Replaced by the main thread when the scene manager is registered
+    /// again, with std::atomic_store()
+    std::shared_ptr<Instrumentation> Stats;
+    std::shared_ptr<ChangeQueue> Changes;
+    /// Statistics of the current step, only accessed by the scene manager
+    /// thread
+    std::shared_ptr<Instrumentation> StepStats;
+  };
+  std::map<imstk::SceneManager*, std::pair<std::weak_ptr<imstk::SceneManager>, std::shared_ptr<StepHook>>> StepHooks;
+
+  /// Prepare the record of a simulation that is about to be (re)started.
+  /// The previous simulation with the same name is stopped and released.
+  /// Synchronization and tracing settings are preserved.
+  Simulation& ResetSimulation(const std::string& simName, std::shared_ptr<imstk::SceneManager> sceneManager);
+
+  /// Apply the parameters of the parameter node of \a simulation that
+  /// changed. Returns false if the simulation must be rebuilt.
+  bool ApplyParameters(Simulation& simulation);
+
+  /// Update object \a index of \a simulation from its model node after
+  /// \a event. Returns false if the simulation must be rebuilt.
+  bool UpdateObject(Simulation& simulation, std::size_t index, vtkMRMLModelNode* modelNode, unsigned long event);
+
+  /// IDs of the parameter nodes and model nodes observed for changes to
+  /// apply to the running simulations
+  std::set<std::string> TunedNodeIDs;
+  /// Models observed until they get their first mesh, see
+  /// OnMRMLSceneNodeAdded()
+  std::set<std::string> AwaitingMesh;
+
+  /// Create the observer of a pose displayed by the given transform node
+  std::shared_ptr<TransformObserver> AddTransformObserver(Simulation& simulation,
+    vtkMRMLLinearTransformNode* transformNode, bool toParent);
+
+  /// Publish the transforms of \a geometries to \a transformNodes from a
+  /// single postUpdate callback, see TransformBatch::Origins for \a origins
+  std::shared_ptr<TransformBatch> AddTransformBatch(Simulation& simulation,
+    const std::vector<std::shared_ptr<imstk::Geometry>>& geometries,
+    const std::vector<vtkMRMLLinearTransformNode*>& transformNodes,
+    const std::vector<std::array<double, 3>>& origins = std::vector<std::array<double, 3>>());
+
+  std::map<std::string, Simulation> Simulations;
+
+  /// Runs the steps of all the headless simulations
+  vtkSlicerIMSTKScheduler Scheduler;
+
+  /// Simulations being advanced by runBatchSimulation(), whose scene
+  /// builds are started once the run completes
+  std::set<std::string> BatchRuns;
+
+  /// Segment the poses observed from now on are exported to, see
+  /// startPoseExport()
+  std::shared_ptr<vtkSlicerIMSTKPoseSharedMemory> PoseExport;
+  /// Slot of each exported pose, by simulation name and \a key of
+  /// AddExportedPose(), kept for the next builds of the simulation
+  std::map<std::pair<std::string, std::string>, int> PoseExportSlots;
+
+  /// Return the slot of PoseExport written by \a simulation for its pose
+  /// \a key, named "<simulation name>/<name>", or -1. Slots are reused by
+  /// the next builds of the same simulation, the previous build being
+  /// stopped, but never shared by two writers.
+  int AddExportedPose(Simulation& simulation, const std::string& key, const std::string& name);
+
+  /// Snapshots by name, see saveSnapshotAsync(). They are not modified once
+  /// captured, pending restores keep the ones removed or replaced meanwhile.
+  std::map<std::string, std::shared_ptr<const vtkSlicerIMSTKSnapshot>> Snapshots;
+
+  /// Session replayed instead of the devices, see setDeviceReplay()
+  std::shared_ptr<vtkSlicerIMSTKSessionLog> ReplayLog;
+  bool ReplayRealTime = true;
+
+  /// Return a client replaying device \a stream of ReplayLog, if any
+  std::shared_ptr<vtkSlicerIMSTKReplayDeviceClient> MakeReplayClient(int stream = 0) const
+  {
+    if (!this->ReplayLog)
+    {
+      return nullptr;
+    }
+    auto client = std::make_shared<vtkSlicerIMSTKReplayDeviceClient>(this->ReplayLog, stream);
+    client->SetRealTime(this->ReplayRealTime);
+    return client;
+  }
+
+  /// Model geometries converted to iMSTK, keyed by model node ID
+  vtkSlicerIMSTKGeometryCache GeometryCache;
+
+  struct SceneBuild
+  {
+    vtkSlicerIMSTKSceneBuilder::SceneDescription Description;
+    std::future<vtkSlicerIMSTKSceneBuilder::BuiltScene> Result;
+    /// Cleared if the simulation is stopped before the build completes
+    bool Start = true;
+    /// State of the request returned by buildSceneFromMRMLAsync(), if any
+    std::shared_ptr<std::atomic<int>> RequestState;
+  };
+  /// Scenes being built in worker threads. Declared after the cache they
+  /// use so that destroying a pending build waits for it first.
+  std::map<std::string, SceneBuild> SceneBuilds;
+
+  /// Collision data of the models being precomputed by TBB workers, waited
+  /// for on destruction.
+  tbb::task_group CollisionDataTasks;
+  std::mutex CollisionDataMutex;
+  std::set<std::string> PendingCollisionData;
+  std::set<std::string> PendingVolumeMeshes;
+
+  /// Shallow copy of the closed surface of a model node, or of a segment of
+  /// a segmentation node (the first one if \a segmentId is empty), and its
+  /// key in the geometry cache. Returns null if there is no such surface.
+  static vtkSmartPointer<vtkPolyData> GetClosedSurface(vtkMRMLNode* node, const std::string& segmentId, std::string& key);
+
+  /// Operations started by the asynchronous methods
+  struct Request
+  {
+    /// Final state, may be set by a worker thread
+    std::shared_ptr<std::atomic<int>> State = std::make_shared<std::atomic<int>>(vtkSlicerIMSTKLogic::RequestPending);
+    /// If set, called by processPendingUpdates() while the request is
+    /// pending to get its state
+    std::function<int()> Poll;
+    bool Notified = false;
+  };
+  std::map<int, Request> Requests;
+  int NextRequestId = 1;
+  /// Finished requests whose state is kept for getRequestState()
+  static const std::size_t MaximumFinishedRequests = 256;
+
+  /// Register a new request and return its ID
+  int AddRequest(std::function<int()> poll = nullptr);
+
+  /// Update the pending requests and return the ones that just finished
+  std::vector<int> UpdateRequests();
+
+  /// Batches with a frame to apply, reused across processPendingUpdates() calls
+  std::vector<std::pair<TransformBatch*, ClockType::time_point>> PendingBatches;
+};
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKLogic::vtkInternal::~vtkInternal()
+{
+  this->CollisionDataTasks.wait();
+  for (auto& x : this->Simulations)
+  {
+    this->StopModules(x.second);
+    DetachObservers(x.second);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::vtkInternal::HasModules(const Simulation& simulation)
+{
+  return simulation.Driver || !simulation.Modules.empty();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::vtkInternal::IsRunning(const Simulation& simulation)
+{
+  if (simulation.Driver)
+  {
+    return simulation.Thread.joinable() && !simulation.Finished->load();
+  }
+  return !simulation.TaskIds.empty();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::StartModules(Simulation& simulation)
+{
+  if (IsRunning(simulation))
+  {
+    return;
+  }
+  if (simulation.Thread.joinable())
+  {
+    // Driver stopped from the iMSTK viewer
+    this->StopModules(simulation);
+  }
+  simulation.Paused = false;
+
+  for (auto& sampler : simulation.Samplers)
+  {
+    simulation.TaskIds.push_back(this->Scheduler.AddTask(sampler.second,
+      this->Scheduler.GetLanePeriod(sampler.second), sampler.first));
+  }
+
+  if (simulation.Driver)
+  {
+    auto finished = std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<imstk::SimulationManager> driver = simulation.Driver;
+    simulation.Finished = finished;
+    simulation.Thread = std::thread(
+      [driver, finished]()
+      {
+        driver->start();
+        finished->store(true);
+      });
+    return;
+  }
+
+  auto initializedModules = std::make_shared<std::atomic<int>>(0);
+  simulation.InitializedModules = initializedModules;
+  for (auto& x : simulation.Modules)
+  {
+    std::shared_ptr<imstk::Module> module = x.first;
+    const double period = this->Scheduler.GetLanePeriod(x.second);
+    // The time step of the parameter node, if any, is kept across restarts
+    module->setDt(module == simulation.SceneManager && simulation.TimeStep > 0.0 ? simulation.TimeStep : period);
+    // Modules are initialized by their first step, in the thread pool
+    auto initialized = std::make_shared<bool>(false);
+    simulation.TaskIds.push_back(this->Scheduler.AddTask(x.second, period,
+      [module, initialized, initializedModules]()
+      {
+        if (!*initialized)
+        {
+          module->init();
+          *initialized = true;
+          initializedModules->fetch_add(1);
+        }
+        module->update();
+      },
+      [module, initialized]()
+      {
+        if (*initialized)
+        {
+          module->uninit();
+        }
+      }));
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::StopModules(Simulation& simulation)
+{
+  for (int taskId : simulation.TaskIds)
+  {
+    this->Scheduler.RemoveTask(taskId);
+  }
+  simulation.TaskIds.clear();
+
+  if (simulation.Thread.joinable())
+  {
+    // The driver sets its status to running when it starts, keep requesting
+    // the stop until it actually returns.
+    while (!simulation.Finished->load())
+    {
+      simulation.Driver->requestStatus(ModuleDriverStopped);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    simulation.Thread.join();
+  }
+  simulation.Paused = false;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKLogic::BatchStatistics vtkSlicerIMSTKLogic::vtkInternal::RunBatch(Simulation& simulation,
+  int numberOfSteps, double dt, bool reset, const std::function<void(int)>& onStep)
+{
+  BatchStatistics statistics;
+  this->StopModules(simulation);
+  std::shared_ptr<imstk::SceneManager> sceneManager = simulation.SceneManager;
+  // The trajectory is sized for the batches of the run, even if onStep
+  // replaces the ones of the simulation
+  const std::vector<std::shared_ptr<TransformBatch>> batches = simulation.TransformBatches;
+  std::shared_ptr<Instrumentation> stats = simulation.Stats;
+
+  // Preallocate the whole trajectory, one tuple per step
+  int numberOfTransforms = 0;
+  for (const std::shared_ptr<TransformBatch>& batch : batches)
+  {
+    numberOfTransforms += static_cast<int>(batch->Count);
+  }
+  if (!simulation.BatchTrajectory)
+  {
+    simulation.BatchTrajectory = vtkSmartPointer<vtkDoubleArray>::New();
+    simulation.BatchTrajectory->SetName("Trajectory");
+  }
+  vtkDoubleArray* trajectory = simulation.BatchTrajectory;
+  trajectory->SetNumberOfComponents(std::max(16 * numberOfTransforms, 1));
+  trajectory->SetNumberOfTuples(std::max(numberOfSteps, 0));
+
+  if (reset)
+  {
+    sceneManager->getActiveScene()->reset();
+  }
+  sceneManager->setDt(dt);
+  sceneManager->init();
+  simulation.Sync->ResetCounters();
+
+  const ClockType::time_point start = ClockType::now();
+  for (int step = 0; step < numberOfSteps; step++)
+  {
+    sceneManager->update();
+    double* elements = trajectory->GetPointer(static_cast<vtkIdType>(step) * trajectory->GetNumberOfComponents());
+    for (const std::shared_ptr<TransformBatch>& batch : batches)
+    {
+      batch->Gather(elements, 1, 16);
+      elements += 16 * batch->Count;
+    }
+    if (onStep)
+    {
+      onStep(step + 1);
+    }
+  }
+  const std::chrono::duration<double> wallTime = ClockType::now() - start;
+  sceneManager->uninit();
+
+  statistics.Steps = numberOfSteps;
+  statistics.SimulatedTime = numberOfSteps * dt;
+  statistics.WallTime = wallTime.count();
+  if (statistics.WallTime > 0.0)
+  {
+    statistics.StepsPerSecond = numberOfSteps / statistics.WallTime;
+    statistics.RealTimeFactor = statistics.SimulatedTime / statistics.WallTime;
+  }
+  statistics.StepDuration = stats->StepDuration.GetSummary();
+  return statistics;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::SetPaused(Simulation& simulation, bool paused)
+{
+  for (int taskId : simulation.TaskIds)
+  {
+    this->Scheduler.SetTaskPaused(taskId, paused);
+  }
+  if (simulation.Driver)
+  {
+    simulation.Driver->requestStatus(paused ? ModuleDriverPaused : ModuleDriverRunning);
+  }
+  simulation.Paused = paused;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKLogic::vtkInternal::Simulation*
+vtkSlicerIMSTKLogic::vtkInternal::FindSimulation(imstk::SceneManager* sceneManager)
+{
+  for (auto& x : this->Simulations)
+  {
+    if (x.second.SceneManager.get() == sceneManager)
+    {
+      return &x.second;
+    }
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKLogic::vtkInternal::Simulation&
+vtkSlicerIMSTKLogic::vtkInternal::ResetSimulation(const std::string& simName, std::shared_ptr<imstk::SceneManager> sceneManager)
+{
+  Simulation& simulation = this->Simulations[simName];
+  simulation.Name = simName;
+  this->StopModules(simulation);
+  simulation.Modules.clear();
+  simulation.Samplers.clear();
+  simulation.Driver = nullptr;
+  simulation.SceneManager = sceneManager;
+  DetachObservers(simulation);
+  simulation.TransformBatches.clear();
+  simulation.TransformObservers.clear();
+  simulation.MeshObservers.clear();
+  simulation.ContactObservers.clear();
+  simulation.ExportedPoses.clear();
+  simulation.Sync->ResetCounters();
+  // The parameter node is kept, its parameters are applied to the new scene
+  simulation.Changes = std::make_shared<ChangeQueue>();
+  simulation.Descriptions.clear();
+  simulation.Objects.clear();
+  simulation.Controllers.clear();
+  simulation.InputModelID.clear();
+  simulation.OutputTransformID.clear();
+  simulation.TimeStep = 0.0;
+  simulation.TranslationScaling = 0.0;
+  simulation.Rebuild = nullptr;
+
+  // Previous scene managers may still be running, start from fresh statistics
+  const std::shared_ptr<Instrumentation> previousStats = simulation.Stats;
+  simulation.Stats = std::make_shared<Instrumentation>();
+  simulation.Stats->Trace = previousStats->Trace;
+  simulation.Stats->Tracing = previousStats->Tracing.load();
+
+  // Measure the steps and apply the changes between two steps. The
+  // callbacks are connected once per scene manager, before any other so
+  // that the step duration does not include the postUpdate callbacks, and
+  // use the statistics and changes of its last registration.
+  if (!sceneManager)
+  {
+    return simulation;
+  }
+  for (auto it = this->StepHooks.begin(); it != this->StepHooks.end();)
+  {
+    it = it->second.first.expired() ? this->StepHooks.erase(it) : std::next(it);
+  }
+  auto registered = this->StepHooks.find(sceneManager.get());
+  if (registered != this->StepHooks.end())
+  {
+    std::shared_ptr<StepHook> hook = registered->second.second;
+    std::atomic_store(&hook->Stats, simulation.Stats);
+    std::atomic_store(&hook->Changes, simulation.Changes);
+    return simulation;
+  }
+  auto hook = std::make_shared<StepHook>();
+  hook->Stats = simulation.Stats;
+  hook->Changes = simulation.Changes;
+  this->StepHooks[sceneManager.get()] = std::make_pair(std::weak_ptr<imstk::SceneManager>(sceneManager), hook);
+
+  imstk::SceneManager* sceneManagerPtr = sceneManager.get();
+  imstk::connect<imstk::Event>(sceneManager, &imstk::SceneManager::preUpdate,
+    [hook, sceneManagerPtr](imstk::Event*)
+    {
+      hook->StepStats = std::atomic_load(&hook->Stats);
+      Instrumentation* stats = hook->StepStats.get();
+      stats->PreviousStepStart = stats->StepStart;
+      stats->StepStart = ClockType::now();
+      if (stats->PreviousStepStart != ClockType::time_point())
+      {
+        stats->ActualDt.Add(Instrumentation::ToMicroseconds(stats->StepStart - stats->PreviousStepStart));
+      }
+      stats->RequestedDt.store(sceneManagerPtr->getDt() * 1e6, std::memory_order_relaxed);
+      std::atomic_load(&hook->Changes)->Apply();
+    });
+  imstk::connect<imstk::Event>(sceneManager, &imstk::SceneManager::postUpdate,
+    [hook](imstk::Event*)
+    {
+      Instrumentation* stats = hook->StepStats.get();
+      if (!stats)
+      {
+        return;
+      }
+      const ClockType::time_point end = ClockType::now();
+      stats->StepDuration.Add(Instrumentation::ToMicroseconds(end - stats->StepStart));
+      if (stats->Tracing.load(std::memory_order_acquire))
+      {
+        stats->Trace->Record("Step", stats->StepStart, end);
+      }
+    });
+  return simulation;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::vtkInternal::ApplyParameters(Simulation& simulation)
+{
+  vtkMRMLNode* parameterNode = simulation.ParameterNode;
+  if (!parameterNode)
+  {
+    return true;
+  }
+
+  const char* timeStepValue = parameterNode->GetAttribute(vtkSlicerIMSTKLogic::TimeStepAttributeName);
+  const double timeStep = timeStepValue ? std::atof(timeStepValue) : 0.0;
+  if (timeStep > 0.0 && timeStep != simulation.TimeStep && simulation.SceneManager)
+  {
+    simulation.TimeStep = timeStep;
+    // The queue is drained by the scene manager itself, which is alive
+    imstk::SceneManager* sceneManager = simulation.SceneManager.get();
+    simulation.Changes->Push([sceneManager, timeStep]() { sceneManager->setDt(timeStep); });
+  }
+
+  const char* scalingValue = parameterNode->GetAttribute(vtkSlicerIMSTKLogic::TranslationScalingAttributeName);
+  const double scaling = scalingValue ? std::atof(scalingValue) : 0.0;
+  if (scaling > 0.0 && scaling != simulation.TranslationScaling && !simulation.Controllers.empty())
+  {
+    simulation.TranslationScaling = scaling;
+    std::vector<std::shared_ptr<imstk::SceneObjectController>> controllers = simulation.Controllers;
+    simulation.Changes->Push(
+      [controllers, scaling]()
+      {
+        for (const std::shared_ptr<imstk::SceneObjectController>& controller : controllers)
+        {
+          controller->setTranslationScaling(scaling);
+        }
+      });
+  }
+
+  vtkMRMLNode* inputModel = parameterNode->GetNodeReference(vtkSlicerIMSTKLogic::InputModelReferenceRole);
+  if (inputModel && !simulation.InputModelID.empty() && simulation.InputModelID != inputModel->GetID())
+  {
+    return false;
+  }
+
+  // Retarget the transform observers, starting from the current pose
+  vtkMRMLLinearTransformNode* outputTransform = vtkMRMLLinearTransformNode::SafeDownCast(
+    parameterNode->GetNodeReference(vtkSlicerIMSTKLogic::OutputTransformReferenceRole));
+  if (outputTransform && !simulation.OutputTransformID.empty()
+    && simulation.OutputTransformID != outputTransform->GetID())
+  {
+    for (const std::shared_ptr<TransformBatch>& batch : simulation.TransformBatches)
+    {
+      for (std::size_t i = 0; i < batch->Count; i++)
+      {
+        vtkMRMLLinearTransformNode* transformNode = batch->TransformNodes[i];
+        if (transformNode && simulation.OutputTransformID == transformNode->GetID())
+        {
+          batch->TransformNodes[i] = outputTransform;
+          for (int e = 0; e < 16; e++)
+          {
+            batch->AppliedElements[e * batch->Count + i] = std::numeric_limits<double>::quiet_NaN();
+          }
+        }
+      }
+    }
+    for (const std::shared_ptr<TransformObserver>& observer : simulation.TransformObservers)
+    {
+      vtkMRMLLinearTransformNode* transformNode = observer->TransformNode;
+      if (transformNode && simulation.OutputTransformID == transformNode->GetID())
+      {
+        observer->TransformNode = outputTransform;
+      }
+    }
+    vtkMRMLModelNode* outputModel = vtkMRMLModelNode::SafeDownCast(
+      parameterNode->GetNodeReference(vtkSlicerIMSTKLogic::OutputModelReferenceRole));
+    if (outputModel)
+    {
+      outputModel->SetAndObserveTransformNodeID(outputTransform->GetID());
+    }
+    simulation.OutputTransformID = outputTransform->GetID();
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::vtkInternal::UpdateObject(Simulation& simulation, std::size_t index,
+  vtkMRMLModelNode* modelNode, unsigned long event)
+{
+  vtkSlicerIMSTKSceneBuilder::ObjectDescription& previous = simulation.Descriptions[index];
+  // The transform of rigid models is the simulated pose
+  if (previous.Type == vtkSlicerIMSTKSceneBuilder::RigidObject
+    && event == vtkMRMLTransformableNode::TransformModifiedEvent)
+  {
+    return true;
+  }
+  vtkSlicerIMSTKSceneBuilder::ObjectDescription current;
+  // The input model of the example is not tagged
+  const int type = vtkSlicerIMSTKSceneBuilder::GetObjectType(modelNode);
+  current.Type = (type < 0 && previous.NodeID == simulation.InputModelID) ? previous.Type : type;
+  std::function<void()> update;
+  if (current.Type < 0 || !vtkSlicerIMSTKSceneBuilder::DescribeObject(modelNode, current)
+    || !vtkSlicerIMSTKSceneBuilder::PrepareUpdate(previous, current, simulation.Objects[index], update))
+  {
+    return false;
+  }
+  if (update)
+  {
+    simulation.Changes->Push(update);
+  }
+  previous = current;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<vtkSlicerIMSTKLogic::vtkInternal::TransformObserver>
+vtkSlicerIMSTKLogic::vtkInternal::AddTransformObserver(Simulation& simulation,
+  vtkMRMLLinearTransformNode* transformNode, bool toParent)
+{
+  auto observer = std::make_shared<TransformObserver>();
+  observer->TransformNode = transformNode;
+  observer->ToParent = toParent;
+  observer->Sync = simulation.Sync;
+  observer->Stats = simulation.Stats;
+  observer->Recorder = simulation.Recorder;
+  observer->Stream = static_cast<int>(simulation.TransformObservers.size());
+  simulation.TransformObservers.push_back(observer);
+  return observer;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKLogic::vtkInternal::AddExportedPose(Simulation& simulation, const std::string& key,
+  const std::string& name)
+{
+  if (!this->PoseExport)
+  {
+    return -1;
+  }
+  auto slot = this->PoseExportSlots.find(std::make_pair(simulation.Name, key));
+  if (slot != this->PoseExportSlots.end() && simulation.ExportedPoses.insert(slot->second).second)
+  {
+    return slot->second;
+  }
+  const int index = this->PoseExport->AddPose(simulation.Name + "/" + name);
+  if (index >= 0)
+  {
+    simulation.ExportedPoses.insert(index);
+    if (slot == this->PoseExportSlots.end())
+    {
+      this->PoseExportSlots[std::make_pair(simulation.Name, key)] = index;
+    }
+  }
+  return index;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<vtkSlicerIMSTKLogic::vtkInternal::TransformBatch>
+vtkSlicerIMSTKLogic::vtkInternal::AddTransformBatch(Simulation& simulation,
+  const std::vector<std::shared_ptr<imstk::Geometry>>& geometries,
+  const std::vector<vtkMRMLLinearTransformNode*>& transformNodes,
+  const std::vector<std::array<double, 3>>& origins)
+{
+  auto batch = std::make_shared<TransformBatch>();
+  batch->Sync = simulation.Sync;
+  batch->Stats = simulation.Stats;
+  batch->Recorder = simulation.Recorder;
+  batch->Stream = static_cast<int>(simulation.TransformBatches.size());
+  batch->Geometries = geometries;
+  batch->TransformNodes.assign(transformNodes.begin(), transformNodes.end());
+  batch->Origins = origins;
+  batch->Allocate();
+  if (this->PoseExport)
+  {
+    batch->PoseExport = this->PoseExport;
+    for (vtkMRMLLinearTransformNode* transformNode : transformNodes)
+    {
+      batch->PoseExportIndices.push_back(transformNode
+        ? this->AddExportedPose(simulation, transformNode->GetID(),
+            transformNode->GetName() && *transformNode->GetName() ? transformNode->GetName() : transformNode->GetID())
+        : -1);
+    }
+    batch->PoseExportElements.assign(16 * batch->Count, 0.0);
+  }
+  simulation.TransformBatches.push_back(batch);
+
+  imstk::connect<imstk::Event>(simulation.SceneManager, &imstk::SceneManager::postUpdate,
+    [batch](imstk::Event*)
+    {
+      if (!batch->Active.load(std::memory_order_acquire))
+      {
+        return;
+      }
+      // Exported poses are not rate limited
+      if (batch->PoseExport)
+      {
+        batch->Export();
+      }
+      if (!batch->BeginUpdate())
+      {
+        return;
+      }
+      batch->Gather(batch->Mailbox.GetWriteBuffer().Elements.data(), batch->Count, 1);
+      batch->EndUpdate();
+    });
+  return batch;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::TransformBatch::Allocate()
+{
+  this->Count = this->Geometries.size();
+  this->GeometryPointers.resize(this->Count);
+  for (std::size_t i = 0; i < this->Count; i++)
+  {
+    this->GeometryPointers[i] = this->Geometries[i].get();
+  }
+  for (int i = 0; i < 3; i++)
+  {
+    this->Mailbox.GetSlot(i).Elements.assign(16 * this->Count, 0.0);
+  }
+  // NaN never compares equal, the first frame is always applied
+  this->AppliedElements.assign(16 * this->Count, std::numeric_limits<double>::quiet_NaN());
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::TransformBatch::Gather(
+  double* elements, std::size_t elementStride, std::size_t transformStride) const
+{
+  const std::size_t count = this->Count;
+  imstk::Geometry* const* geometries = this->GeometryPointers.data();
+  const std::array<double, 3>* origins = this->Origins.empty() ? nullptr : this->Origins.data();
+  for (std::size_t i = 0; i < count; i++)
+  {
+    // Eigen is column-major, the frame stores row-major elements
+    const imstk::Mat4d transform = geometries[i]->getTransform();
+    const double* source = transform.data();
+    double* destination = elements + i * transformStride;
+    for (int row = 0; row < 4; row++)
+    {
+      for (int column = 0; column < 4; column++)
+      {
+        destination[(row * 4 + column) * elementStride] = source[column * 4 + row];
+      }
+      if (origins)
+      {
+        const std::array<double, 3>& origin = origins[i];
+        destination[(row * 4 + 3) * elementStride] -=
+          source[row] * origin[0] + source[4 + row] * origin[1] + source[8 + row] * origin[2];
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::TransformBatch::Export()
+{
+  const ClockType::time_point now = ClockType::now();
+  double* elements = this->PoseExportElements.data();
+  this->Gather(elements, 1, 16);
+  for (std::size_t i = 0; i < this->Count; i++)
+  {
+    // Poses that did not fit in the segment have no index
+    if (this->PoseExportIndices[i] >= 0)
+    {
+      this->PoseExport->Publish(this->PoseExportIndices[i], elements + 16 * i, now);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::TransformBatch::Apply()
+{
+  const std::size_t count = this->Count;
+  const double* elements = this->Mailbox.GetReadBuffer().Elements.data();
+  double* applied = this->AppliedElements.data();
+  for (std::size_t i = 0; i < count; i++)
+  {
+    double matrix[16];
+    bool modified = false;
+    for (int e = 0; e < 16; e++)
+    {
+      matrix[e] = elements[e * count + i];
+      modified |= (matrix[e] != applied[e * count + i]);
+    }
+    vtkMRMLLinearTransformNode* transformNode = this->TransformNodes[i];
+    // Static objects do not trigger any MRML event
+    if (!modified || !transformNode)
+    {
+      continue;
+    }
+    for (int e = 0; e < 16; e++)
+    {
+      applied[e * count + i] = matrix[e];
+    }
+    this->Matrix->DeepCopy(matrix);
+    transformNode->SetMatrixTransformFromParent(this->Matrix);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::MeshObserver::Allocate(vtkIdType numberOfPoints)
+{
+  for (int i = 0; i < 3; i++)
+  {
+    Frame& frame = this->Mailbox.GetSlot(i);
+    if (!this->SharedBuffer)
+    {
+      frame.Points = vtkSmartPointer<vtkDoubleArray>::New();
+      frame.Points->SetNumberOfComponents(3);
+      frame.Points->SetNumberOfTuples(numberOfPoints);
+    }
+    if (this->UpdateNormals)
+    {
+      frame.Normals = vtkSmartPointer<vtkFloatArray>::New();
+      frame.Normals->SetName("Normals");
+      frame.Normals->SetNumberOfComponents(3);
+      frame.Normals->SetNumberOfTuples(numberOfPoints);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::MeshObserver::CopyPoints()
+{
+  const double* source = static_cast<const double*>(this->Vertices->getVoidPointer());
+  double* destination = this->Mailbox.GetWriteBuffer().Points->GetPointer(0);
+  std::copy(source, source + 3 * this->Vertices->size(), destination);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::MeshObserver::ComputeNormals()
+{
+  // Area weighted vertex normals, computed in place to avoid the temporary
+  // arrays allocated by imstk::SurfaceMesh::computeVertexNormals()
+  const imstk::Vec3d* vertices = this->Vertices->getPointer();
+  const imstk::Vec3i* triangles = this->Triangles->getPointer();
+  const int numberOfTriangles = this->Triangles->size();
+  float* normals = this->Mailbox.GetWriteBuffer().Normals->GetPointer(0);
+  const vtkIdType numberOfValues = 3 * static_cast<vtkIdType>(this->Vertices->size());
+
+  std::fill(normals, normals + numberOfValues, 0.0f);
+  for (int t = 0; t < numberOfTriangles; t++)
+  {
+    const imstk::Vec3i& triangle = triangles[t];
+    const imstk::Vec3d faceNormal =
+      (vertices[triangle[1]] - vertices[triangle[0]]).cross(vertices[triangle[2]] - vertices[triangle[0]]);
+    for (int v = 0; v < 3; v++)
+    {
+      float* normal = normals + 3 * triangle[v];
+      normal[0] += static_cast<float>(faceNormal[0]);
+      normal[1] += static_cast<float>(faceNormal[1]);
+      normal[2] += static_cast<float>(faceNormal[2]);
+    }
+  }
+  for (vtkIdType i = 0; i < numberOfValues; i += 3)
+  {
+    const float norm = std::sqrt(normals[i] * normals[i] + normals[i + 1] * normals[i + 1] + normals[i + 2] * normals[i + 2]);
+    if (norm > 0.0f)
+    {
+      normals[i] /= norm;
+      normals[i + 1] /= norm;
+      normals[i + 2] /= norm;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::MeshObserver::Detach()
+{
+  if (!this->SharedBuffer || !this->PolyData)
+  {
+    return;
+  }
+  vtkNew<vtkDoubleArray> points;
+  points->DeepCopy(this->PolyData->GetPoints()->GetData());
+  this->PolyData->GetPoints()->SetData(points);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::DetachObservers(Simulation& simulation)
+{
+  // The callbacks of the scene manager keep running if it is started again
+  for (const std::shared_ptr<TransformBatch>& batch : simulation.TransformBatches)
+  {
+    batch->Active.store(false, std::memory_order_release);
+  }
+  for (const std::shared_ptr<TransformObserver>& observer : simulation.TransformObservers)
+  {
+    observer->Active.store(false, std::memory_order_release);
+  }
+  for (const std::shared_ptr<MeshObserver>& observer : simulation.MeshObservers)
+  {
+    observer->Active.store(false, std::memory_order_release);
+    observer->Detach();
+  }
+  for (const std::shared_ptr<ContactObserver>& observer : simulation.ContactObservers)
+  {
+    observer->Active.store(false, std::memory_order_release);
+    observer->Detach();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::AddMeshObserver(Simulation& simulation,
+  std::shared_ptr<imstk::SceneManager> sceneManager, std::shared_ptr<MeshObserver> observer)
+{
+  observer->Sync = simulation.Sync;
+  observer->Stats = simulation.Stats;
+  observer->Allocate(observer->Vertices->size());
+
+  // Go once through the mailbox so that the consumer slot holds the
+  // initial state before the simulation starts.
+  if (!observer->SharedBuffer)
+  {
+    observer->CopyPoints();
+  }
+  if (observer->UpdateNormals)
+  {
+    observer->ComputeNormals();
+  }
+  observer->Mailbox.Publish();
+  observer->Mailbox.Consume();
+  const MeshObserver::Frame& frame = observer->Mailbox.GetReadBuffer();
+  if (observer->SharedBuffer)
+  {
+    vtkNew<vtkDoubleArray> points;
+    points->SetNumberOfComponents(3);
+    points->SetArray(static_cast<double*>(observer->Vertices->getVoidPointer()), 3 * observer->Vertices->size(), /* save= */ 1);
+    observer->PolyData->GetPoints()->SetData(points);
+  }
+  else
+  {
+    observer->PolyData->GetPoints()->SetData(frame.Points);
+  }
+  if (observer->UpdateNormals)
+  {
+    observer->PolyData->GetPointData()->SetNormals(frame.Normals);
+  }
+  observer->ModelNode->SetAndObservePolyData(observer->PolyData);
+  simulation.MeshObservers.push_back(observer);
+
+  imstk::connect<imstk::Event>(sceneManager, &imstk::SceneManager::postUpdate,
+    [observer](imstk::Event*)
+    {
+      if (!observer->BeginUpdate())
+      {
+        return;
+      }
+      if (observer->LevelOfDetail)
+      {
+        observer->ApplyLevelOfDetail();
+      }
+      if (!observer->SharedBuffer)
+      {
+        observer->CopyPoints();
+      }
+      if (observer->UpdateNormals)
+      {
+        observer->ComputeNormals();
+      }
+      observer->EndUpdate();
+    });
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::ContactObserver::Allocate()
+{
+  const std::size_t capacity = static_cast<std::size_t>(this->Capacity);
+  for (int i = 0; i < 3; i++)
+  {
+    Frame& frame = this->Mailbox.GetSlot(i);
+    frame.Points.assign(3 * capacity, 0.0);
+    frame.Normals.assign(3 * capacity, 0.0);
+    frame.Depths.assign(capacity, 0.0);
+  }
+  this->Published.Points.assign(3 * capacity, 0.0);
+  this->Published.Normals.assign(3 * capacity, 0.0);
+  this->Published.Depths.assign(capacity, 0.0);
+
+  // One vertex per contact
+  this->Offsets.resize(capacity + 1);
+  this->Connectivity.resize(capacity);
+  for (std::size_t i = 0; i <= capacity; i++)
+  {
+    this->Offsets[i] = static_cast<vtkIdType>(i);
+    if (i < capacity)
+    {
+      this->Connectivity[i] = static_cast<vtkIdType>(i);
+    }
+  }
+
+  this->Points->SetNumberOfComponents(3);
+  this->Normals->SetNumberOfComponents(3);
+  this->Normals->SetName("Normals");
+  this->Depths->SetName("PenetrationDepth");
+  this->PolyData = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetData(this->Points);
+  this->PolyData->SetPoints(points);
+  vtkNew<vtkCellArray> vertices;
+  this->PolyData->SetVerts(vertices);
+  this->PolyData->GetPointData()->SetNormals(this->Normals);
+  this->PolyData->GetPointData()->SetScalars(this->Depths);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::vtkInternal::ContactObserver::Gather()
+{
+  Frame& frame = this->Mailbox.GetWriteBuffer();
+  double* points = frame.Points.data();
+  double* normals = frame.Normals.data();
+  double* depths = frame.Depths.data();
+  vtkIdType count = 0;
+  for (std::size_t i = 0; i < this->CollisionData.size(); i++)
+  {
+    // Elements of the second geometry are the same contacts seen from the
+    // other side
+    imstk::Geometry* geometry = this->CollisionData[i]->geomA.get();
+    if (geometry != this->Geometries[i])
+    {
+      this->Geometries[i] = geometry;
+      this->PointSets[i] = dynamic_cast<imstk::PointSet*>(geometry);
+    }
+    imstk::PointSet* pointSet = this->PointSets[i];
+    const imstk::VecDataArray<double, 3>* vertices = pointSet ? pointSet->getVertexPositions().get() : nullptr;
+    for (const imstk::CollisionElement& element : this->CollisionData[i]->elementsA)
+    {
+      if (count >= this->Capacity)
+      {
+        break;
+      }
+      imstk::Vec3d point;
+      imstk::Vec3d direction;
+      double depth = 0.0;
+      if (element.m_type == imstk::CollisionElementType::PointDirection)
+      {
+        const imstk::PointDirectionElement& contact = element.m_element.m_PointDirectionElement;
+        point = contact.pt;
+        direction = contact.dir;
+        depth = contact.penetrationDepth;
+      }
+      else if (element.m_type == imstk::CollisionElementType::PointIndexDirection && vertices)
+      {
+        const imstk::PointIndexDirectionElement& contact = element.m_element.m_PointIndexDirectionElement;
+        point = (*vertices)[contact.ptIndex];
+        direction = contact.dir;
+        depth = contact.penetrationDepth;
+      }
+      else
+      {
+        // Cell contacts have no penetration depth
+        continue;
+      }
+      for (int c = 0; c < 3; c++)
+      {
+        points[3 * count + c] = point[c];
+        normals[3 * count + c] = direction[c];
+      }
+      depths[count] = depth;
+      count++;
+    }
+  }
+  frame.NumberOfContacts = count;
+
+  const std::size_t numberOfValues = static_cast<std::size_t>(count);
+  if (count == this->Published.NumberOfContacts
+    && std::equal(points, points + 3 * numberOfValues, this->Published.Points.data())
+    && std::equal(normals, normals + 3 * numberOfValues, this->Published.Normals.data())
+    && std::equal(depths, depths + numberOfValues, this->Published.Depths.data()))
+  {
+    return false;
+  }
+  std::copy(points, points + 3 * numberOfValues, this->Published.Points.data());
+  std::copy(normals, normals + 3 * numberOfValues, this->Published.Normals.data());
+  std::copy(depths, depths + numberOfValues, this->Published.Depths.data());
+  this->Published.NumberOfContacts = count;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::ContactObserver::Apply()
+{
+  // The arrays are not copied, the frame stays valid until the next Consume()
+  Frame& frame = this->Mailbox.GetReadBuffer();
+  const vtkIdType count = frame.NumberOfContacts;
+  this->Points->SetArray(frame.Points.data(), 3 * count, /* save= */ 1);
+  this->Normals->SetArray(frame.Normals.data(), 3 * count, /* save= */ 1);
+  this->Depths->SetArray(frame.Depths.data(), count, /* save= */ 1);
+  this->OffsetsView->SetArray(this->Offsets.data(), count + 1, /* save= */ 1);
+  this->ConnectivityView->SetArray(this->Connectivity.data(), count, /* save= */ 1);
+  this->PolyData->GetVerts()->SetData(this->OffsetsView, this->ConnectivityView);
+  this->PolyData->GetPoints()->Modified();
+  this->PolyData->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::ContactObserver::Detach()
+{
+  if (!this->PolyData)
+  {
+    return;
+  }
+  vtkNew<vtkDoubleArray> points;
+  points->DeepCopy(this->Points);
+  this->PolyData->GetPoints()->SetData(points);
+  vtkNew<vtkDoubleArray> normals;
+  normals->DeepCopy(this->Normals);
+  this->PolyData->GetPointData()->SetNormals(normals);
+  vtkNew<vtkDoubleArray> depths;
+  depths->DeepCopy(this->Depths);
+  this->PolyData->GetPointData()->SetScalars(depths);
+  vtkNew<vtkIdTypeArray> offsets;
+  offsets->DeepCopy(this->OffsetsView);
+  vtkNew<vtkIdTypeArray> connectivity;
+  connectivity->DeepCopy(this->ConnectivityView);
+  this->PolyData->GetVerts()->SetData(offsets, connectivity);
+  this->PolyData->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::AddContactObserver(Simulation& simulation,
+  const std::vector<std::shared_ptr<imstk::CollisionData>>& collisionData,
+  vtkMRMLModelNode* modelNode, vtkIdType capacity, double period)
+{
+  auto observer = std::make_shared<ContactObserver>();
+  observer->CollisionData = collisionData;
+  observer->Geometries.assign(collisionData.size(), nullptr);
+  observer->PointSets.assign(collisionData.size(), nullptr);
+  observer->Capacity = std::max<vtkIdType>(capacity, 0);
+  observer->Period = std::chrono::duration_cast<ClockType::duration>(std::chrono::duration<double>(period));
+  observer->ModelNode = modelNode;
+  observer->Allocate();
+  // Start without contacts
+  observer->Mailbox.Publish();
+  observer->Mailbox.Consume();
+  observer->Apply();
+  modelNode->SetAndObservePolyData(observer->PolyData);
+  simulation.ContactObservers.push_back(observer);
+
+  imstk::connect<imstk::Event>(simulation.SceneManager, &imstk::SceneManager::postUpdate,
+    [observer](imstk::Event*)
+    {
+      const ClockType::time_point now = ClockType::now();
+      if (!observer->Active.load(std::memory_order_acquire) || now - observer->LastGather < observer->Period)
+      {
+        return;
+      }
+      observer->LastGather = now;
+      if (observer->Gather())
+      {
+        observer->Mailbox.GetWriteBuffer().Timestamp = now;
+        observer->Mailbox.Publish();
+      }
+    });
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::CaptureState(const std::vector<std::shared_ptr<imstk::SceneObject>>& objects,
+  const std::vector<std::shared_ptr<imstk::SceneObjectController>>& controllers,
+  vtkSlicerIMSTKSnapshot& snapshot)
+{
+  for (std::size_t i = 0; i < objects.size(); i++)
+  {
+    const int stream = static_cast<int>(i);
+    imstk::Geometry* geometry = objects[i]->getVisualGeometry().get();
+    if (geometry)
+    {
+      // Eigen is column-major, records are row-major
+      const imstk::Mat4d transform = geometry->getTransform();
+      const double* source = transform.data();
+      double* destination = snapshot.AddRecord(vtkSlicerIMSTKSnapshot::TransformRecord, stream, 16);
+      for (int row = 0; row < 4; row++)
+      {
+        for (int column = 0; column < 4; column++)
+        {
+          destination[row * 4 + column] = source[column * 4 + row];
+        }
+      }
+    }
+
+    auto rigidObject = dynamic_cast<imstk::RigidObject2*>(objects[i].get());
+    if (rigidObject)
+    {
+      // Bodies point to the state of their model once it is initialized
+      const imstk::RigidBody* body = rigidObject->getRigidBody().get();
+      const bool initialized = body->m_pos != nullptr;
+      const imstk::Vec3d& position = initialized ? *body->m_pos : body->m_initPos;
+      const imstk::Quatd& orientation = initialized ? *body->m_orientation : body->m_initOrientation;
+      const imstk::Vec3d& velocity = initialized ? *body->m_velocity : body->m_initVelocity;
+      const imstk::Vec3d& angularVelocity = initialized ? *body->m_angularVelocity : body->m_initAngularVelocity;
+      double* values = snapshot.AddRecord(vtkSlicerIMSTKSnapshot::RigidBodyRecord, stream, 13);
+      values[0] = position[0];
+      values[1] = position[1];
+      values[2] = position[2];
+      values[3] = orientation.w();
+      values[4] = orientation.x();
+      values[5] = orientation.y();
+      values[6] = orientation.z();
+      values[7] = velocity[0];
+      values[8] = velocity[1];
+      values[9] = velocity[2];
+      values[10] = angularVelocity[0];
+      values[11] = angularVelocity[1];
+      values[12] = angularVelocity[2];
+      // The visual mesh of rigid bodies only follows their pose
+      continue;
+    }
+
+    auto pointSet = dynamic_cast<imstk::PointSet*>(geometry);
+    const imstk::VecDataArray<double, 3>* vertices = pointSet ? pointSet->getVertexPositions().get() : nullptr;
+    if (vertices)
+    {
+      const std::uint32_t numberOfValues = 3 * static_cast<std::uint32_t>(vertices->size());
+      const double* source = vertices->getPointer()->data();
+      std::copy(source, source + numberOfValues,
+        snapshot.AddRecord(vtkSlicerIMSTKSnapshot::VerticesRecord, stream, numberOfValues));
+    }
+  }
+
+  for (std::size_t i = 0; i < controllers.size(); i++)
+  {
+    imstk::SceneObjectController* controller = controllers[i].get();
+    const imstk::Vec3d offset = controller->getTranslationOffset();
+    const imstk::Quatd rotation = controller->getRotationOffset();
+    double* values = snapshot.AddRecord(vtkSlicerIMSTKSnapshot::ControllerRecord, static_cast<int>(i), 8);
+    values[0] = offset[0];
+    values[1] = offset[1];
+    values[2] = offset[2];
+    values[3] = rotation.w();
+    values[4] = rotation.x();
+    values[5] = rotation.y();
+    values[6] = rotation.z();
+    values[7] = controller->getTranslationScaling();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::RestoreState(const vtkSlicerIMSTKSnapshot& snapshot,
+  const std::vector<std::shared_ptr<imstk::SceneObject>>& objects,
+  const std::vector<std::shared_ptr<imstk::SceneObjectController>>& controllers)
+{
+  for (std::size_t index = 0; index < snapshot.GetNumberOfRecords(); index++)
+  {
+    const vtkSlicerIMSTKSnapshot::RecordHeader& record = snapshot.GetRecord(index);
+    const double* values = snapshot.GetValues(index);
+    const std::size_t stream = record.Stream;
+
+    if (record.Type == vtkSlicerIMSTKSnapshot::ControllerRecord)
+    {
+      if (stream < controllers.size() && record.NumberOfValues == 8)
+      {
+        imstk::SceneObjectController* controller = controllers[stream].get();
+        controller->setTranslationOffset(imstk::Vec3d(values[0], values[1], values[2]));
+        controller->setRotationOffset(imstk::Quatd(values[3], values[4], values[5], values[6]));
+        controller->setTranslationScaling(values[7]);
+      }
+      continue;
+    }
+    if (stream >= objects.size())
+    {
+      continue;
+    }
+    imstk::SceneObject* object = objects[stream].get();
+    imstk::Geometry* geometry = object->getVisualGeometry().get();
+
+    if (record.Type == vtkSlicerIMSTKSnapshot::TransformRecord && geometry && record.NumberOfValues == 16)
+    {
+      imstk::Mat4d transform;
+      double* destination = transform.data();
+      for (int row = 0; row < 4; row++)
+      {
+        for (int column = 0; column < 4; column++)
+        {
+          destination[column * 4 + row] = values[row * 4 + column];
+        }
+      }
+      geometry->setTransform(transform);
+      geometry->postModified();
+    }
+    else if (record.Type == vtkSlicerIMSTKSnapshot::RigidBodyRecord && record.NumberOfValues == 13)
+    {
+      auto rigidObject = dynamic_cast<imstk::RigidObject2*>(object);
+      if (!rigidObject)
+      {
+        continue;
+      }
+      imstk::RigidBody* body = rigidObject->getRigidBody().get();
+      const imstk::Vec3d position(values[0], values[1], values[2]);
+      const imstk::Quatd orientation(values[3], values[4], values[5], values[6]);
+      const imstk::Vec3d velocity(values[7], values[8], values[9]);
+      const imstk::Vec3d angularVelocity(values[10], values[11], values[12]);
+      if (body->m_pos)
+      {
+        *body->m_pos = position;
+        *body->m_orientation = orientation;
+        *body->m_velocity = velocity;
+        *body->m_angularVelocity = angularVelocity;
+      }
+      else
+      {
+        body->m_initPos = position;
+        body->m_initOrientation = orientation;
+        body->m_initVelocity = velocity;
+        body->m_initAngularVelocity = angularVelocity;
+      }
+    }
+    else if (record.Type == vtkSlicerIMSTKSnapshot::VerticesRecord)
+    {
+      // After the transform record: getting the vertices applies the
+      // restored transform, then the restored vertices replace the result
+      auto pointSet = dynamic_cast<imstk::PointSet*>(geometry);
+      std::shared_ptr<imstk::VecDataArray<double, 3>> vertices = pointSet ? pointSet->getVertexPositions() : nullptr;
+      if (vertices && record.NumberOfValues == 3 * static_cast<std::uint32_t>(vertices->size()))
+      {
+        std::copy(values, values + record.NumberOfValues, vertices->getPointer()->data());
+        pointSet->postModified();
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::PushChange(Simulation& simulation, std::function<void()> change)
+{
+  // Stopped modules completed their last step. Scene managers advanced by
+  // the caller, and paused simulations, are changed before their next step.
+  if (HasModules(simulation) && !IsRunning(simulation))
+  {
+    change();
+    return;
+  }
+  simulation.Changes->Push(std::move(change));
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkSlicerIMSTKLogic::vtkInternal::GetClosedSurface(vtkMRMLNode* node,
+  const std::string& segmentId, std::string& key)
+{
+  if (!node || !node->GetID())
+  {
+    return nullptr;
+  }
+  vtkPolyData* surface = nullptr;
+  if (vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(node))
+  {
+    surface = modelNode->GetPolyData();
+    key = node->GetID();
+  }
+  else if (vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(node))
+  {
+    vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
+    if (!segmentation || segmentation->GetNumberOfSegments() == 0)
+    {
+      return nullptr;
+    }
+    const std::string id = segmentId.empty() ? segmentation->GetNthSegmentID(0) : segmentId;
+    vtkSegment* segment = segmentation->GetSegment(id);
+    if (!segment || !segmentationNode->CreateClosedSurfaceRepresentation())
+    {
+      return nullptr;
+    }
+    // The representation of the segment is used as is, so that its
+    // modification times keep the geometry cache entry valid.
+    surface = vtkPolyData::SafeDownCast(segment->GetRepresentation(
+      vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName()));
+    key = std::string(node->GetID()) + "/" + id;
+  }
+  if (!surface || surface->GetNumberOfPolys() == 0)
+  {
+    return nullptr;
+  }
+  vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+  polyData->ShallowCopy(surface);
+  return polyData;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKLogic::vtkInternal::AddRequest(std::function<int()> poll)
+{
+  const int requestId = this->NextRequestId++;
+  this->Requests[requestId].Poll = poll;
+  return requestId;
+}
+
+//----------------------------------------------------------------------------
+std::vector<int> vtkSlicerIMSTKLogic::vtkInternal::UpdateRequests()
+{
+  std::vector<int> finished;
+  std::size_t numberOfFinished = 0;
+  for (auto& x : this->Requests)
+  {
+    Request& request = x.second;
+    if (!request.Notified && request.Poll && request.State->load() == vtkSlicerIMSTKLogic::RequestPending)
+    {
+      request.State->store(request.Poll());
+    }
+    if (request.State->load() == vtkSlicerIMSTKLogic::RequestPending)
+    {
+      continue;
+    }
+    if (!request.Notified)
+    {
+      request.Notified = true;
+      request.Poll = nullptr;
+      finished.push_back(x.first);
+    }
+    numberOfFinished++;
+  }
+  // Forget the oldest finished requests
+  for (auto it = this->Requests.begin();
+    numberOfFinished > MaximumFinishedRequests && it != this->Requests.end();)
+  {
+    if (it->second.Notified)
+    {
+      it = this->Requests.erase(it);
+      numberOfFinished--;
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  return finished;
+}
+
+#ifdef Slicer_iMSTK_USE_RENDERING_VTK
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Add to \a driver a hidden iMSTK viewer of \a scene, rendering in its own
+/// thread, along with its mouse and keyboard controls.
+void AddHiddenViewer(std::shared_ptr<imstk::Scene> scene,
+                     std::shared_ptr<imstk::SceneManager> sceneManager,
+                     std::shared_ptr<imstk::SimulationManager> driver)
+{
+  imstk::imstkNew<imstk::VTKViewer> viewer;
+  viewer->setActiveScene(scene);
+  viewer->getVtkRenderWindow()->SetShowWindow(false);
+  driver->addModule(viewer);
+
+  imstk::imstkNew<imstk::MouseSceneControl> mouseControl(viewer->getMouseDevice());
+  mouseControl->setSceneManager(sceneManager);
+  viewer->addControl(mouseControl);
+
+  // The driver is not given to the keyboard control: the viewer is owned by
+  // the driver and would keep it alive after the simulation is released.
+  imstk::imstkNew<imstk::KeyboardSceneControl> keyControl(viewer->getKeyboardDevice());
+  keyControl->setSceneManager(sceneManager);
+  viewer->addControl(keyControl);
+}
+
+} // end of anonymous namespace
+#endif
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::vtkInternal::SetupModules(Simulation& simulation,
+  const std::vector<std::shared_ptr<imstk::Module>>& deviceManagers, bool headless)
+{
+  simulation.Modules.clear();
+  simulation.DriverModules.clear();
+  simulation.Driver = nullptr;
+#ifdef Slicer_iMSTK_USE_RENDERING_VTK
+  if (!headless)
+  {
+    // The viewer needs the render loop of a driver
+    imstk::imstkNew<imstk::SimulationManager> driver;
+    AddHiddenViewer(simulation.SceneManager->getActiveScene(), simulation.SceneManager, driver);
+    driver->addModule(simulation.SceneManager);
+    simulation.DriverModules.push_back(simulation.SceneManager);
+    for (const std::shared_ptr<imstk::Module>& deviceManager : deviceManagers)
+    {
+      driver->addModule(deviceManager);
+      simulation.DriverModules.push_back(deviceManager);
+    }
+    simulation.Driver = driver;
+    return;
+  }
+#else
+  (void)headless; // unused
+#endif
+  simulation.Modules.emplace_back(simulation.SceneManager, vtkSlicerIMSTKScheduler::PhysicsLane);
+  for (const std::shared_ptr<imstk::Module>& deviceManager : deviceManagers)
+  {
+    simulation.Modules.emplace_back(deviceManager, vtkSlicerIMSTKScheduler::HapticsLane);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerIMSTKLogic);
+
+const char* vtkSlicerIMSTKLogic::TimeStepAttributeName = "IMSTK.TimeStep";
+const char* vtkSlicerIMSTKLogic::TranslationScalingAttributeName = "IMSTK.TranslationScaling";
+const char* vtkSlicerIMSTKLogic::InputModelReferenceRole = "IMSTK.InputModel";
+const char* vtkSlicerIMSTKLogic::OutputModelReferenceRole = "IMSTK.OutputModel";
+const char* vtkSlicerIMSTKLogic::OutputTransformReferenceRole = "IMSTK.OutputTransform";
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKLogic::vtkSlicerIMSTKLogic()
+  : Headless(true)
+  , MRMLBatchThreshold(32)
+  , PoseExtrapolation(0.005)
+  , PrecomputeCollisionData(true)
+  , LevelOfDetailTriangles(10000)
+  , VolumeMeshCellSize(0.0)
+  , VolumeMeshMinimumQuality(0.1)
+  , MaximumNumberOfContacts(4096)
+  , ContactPublishPeriod(1.0 / 30.0)
+  , Internal(new vtkInternal)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKLogic::~vtkSlicerIMSTKLogic()
+{
+  // Stops and joins all the simulations
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Headless: " << (this->Headless ? "true" : "false") << "\n";
+  os << indent << "MRMLBatchThreshold: " << this->MRMLBatchThreshold << "\n";
+  os << indent << "PoseExtrapolation: " << this->PoseExtrapolation << "\n";
+  os << indent << "PrecomputeCollisionData: " << (this->PrecomputeCollisionData ? "true" : "false") << "\n";
+  os << indent << "LevelOfDetailTriangles: " << this->LevelOfDetailTriangles << "\n";
+  os << indent << "VolumeMeshCellSize: " << this->VolumeMeshCellSize << "\n";
+  os << indent << "VolumeMeshMinimumQuality: " << this->VolumeMeshMinimumQuality << "\n";
+  os << indent << "MaximumNumberOfContacts: " << this->MaximumNumberOfContacts << "\n";
+  os << indent << "ContactPublishPeriod: " << this->ContactPublishPeriod << "\n";
+  os << indent << "CollisionDataDirectory: " << this->CollisionDataDirectory << "\n";
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene)
+{
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLScene::NodeAddedEvent);
+  events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
+  events->InsertNextValue(vtkMRMLScene::EndBatchProcessEvent);
+  this->SetAndObserveMRMLSceneEventsInternal(newScene, events.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::RegisterNodes()
+{
+  assert(this->GetMRMLScene() != 0);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::UpdateFromMRMLScene()
+{
+  assert(this->GetMRMLScene() != 0);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic
+::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
+{
+  // Only the static obstacles collide through their signed distance field
+  vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(node);
+  if (!modelNode || !this->PrecomputeCollisionData
+    || vtkSlicerIMSTKSceneBuilder::GetObjectType(modelNode) != vtkSlicerIMSTKSceneBuilder::CollidingObject)
+  {
+    return;
+  }
+  if (modelNode->GetPolyData() && modelNode->GetPolyData()->GetNumberOfPolys() > 0)
+  {
+    this->precomputeCollisionData(modelNode);
+    return;
+  }
+  // Models loaded from file get their mesh after being added
+  if (modelNode->GetID())
+  {
+    this->Internal->AwaitingMesh.insert(modelNode->GetID());
+  }
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLModelNode::MeshModifiedEvent);
+  vtkObserveMRMLNodeEventsMacro(modelNode, events.GetPointer());
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic
+::ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData)
+{
+  vtkMRMLNode* node = vtkMRMLNode::SafeDownCast(caller);
+  const bool tuned = node && node->GetID() && this->Internal->TunedNodeIDs.count(node->GetID());
+  vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(caller);
+  if (modelNode && event == vtkMRMLModelNode::MeshModifiedEvent
+    && modelNode->GetID() && this->Internal->AwaitingMesh.erase(modelNode->GetID()))
+  {
+    // Only the first mesh is precomputed, later changes are usually edits or
+    // simulation outputs.
+    if (!tuned)
+    {
+      vtkUnObserveMRMLNodeMacro(modelNode);
+    }
+    if (this->PrecomputeCollisionData && modelNode->GetPolyData()
+      && modelNode->GetPolyData()->GetNumberOfPolys() > 0)
+    {
+      this->precomputeCollisionData(modelNode);
+    }
+  }
+  if (tuned)
+  {
+    this->ApplyTunedNodeChanges(node, event);
+    return;
+  }
+  if (modelNode && event == vtkMRMLModelNode::MeshModifiedEvent)
+  {
+    return;
+  }
+  this->Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic
+::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
+{
+  if (vtkMRMLModelNode::SafeDownCast(node) && node->GetID())
+  {
+    vtkUnObserveMRMLNodeMacro(node);
+    this->Internal->GeometryCache.Remove(node->GetID());
+    this->Internal->AwaitingMesh.erase(node->GetID());
+    this->Internal->TunedNodeIDs.erase(node->GetID());
+  }
+  else if (node && node->GetID() && this->Internal->TunedNodeIDs.erase(node->GetID()))
+  {
+    // Parameter node
+    vtkUnObserveMRMLNodeMacro(node);
+  }
+  vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(node);
+  if (segmentationNode && node->GetID() && segmentationNode->GetSegmentation())
+  {
+    std::vector<std::string> segmentIds;
+    segmentationNode->GetSegmentation()->GetSegmentIDs(segmentIds);
+    for (const std::string& segmentId : segmentIds)
+    {
+      this->Internal->GeometryCache.Remove(std::string(node->GetID()) + "/" + segmentId);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::UpdateTunedNodeObservations()
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  std::set<std::string> nodeIDs;
+  for (const auto& x : this->Internal->Simulations)
+  {
+    if (x.second.ParameterNode && x.second.ParameterNode->GetID())
+    {
+      nodeIDs.insert(x.second.ParameterNode->GetID());
+    }
+    for (const vtkSlicerIMSTKSceneBuilder::ObjectDescription& description : x.second.Descriptions)
+    {
+      nodeIDs.insert(description.NodeID);
+    }
+  }
+
+  for (const std::string& nodeID : this->Internal->TunedNodeIDs)
+  {
+    vtkMRMLNode* node = scene ? scene->GetNodeByID(nodeID) : nullptr;
+    if (!node || nodeIDs.count(nodeID))
+    {
+      continue;
+    }
+    vtkUnObserveMRMLNodeMacro(node);
+    if (this->Internal->AwaitingMesh.count(nodeID))
+    {
+      vtkNew<vtkIntArray> events;
+      events->InsertNextValue(vtkMRMLModelNode::MeshModifiedEvent);
+      vtkObserveMRMLNodeEventsMacro(node, events.GetPointer());
+    }
+  }
+
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkCommand::ModifiedEvent);
+  events->InsertNextValue(vtkMRMLNode::ReferenceAddedEvent);
+  events->InsertNextValue(vtkMRMLNode::ReferenceModifiedEvent);
+  events->InsertNextValue(vtkMRMLNode::ReferenceRemovedEvent);
+  events->InsertNextValue(vtkMRMLModelNode::MeshModifiedEvent);
+  events->InsertNextValue(vtkMRMLModelNode::DisplayModifiedEvent);
+  events->InsertNextValue(vtkMRMLTransformableNode::TransformModifiedEvent);
+  for (const std::string& nodeID : nodeIDs)
+  {
+    vtkMRMLNode* node = scene ? scene->GetNodeByID(nodeID) : nullptr;
+    if (node && !this->Internal->TunedNodeIDs.count(nodeID))
+    {
+      vtkObserveMRMLNodeEventsMacro(node, events.GetPointer());
+    }
+  }
+  this->Internal->TunedNodeIDs = nodeIDs;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::ApplyTunedNodeChanges(vtkMRMLNode* node, unsigned long event)
+{
+  // Rebuilds reset the simulations, they are done after the loop
+  std::vector<std::function<void()>> rebuilds;
+  vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(node);
+  for (auto& x : this->Internal->Simulations)
+  {
+    vtkInternal::Simulation& simulation = x.second;
+    bool updated = true;
+    if (simulation.ParameterNode == node)
+    {
+      updated = this->Internal->ApplyParameters(simulation);
+    }
+    for (std::size_t i = 0; updated && modelNode && i < simulation.Descriptions.size(); i++)
+    {
+      if (simulation.Descriptions[i].NodeID == node->GetID())
+      {
+        updated = this->Internal->UpdateObject(simulation, i, modelNode, event);
+      }
+    }
+    if (!updated && simulation.Rebuild)
+    {
+      rebuilds.push_back(simulation.Rebuild);
+      // Rebuilt once, whatever the number of changes until then
+      simulation.Descriptions.clear();
+      simulation.Rebuild = nullptr;
+    }
+  }
+  for (const std::function<void()>& rebuild : rebuilds)
+  {
+    rebuild();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::registerSimulation(std::string simName, std::shared_ptr<imstk::SceneManager> sceneManager)
+{
+  this->Internal->ResetSimulation(simName, sceneManager);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::runHapticDeviceExample(std::string simName, std::string deviceName, vtkMRMLLinearTransformNode* outputTransformNode)
+{
+  this->runHapticDevicesExample(simName,
+    std::vector<std::string>(1, deviceName),
+    std::vector<vtkMRMLLinearTransformNode*>(1, outputTransformNode));
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::runHapticDevicesExample(std::string simName,
+  const std::vector<std::string>& deviceNames,
+  const std::vector<vtkMRMLLinearTransformNode*>& outputTransformNodes)
+{
+#ifdef Slicer_iMSTK_USE_OpenHaptics
+  if (deviceNames.empty() || deviceNames.size() != outputTransformNodes.size())
+  {
+    vtkErrorMacro("runHapticDevicesExample: device names and output transforms must have the same non-zero size");
+    return;
+  }
+
+  imstk::imstkNew<imstk::Scene>               scene("SDFHaptics");
+
+  {
+    scene->getActiveCamera()->setPosition(-2.3, 23.81, 45.65);
+    scene->getActiveCamera()->setFocalPoint(9.41, 8.45, 5.76);
+
+    // Light (white)
+    imstk::imstkNew<imstk::DirectionalLight> whiteLight;
+    {
+      whiteLight->setDirection(imstk::Vec3d(0.0, -8.0, -5.0));
+      whiteLight->setIntensity(1.0);
+      scene->addLight("whitelight", whiteLight);
+    }
+  }
+
+  // Devices, or the recorded sessions of each device replayed instead. A
+  // single manager serves all the devices.
+  std::vector<std::shared_ptr<imstk::DeviceClient>> clients;
+  std::vector<std::shared_ptr<vtkSlicerIMSTKReplayDeviceClient>> replayClients;
+  std::vector<std::shared_ptr<imstk::Module>> deviceManagers;
+  std::shared_ptr<imstk::HapticDeviceManager> hapticManager;
+  for (std::size_t i = 0; i < deviceNames.size(); i++)
+  {
+    std::shared_ptr<vtkSlicerIMSTKReplayDeviceClient> replayClient =
+      this->Internal->MakeReplayClient(static_cast<int>(i));
+    replayClients.push_back(replayClient);
+    if (replayClient)
+    {
+      clients.push_back(replayClient);
+      continue;
+    }
+    if (!hapticManager)
+    {
+      hapticManager = std::make_shared<imstk::HapticDeviceManager>();
+      deviceManagers.push_back(hapticManager);
+    }
+    clients.push_back(hapticManager->makeDeviceClient(deviceNames[i]));
+  }
+
+  // Run the simulation
+  {
+    // Setup a scene manager to advance the scene in its own thread
+    imstk::imstkNew<imstk::SceneManager> sceneManager;
+    sceneManager->setActiveScene(scene);
+
+    vtkInternal::Simulation& simulation = this->Internal->ResetSimulation(simName, sceneManager);
+    this->Internal->SetupModules(simulation, deviceManagers, this->Headless);
+    std::shared_ptr<vtkSlicerIMSTKSessionLog> recorder = simulation.Recorder;
+    std::shared_ptr<vtkSlicerIMSTKPoseSharedMemory> poseExport = this->Internal->PoseExport;
+    const double period = this->Internal->Scheduler.GetLanePeriod(vtkSlicerIMSTKScheduler::HapticsLane);
+    for (std::size_t i = 0; i < clients.size(); i++)
+    {
+      vtkMRMLLinearTransformNode* outputTransformNode = outputTransformNodes[i];
+      auto observer = this->Internal->AddTransformObserver(simulation, outputTransformNode, /* toParent= */ true);
+
+      // Sample each device at its own rate instead of the physics rate, in
+      // its own task: a device still being sampled when its next sample is
+      // due skips that sample. The tasks share the workers of the haptics
+      // lane, a single one by default, so a slow device still delays the
+      // others.
+      auto poseSamples = std::make_shared<vtkSlicerIMSTKPoseRingBuffer>();
+      observer->PoseSamples = poseSamples;
+      // The device pose is exported at the device rate
+      const std::string deviceName = !deviceNames[i].empty() ? deviceNames[i] : "Device" + std::to_string(i);
+      const int poseExportIndex = this->Internal->AddExportedPose(simulation, "Device" + std::to_string(i),
+        outputTransformNode && outputTransformNode->GetName() && *outputTransformNode->GetName()
+          ? outputTransformNode->GetName() : deviceName);
+      const int stream = static_cast<int>(i);
+      std::shared_ptr<imstk::DeviceClient> client = clients[i];
+      std::shared_ptr<vtkSlicerIMSTKReplayDeviceClient> replayClient = replayClients[i];
+      auto sampleDevice =
+        [client, poseSamples, recorder, stream, poseExport, poseExportIndex]()
+        {
+          vtkSlicerIMSTKPoseRingBuffer::Sample sample;
+          sample.Timestamp = vtkSlicerIMSTKPoseRingBuffer::ClockType::now();
+          const imstk::Vec3d position = client->getPosition();
+          const imstk::Quatd orientation = client->getOrientation().normalized();
+          sample.Position = { { position[0], position[1], position[2] } };
+          sample.Orientation = { { orientation.w(), orientation.x(), orientation.y(), orientation.z() } };
+          poseSamples->Push(sample);
+          // Queued without locking, written by the main thread
+          if (recorder->IsRecording())
+          {
+            recorder->RecordDevicePose(stream, sample.Timestamp, sample.Position, sample.Orientation);
+          }
+          if (poseExportIndex >= 0)
+          {
+            double matrix[16];
+            vtkSlicerIMSTKPoseRingBuffer::ToMatrix(sample.Position, sample.Orientation, matrix);
+            poseExport->Publish(poseExportIndex, matrix, sample.Timestamp);
+          }
+        };
+      if (replayClient && !replayClient->GetRealTime())
+      {
+        // Replays in simulation time follow the scene steps rather than the
+        // haptics lane, so that batch runs replay them too. The callback
+        // does not capture the scene manager, which owns it.
+        imstk::SceneManager* sceneManagerPtr = sceneManager.get();
+        imstk::connect<imstk::Event>(sceneManager, &imstk::SceneManager::preUpdate,
+          [observer, replayClient, sampleDevice, sceneManagerPtr](imstk::Event*)
+          {
+            if (!observer->Active.load(std::memory_order_acquire))
+            {
+              return;
+            }
+            replayClient->Advance(sceneManagerPtr->getDt());
+            sampleDevice();
+          });
+        continue;
+      }
+      simulation.Samplers.emplace_back(
+        [replayClient, sampleDevice, period]()
+        {
+          if (replayClient)
+          {
+            replayClient->Advance(period);
+          }
+          sampleDevice();
+        },
+        vtkSlicerIMSTKScheduler::HapticsLane);
+    }
+
+    this->Internal->StartModules(simulation);
+  }
+#else
+  (void)simName; // unused
+  (void)deviceNames; // unused
+  (void)outputTransformNodes; // unused
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::runObjectCtrlDummyClientExample(std::string simName, vtkMRMLModelNode* inputNode, vtkMRMLModelNode* outputNode, vtkMRMLLinearTransformNode* outputTransformNode)
+{
+
+  imstk::imstkNew<imstk::Scene> scene("ObjectControllerDummyClient");
+
+  // The object is moved by its controller, use a copy of the cached mesh
+  auto geom = this->Internal->GeometryCache.GetSurfaceMeshCopy(inputNode->GetID(), inputNode->GetPolyData());
+
+  imstk::imstkNew<imstk::CollidingObject> object("VirtualObject");
+  object->setVisualGeometry(geom);
+  object->setCollidingGeometry(geom);
+  scene->addSceneObject(object);
+
+  // Update Camera position
+  scene->getActiveCamera()->setPosition(0.0, 0.0, 10.0);
+  scene->getActiveCamera()->setFocalPoint(0, 0, 0);
+
+  // Device Client, replaying a recorded session if any
+  std::shared_ptr<vtkSlicerIMSTKReplayDeviceClient> replayClient = this->Internal->MakeReplayClient();
+  std::shared_ptr<imstk::DummyClient> client = replayClient;
+  if (!client)
+  {
+    client = std::make_shared<imstk::DummyClient>("DummyClient");
+  }
+  imstk::imstkNew<imstk::SceneObjectController> controller(object, client);
+  scene->addController(controller);
+
+  // Run the simulation
+  {
+    // Setup a scene manager to advance the scene in its own thread
+    imstk::imstkNew<imstk::SceneManager> sceneManager;
+    sceneManager->setActiveScene(scene);
+
+    vtkInternal::Simulation& simulation = this->Internal->ResetSimulation(simName, sceneManager);
+
+    // The callback outlives this function: capture by value only, and not the
+    // scene manager itself, which owns the callback.
+    std::shared_ptr<imstk::DummyClient> deviceClient = client;
+    std::shared_ptr<vtkSlicerIMSTKSessionLog> recorder = simulation.Recorder;
+    imstk::SceneManager* sceneManagerPtr = sceneManager.get();
+    imstk::connect<imstk::Event>(sceneManager, &imstk::SceneManager::postUpdate,
+      [deviceClient, replayClient, recorder, sceneManagerPtr, t = 0.0](imstk::Event*) mutable
+      {
+        if (replayClient)
+        {
+          replayClient->Advance(sceneManagerPtr->getDt());
+        }
+        else
+        {
+          t += sceneManagerPtr->getDt();
+          deviceClient->setPosition(imstk::Vec3d(cos(t) * 10.0, sin(t) * 5.0, 0.0));
+        }
+        if (recorder->IsRecording())
+        {
+          const imstk::Vec3d position = deviceClient->getPosition();
+          const imstk::Quatd orientation = deviceClient->getOrientation();
+          recorder->RecordDevicePose(0, vtkSlicerIMSTKSessionLog::ClockType::now(),
+            { { position[0], position[1], position[2] } },
+            { { orientation.w(), orientation.x(), orientation.y(), orientation.z() } });
+        }
+      });
+
+    this->observeRigidBody(sceneManager, object, outputNode, outputTransformNode);
+
+    // Follow the parameter node and the edits of the input model. The pose
+    // of the object is set by its controller, like the pose of rigid objects.
+    vtkSlicerIMSTKSceneBuilder::ObjectDescription description;
+    description.Type = vtkSlicerIMSTKSceneBuilder::RigidObject;
+    if (vtkSlicerIMSTKSceneBuilder::DescribeObject(inputNode, description))
+    {
+      simulation.Descriptions.push_back(description);
+      simulation.Objects.push_back(object);
+    }
+    simulation.Controllers.push_back(controller);
+    simulation.InputModelID = inputNode->GetID();
+    simulation.OutputTransformID = outputTransformNode->GetID();
+    vtkWeakPointer<vtkMRMLModelNode> input = inputNode;
+    vtkWeakPointer<vtkMRMLModelNode> output = outputNode;
+    vtkWeakPointer<vtkMRMLLinearTransformNode> outputTransform = outputTransformNode;
+    simulation.Rebuild = [this, simName, input, output, outputTransform]()
+    {
+      // The references of the parameter node replace the initial nodes
+      vtkMRMLNode* parameterNode = this->getParameterNode(simName);
+      vtkMRMLModelNode* inputModel = vtkMRMLModelNode::SafeDownCast(
+        parameterNode ? parameterNode->GetNodeReference(InputModelReferenceRole) : nullptr);
+      vtkMRMLModelNode* outputModel = vtkMRMLModelNode::SafeDownCast(
+        parameterNode ? parameterNode->GetNodeReference(OutputModelReferenceRole) : nullptr);
+      vtkMRMLLinearTransformNode* transform = vtkMRMLLinearTransformNode::SafeDownCast(
+        parameterNode ? parameterNode->GetNodeReference(OutputTransformReferenceRole) : nullptr);
+      inputModel = inputModel ? inputModel : input.GetPointer();
+      outputModel = outputModel ? outputModel : output.GetPointer();
+      transform = transform ? transform : outputTransform.GetPointer();
+      if (inputModel && outputModel && transform)
+      {
+        this->runObjectCtrlDummyClientExample(simName, inputModel, outputModel, transform);
+      }
+    };
+    this->Internal->ApplyParameters(simulation);
+    this->UpdateTunedNodeObservations();
+
+    this->Internal->SetupModules(simulation, std::vector<std::shared_ptr<imstk::Module>>(), this->Headless);
+    this->Internal->StartModules(simulation);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::observeRigidBody(std::shared_ptr<imstk::SceneManager> sceneManager, std::shared_ptr<imstk::SceneObject> object, vtkMRMLModelNode* outputNode, vtkMRMLLinearTransformNode* outputTransformNode)
+{
+  this->observeRigidBodies(sceneManager,
+    std::vector<std::shared_ptr<imstk::SceneObject>>(1, object),
+    std::vector<vtkMRMLModelNode*>(1, outputNode),
+    std::vector<vtkMRMLLinearTransformNode*>(1, outputTransformNode));
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::observeRigidBodies(std::shared_ptr<imstk::SceneManager> sceneManager,
+  const std::vector<std::shared_ptr<imstk::SceneObject>>& objects,
+  const std::vector<vtkMRMLModelNode*>& outputNodes,
+  const std::vector<vtkMRMLLinearTransformNode*>& outputTransformNodes)
+{
+  if (objects.size() != outputNodes.size() || objects.size() != outputTransformNodes.size())
+  {
+    vtkErrorMacro("observeRigidBodies: objects, output models and output transforms must have the same size");
+    return;
+  }
+
+  vtkInternal::Simulation* simulation = this->Internal->FindSimulation(sceneManager.get());
+  if (!simulation)
+  {
+    vtkErrorMacro("observeRigidBodies: scene manager is not associated with any simulation");
+    return;
+  }
+
+  std::vector<std::shared_ptr<imstk::Geometry>> geometries;
+  std::vector<vtkMRMLLinearTransformNode*> transformNodes;
+  for (std::size_t i = 0; i < objects.size(); i++)
+  {
+    auto mesh = std::dynamic_pointer_cast<imstk::SurfaceMesh>(objects[i]->getVisualGeometry());
+    if (!mesh)
+    {
+      vtkErrorMacro("observeRigidBodies: visual geometry of " << objects[i]->getName() << " is not a surface mesh");
+      continue;
+    }
+    vtkSmartPointer<vtkPolyData> polyDataOutput = vtkSlicerIMSTKGeometryConversion::ToPolyData(mesh);
+    outputNodes[i]->SetAndObservePolyData(polyDataOutput);
+    outputNodes[i]->SetAndObserveTransformNodeID(outputTransformNodes[i]->GetID());
+
+    // Geometries are resolved once, the callback only gathers their transforms
+    geometries.push_back(mesh);
+    transformNodes.push_back(outputTransformNodes[i]);
+  }
+  if (!geometries.empty())
+  {
+    this->Internal->AddTransformBatch(*simulation, geometries, transformNodes);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::observeDeformableBody(std::shared_ptr<imstk::SceneManager> sceneManager, std::shared_ptr<imstk::SceneObject> object, vtkMRMLModelNode* outputNode, bool updateNormals, bool sharedBuffer)
+{
+  auto mesh = std::dynamic_pointer_cast<imstk::SurfaceMesh>(object->getVisualGeometry());
+  if (!mesh)
+  {
+    vtkErrorMacro("observeDeformableBody: visual geometry of " << object->getName() << " is not a surface mesh");
+    return;
+  }
+
+  vtkInternal::Simulation* simulation = this->Internal->FindSimulation(sceneManager.get());
+  if (!simulation)
+  {
+    vtkErrorMacro("observeDeformableBody: scene manager is not associated with any simulation");
+    return;
+  }
+
+  auto observer = std::make_shared<vtkInternal::MeshObserver>();
+  observer->ModelNode = outputNode;
+  observer->Vertices = mesh->getVertexPositions();
+  observer->Triangles = mesh->getTriangleIndices();
+  observer->UpdateNormals = updateNormals;
+  observer->SharedBuffer = sharedBuffer;
+  // Connectivity is converted once and never updated afterward
+  observer->PolyData = vtkSlicerIMSTKGeometryConversion::ToPolyData(mesh);
+  this->Internal->AddMeshObserver(*simulation, sceneManager, observer);
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<imstk::SurfaceMesh> vtkSlicerIMSTKLogic::getLevelOfDetail(vtkMRMLModelNode* modelNode)
+{
+  if (!modelNode || !modelNode->GetID() || !modelNode->GetPolyData() || this->LevelOfDetailTriangles <= 0)
+  {
+    return nullptr;
+  }
+  std::shared_ptr<const vtkSlicerIMSTKLevelOfDetail::Level> level = vtkSlicerIMSTKLevelOfDetail::Get(
+    &this->Internal->GeometryCache, modelNode->GetID(), modelNode->GetPolyData(), this->LevelOfDetailTriangles);
+  return level ? vtkSlicerIMSTKGeometryConversion::Copy(level->Mesh) : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::observeDecimatedBody(std::shared_ptr<imstk::SceneManager> sceneManager, std::shared_ptr<imstk::SceneObject> object, vtkMRMLModelNode* outputNode, bool updateNormals)
+{
+  auto mesh = std::dynamic_pointer_cast<imstk::SurfaceMesh>(object->getVisualGeometry());
+  if (!mesh)
+  {
+    vtkErrorMacro("observeDecimatedBody: visual geometry of " << object->getName() << " is not a surface mesh");
+    return;
+  }
+
+  vtkInternal::Simulation* simulation = this->Internal->FindSimulation(sceneManager.get());
+  if (!simulation)
+  {
+    vtkErrorMacro("observeDecimatedBody: scene manager is not associated with any simulation");
+    return;
+  }
+
+  if (!outputNode || !outputNode->GetID() || !outputNode->GetPolyData() || this->LevelOfDetailTriangles <= 0)
+  {
+    vtkErrorMacro("observeDecimatedBody: invalid output model or level of detail");
+    return;
+  }
+  vtkSlicerIMSTKGeometryCache* cache = &this->Internal->GeometryCache;
+  std::shared_ptr<imstk::SurfaceMesh> fullResolution = cache->GetSurfaceMesh(outputNode->GetID(), outputNode->GetPolyData());
+  std::shared_ptr<const vtkSlicerIMSTKLevelOfDetail::Level> level = vtkSlicerIMSTKLevelOfDetail::Get(
+    cache, outputNode->GetID(), outputNode->GetPolyData(), this->LevelOfDetailTriangles);
+  if (!fullResolution || !level || level->GetNumberOfPoints() != fullResolution->getNumVertices()
+    || mesh->getNumVertices() != level->Mesh->getNumVertices()
+    || mesh->getNumTriangles() != level->Mesh->getNumTriangles())
+  {
+    vtkErrorMacro("observeDecimatedBody: visual geometry of " << object->getName()
+      << " is not the level of detail of " << outputNode->GetName());
+    return;
+  }
+
+  auto observer = std::make_shared<vtkInternal::MeshObserver>();
+  observer->ModelNode = outputNode;
+  observer->LevelOfDetail = level;
+  observer->DecimatedVertices = mesh->getVertexPositions();
+  observer->DecimatedTriangles = mesh->getTriangleIndices();
+  observer->Vertices = std::make_shared<imstk::VecDataArray<double, 3>>(level->GetNumberOfPoints());
+  observer->Triangles = fullResolution->getTriangleIndices();
+  observer->UpdateNormals = updateNormals;
+  observer->ApplyLevelOfDetail();
+  observer->PolyData = vtkSlicerIMSTKGeometryConversion::ToPolyData(fullResolution);
+  this->Internal->AddMeshObserver(*simulation, sceneManager, observer);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::observeContacts(std::shared_ptr<imstk::SceneManager> sceneManager,
+  const std::vector<std::shared_ptr<imstk::CollisionData>>& collisionData, vtkMRMLModelNode* outputNode)
+{
+  vtkInternal::Simulation* simulation = this->Internal->FindSimulation(sceneManager.get());
+  if (!simulation)
+  {
+    vtkErrorMacro("observeContacts: scene manager is not associated with any simulation");
+    return;
+  }
+  if (!outputNode)
+  {
+    vtkErrorMacro("observeContacts: invalid output model");
+    return;
+  }
+  this->Internal->AddContactObserver(*simulation, collisionData, outputNode,
+    this->MaximumNumberOfContacts, this->ContactPublishPeriod);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::setContactOutput(std::string simName, vtkMRMLModelNode* outputNode)
+{
+  this->Internal->Simulations[simName].ContactModelNode = outputNode;
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLModelNode* vtkSlicerIMSTKLogic::getContactOutput(std::string simName)
+{
+  auto it = this->Internal->Simulations.find(simName);
+  return it != this->Internal->Simulations.end() ? it->second.ContactModelNode.GetPointer() : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::stopSimulation(std::string simName)
+{
+  auto build = this->Internal->SceneBuilds.find(simName);
+  if (build != this->Internal->SceneBuilds.end())
+  {
+    build->second.Start = false;
+  }
+  auto simulation = this->Internal->Simulations.find(simName);
+  if (simulation != this->Internal->Simulations.end())
+  {
+    this->Internal->StopModules(simulation->second);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::startSimulation(std::string simName, bool reset)
+{
+  auto it = this->Internal->Simulations.find(simName);
+  if (it == this->Internal->Simulations.end() || !vtkInternal::HasModules(it->second))
+  {
+    vtkErrorMacro("startSimulation: " << simName << " has no scene to start");
+    return;
+  }
+  vtkInternal::Simulation& simulation = it->second;
+  if (vtkInternal::IsRunning(simulation))
+  {
+    return;
+  }
+  if (reset)
+  {
+    simulation.SceneManager->getActiveScene()->reset();
+  }
+  simulation.Sync->ResetCounters();
+  this->Internal->StartModules(simulation);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::pauseSimulation(std::string simName)
+{
+  if (this->getSimulationState(simName) != SimulationRunning)
+  {
+    return;
+  }
+  // Known to exist, see getSimulationState()
+  this->Internal->SetPaused(this->Internal->Simulations.find(simName)->second, true);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::resumeSimulation(std::string simName)
+{
+  if (this->getSimulationState(simName) != SimulationPaused)
+  {
+    return;
+  }
+  // Known to exist, see getSimulationState()
+  this->Internal->SetPaused(this->Internal->Simulations.find(simName)->second, false);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::releaseSimulation(std::string simName)
+{
+  if (this->Internal->BatchRuns.count(simName))
+  {
+    vtkErrorMacro("releaseSimulation: " << simName << " is being run by runBatchSimulation()");
+    return;
+  }
+  this->stopSimulation(simName);
+  auto it = this->Internal->Simulations.find(simName);
+  if (it != this->Internal->Simulations.end())
+  {
+    // Move the rigid models back under the transform they were authored under
+    vtkMRMLScene* mrmlScene = this->GetMRMLScene();
+    for (const vtkSlicerIMSTKSceneBuilder::ObjectDescription& description : it->second.Descriptions)
+    {
+      vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(
+        mrmlScene ? mrmlScene->GetNodeByID(description.NodeID) : nullptr);
+      if (description.Type == vtkSlicerIMSTKSceneBuilder::RigidObject && modelNode)
+      {
+        vtkSlicerIMSTKSceneBuilder::RestoreAuthoredParent(modelNode);
+      }
+    }
+    // Drops the last references to the scene, its modules and observers
+    vtkInternal::DetachObservers(it->second);
+    this->Internal->Simulations.erase(it);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerIMSTKLogic::getSimulationState(std::string simName)
+{
+  auto it = this->Internal->Simulations.find(simName);
+  if (it == this->Internal->Simulations.end() || !vtkInternal::HasModules(it->second))
+  {
+    return SimulationNone;
+  }
+  const vtkInternal::Simulation& simulation = it->second;
+  if (!vtkInternal::IsRunning(simulation))
+  {
+    return SimulationStopped;
+  }
+  return simulation.Paused ? SimulationPaused : SimulationRunning;
+}
+
+//-----------------------------------------------------------------------------
+vtkSlicerIMSTKLogic::BatchStatistics vtkSlicerIMSTKLogic::runBatchSimulation(std::string simName,
+  int numberOfSteps, double dt, int syncInterval, bool reset)
+{
+  auto it = this->Internal->Simulations.find(simName);
+  if (it == this->Internal->Simulations.end() || !it->second.SceneManager)
+  {
+    vtkErrorMacro("runBatchSimulation: " << simName << " has no scene to run");
+    return BatchStatistics();
+  }
+  if (this->Internal->BatchRuns.count(simName))
+  {
+    vtkErrorMacro("runBatchSimulation: " << simName << " is already being run");
+    return BatchStatistics();
+  }
+  this->stopSimulation(simName);
+  std::function<void(int)> onStep;
+  if (syncInterval > 0)
+  {
+    onStep = [this, syncInterval](int step)
+    {
+      if (step % syncInterval == 0)
+      {
+        this->processPendingUpdates();
+      }
+    };
+  }
+  // Scenes built meanwhile replace the simulation once the run completes
+  this->Internal->BatchRuns.insert(simName);
+  BatchStatistics statistics = this->Internal->RunBatch(it->second, numberOfSteps, dt, reset, onStep);
+  this->Internal->BatchRuns.erase(simName);
+  this->processPendingUpdates();
+  return statistics;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<vtkSlicerIMSTKLogic::BatchStatistics> vtkSlicerIMSTKLogic::runBatchSimulations(
+  const std::vector<std::string>& simNames, int numberOfSteps, double dt, bool reset)
+{
+  std::vector<vtkInternal::Simulation*> simulations;
+  std::set<std::string> names;
+  for (const std::string& simName : simNames)
+  {
+    auto it = this->Internal->Simulations.find(simName);
+    if (it == this->Internal->Simulations.end() || !it->second.SceneManager)
+    {
+      vtkErrorMacro("runBatchSimulations: " << simName << " has no scene to run");
+      return std::vector<BatchStatistics>();
+    }
+    // Each scene manager must be stepped by a single worker
+    if (!names.insert(simName).second || this->Internal->BatchRuns.count(simName))
+    {
+      vtkErrorMacro("runBatchSimulations: " << simName << " is run more than once");
+      return std::vector<BatchStatistics>();
+    }
+    simulations.push_back(&it->second);
+  }
+  for (const std::string& simName : simNames)
+  {
+    this->stopSimulation(simName);
+  }
+  // Scenes are independent, each one is advanced by a single worker
+  std::vector<BatchStatistics> statistics(simulations.size());
+  tbb::parallel_for(std::size_t(0), simulations.size(),
+    [&](std::size_t i)
+    {
+      statistics[i] = this->Internal->RunBatch(*simulations[i], numberOfSteps, dt, reset, nullptr);
+    });
+  this->processPendingUpdates();
+  return statistics;
+}
+
+//-----------------------------------------------------------------------------
+vtkDoubleArray* vtkSlicerIMSTKLogic::getBatchTrajectory(std::string simName)
+{
+  auto it = this->Internal->Simulations.find(simName);
+  return it != this->Internal->Simulations.end() ? it->second.BatchTrajectory.GetPointer() : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::buildSceneFromMRML(std::string simName)
+{
+  if (!this->GetMRMLScene())
+  {
+    vtkErrorMacro("buildSceneFromMRML: no scene");
+    return;
+  }
+  if (this->isBuildingScene(simName))
+  {
+    vtkWarningMacro("buildSceneFromMRML: " << simName << " is already being built");
+    return;
+  }
+
+  vtkInternal::SceneBuild& build = this->Internal->SceneBuilds[simName];
+  build.Description = vtkSlicerIMSTKSceneBuilder::Describe(this->GetMRMLScene(), simName);
+  build.Description.CollisionDataDirectory = this->getCollisionDataDirectory();
+  build.Description.LevelOfDetailTriangles = this->LevelOfDetailTriangles;
+  const vtkSlicerIMSTKSceneBuilder::SceneDescription* description = &build.Description;
+  vtkSlicerIMSTKGeometryCache* cache = &this->Internal->GeometryCache;
+  build.Result = std::async(std::launch::async,
+    [description, cache]()
+    {
+      return vtkSlicerIMSTKSceneBuilder::Build(*description, cache);
+    });
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::isBuildingScene(std::string simName)
+{
+  return this->Internal->SceneBuilds.count(simName) > 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerIMSTKLogic::buildSceneFromMRMLAsync(std::string simName)
+{
+  const int requestId = this->Internal->AddRequest();
+  std::shared_ptr<std::atomic<int>> state = this->Internal->Requests[requestId].State;
+  if (this->isBuildingScene(simName))
+  {
+    vtkWarningMacro("buildSceneFromMRMLAsync: " << simName << " is already being built");
+    state->store(RequestFailed);
+    return requestId;
+  }
+  this->buildSceneFromMRML(simName);
+  auto build = this->Internal->SceneBuilds.find(simName);
+  if (build == this->Internal->SceneBuilds.end())
+  {
+    state->store(RequestFailed);
+    return requestId;
+  }
+  build->second.RequestState = state;
+  return requestId;
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerIMSTKLogic::startSimulationAsync(std::string simName, bool reset)
+{
+  this->startSimulation(simName, reset);
+  auto it = this->Internal->Simulations.find(simName);
+  if (it == this->Internal->Simulations.end() || !vtkInternal::IsRunning(it->second))
+  {
+    const int requestId = this->Internal->AddRequest();
+    this->Internal->Requests[requestId].State->store(RequestFailed);
+    return requestId;
+  }
+  vtkInternal* internal = this->Internal;
+  if (it->second.Driver)
+  {
+    // The driver initializes its modules in its own thread, without notice:
+    // poll their state. The driver thread of each start has its own flag.
+    std::shared_ptr<std::atomic<bool>> finished = it->second.Finished;
+    std::vector<std::shared_ptr<imstk::Module>> modules = it->second.DriverModules;
+    return this->Internal->AddRequest(
+      [internal, simName, finished, modules]()
+      {
+        auto simulation = internal->Simulations.find(simName);
+        if (simulation == internal->Simulations.end() || simulation->second.Finished != finished
+          || finished->load())
+        {
+          // Stopped, or restarted
+          return static_cast<int>(RequestCanceled);
+        }
+        for (const std::shared_ptr<imstk::Module>& module : modules)
+        {
+          if (!module->getInit())
+          {
+            return static_cast<int>(RequestPending);
+          }
+        }
+        return static_cast<int>(RequestCompleted);
+      });
+  }
+  std::shared_ptr<std::atomic<int>> initializedModules = it->second.InitializedModules;
+  const int numberOfModules = static_cast<int>(it->second.Modules.size());
+  return this->Internal->AddRequest(
+    [internal, simName, initializedModules, numberOfModules]()
+    {
+      auto simulation = internal->Simulations.find(simName);
+      if (simulation == internal->Simulations.end() || simulation->second.InitializedModules != initializedModules)
+      {
+        // Stopped and restarted, or reset
+        return static_cast<int>(RequestCanceled);
+      }
+      if (initializedModules->load() >= numberOfModules)
+      {
+        return static_cast<int>(RequestCompleted);
+      }
+      return static_cast<int>(vtkInternal::IsRunning(simulation->second) ? RequestPending : RequestCanceled);
+    });
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerIMSTKLogic::precomputeCollisionDataAsync(vtkMRMLModelNode* modelNode)
+{
+  if (!modelNode || !modelNode->GetID() || !modelNode->GetPolyData())
+  {
+    const int requestId = this->Internal->AddRequest();
+    this->Internal->Requests[requestId].State->store(RequestFailed);
+    return requestId;
+  }
+  this->precomputeCollisionData(modelNode);
+  vtkInternal* internal = this->Internal;
+  const std::string key = modelNode->GetID();
+  const std::string directory = this->getCollisionDataDirectory();
+  return this->Internal->AddRequest(
+    [internal, key, directory]()
+    {
+      {
+        std::lock_guard<std::mutex> lock(internal->CollisionDataMutex);
+        if (internal->PendingCollisionData.count(key))
+        {
+          return static_cast<int>(RequestPending);
+        }
+      }
+      return static_cast<int>(vtkSlicerIMSTKCollisionData::Find(&internal->GeometryCache, key, directory)
+        ? RequestCompleted : RequestFailed);
+    });
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerIMSTKLogic::generateVolumeMeshAsync(vtkMRMLNode* node, std::string segmentId)
+{
+  std::string key;
+  if (!vtkInternal::GetClosedSurface(node, segmentId, key))
+  {
+    vtkErrorMacro("generateVolumeMeshAsync: no closed surface to tetrahedralize");
+    const int requestId = this->Internal->AddRequest();
+    this->Internal->Requests[requestId].State->store(RequestFailed);
+    return requestId;
+  }
+  this->generateVolumeMesh(node, segmentId);
+  vtkInternal* internal = this->Internal;
+  vtkSlicerIMSTKVolumeMesh::Parameters parameters;
+  parameters.CellSize = this->VolumeMeshCellSize;
+  parameters.MinimumQuality = this->VolumeMeshMinimumQuality;
+  const std::string directory = this->getCollisionDataDirectory();
+  return this->Internal->AddRequest(
+    [internal, key, parameters, directory]()
+    {
+      {
+        std::lock_guard<std::mutex> lock(internal->CollisionDataMutex);
+        if (internal->PendingVolumeMeshes.count(key))
+        {
+          return static_cast<int>(RequestPending);
+        }
+      }
+      return static_cast<int>(vtkSlicerIMSTKVolumeMesh::Find(&internal->GeometryCache, key, parameters, directory)
+        ? RequestCompleted : RequestFailed);
+    });
+}
+
+//-----------------------------------------------------------------------------
+int vtkSlicerIMSTKLogic::getRequestState(int requestId)
+{
+  auto it = this->Internal->Requests.find(requestId);
+  return it != this->Internal->Requests.end() ? it->second.State->load() : -1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::startBuiltScene(const std::string& simName)
+{
+  auto it = this->Internal->SceneBuilds.find(simName);
+  const vtkSlicerIMSTKSceneBuilder::BuiltScene built = it->second.Result.get();
+  const vtkSlicerIMSTKSceneBuilder::SceneDescription description = std::move(it->second.Description);
+  const bool start = it->second.Start;
+  std::shared_ptr<std::atomic<int>> requestState = it->second.RequestState;
+  this->Internal->SceneBuilds.erase(it);
+
+  vtkMRMLScene* mrmlScene = this->GetMRMLScene();
+  if (!start || !mrmlScene || !built.Scene)
+  {
+    if (requestState)
+    {
+      requestState->store(!start ? RequestCanceled : RequestFailed);
+    }
+    return;
+  }
+
+  imstk::imstkNew<imstk::SceneManager> sceneManager;
+  sceneManager->setActiveScene(built.Scene);
+  vtkInternal::Simulation& simulation = this->Internal->ResetSimulation(simName, sceneManager);
+
+  // All the rigid bodies are observed by a single batch
+  std::vector<std::shared_ptr<imstk::Geometry>> geometries;
+  std::vector<vtkMRMLLinearTransformNode*> transformNodes;
+  std::vector<std::array<double, 3>> origins;
+  for (std::size_t i = 0; i < description.Objects.size(); i++)
+  {
+    const vtkSlicerIMSTKSceneBuilder::ObjectDescription& objectDescription = description.Objects[i];
+    vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(mrmlScene->GetNodeByID(objectDescription.NodeID));
+    if (objectDescription.Type != vtkSlicerIMSTKSceneBuilder::RigidObject || !modelNode || !built.Objects[i])
+    {
+      continue;
+    }
+    const char* role = vtkSlicerIMSTKSceneBuilder::PoseTransformReferenceRole;
+    vtkMRMLLinearTransformNode* poseNode = vtkMRMLLinearTransformNode::SafeDownCast(modelNode->GetNodeReference(role));
+    if (!poseNode)
+    {
+      poseNode = vtkMRMLLinearTransformNode::SafeDownCast(mrmlScene->AddNewNodeByClass(
+        "vtkMRMLLinearTransformNode", objectDescription.Name + " pose"));
+      modelNode->SetNodeReferenceID(role, poseNode->GetID());
+    }
+    // The pose node holds the whole transform to world of the body. The
+    // transform the model was authored under is kept for the rebuilds and
+    // restored when the simulation is released.
+    vtkMRMLTransformNode* authoredParent = vtkSlicerIMSTKSceneBuilder::GetAuthoredParent(modelNode);
+    modelNode->SetNodeReferenceID(vtkSlicerIMSTKSceneBuilder::AuthoredParentReferenceRole,
+      authoredParent ? authoredParent->GetID() : nullptr);
+    poseNode->SetAndObserveTransformNodeID(nullptr);
+    modelNode->SetAndObserveTransformNodeID(poseNode->GetID());
+
+    // The geometries are centered on the center of mass of the body
+    geometries.push_back(built.Objects[i]->getVisualGeometry());
+    transformNodes.push_back(poseNode);
+    origins.push_back(built.CentersOfMass[i]);
+  }
+  if (!geometries.empty())
+  {
+    this->Internal->AddTransformBatch(simulation, geometries, transformNodes, origins);
+  }
+
+  // Follow the changes of the tagged models and of the parameter node
+  for (std::size_t i = 0; i < description.Objects.size(); i++)
+  {
+    if (built.Objects[i])
+    {
+      simulation.Descriptions.push_back(description.Objects[i]);
+      simulation.Objects.push_back(built.Objects[i]);
+    }
+  }
+  simulation.Rebuild = [this, simName]() { this->buildSceneFromMRML(simName); };
+  this->Internal->ApplyParameters(simulation);
+  this->UpdateTunedNodeObservations();
+
+  if (simulation.ContactModelNode && !built.CollisionData.empty())
+  {
+    this->Internal->AddContactObserver(simulation, built.CollisionData, simulation.ContactModelNode,
+      this->MaximumNumberOfContacts, this->ContactPublishPeriod);
+  }
+
+  this->Internal->SetupModules(simulation, std::vector<std::shared_ptr<imstk::Module>>(), this->Headless);
+  this->Internal->StartModules(simulation);
+  if (requestState)
+  {
+    requestState->store(RequestCompleted);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::processPendingUpdates()
+{
+  // Start the scenes whose build completed
+  if (!this->Internal->SceneBuilds.empty())
+  {
+    std::vector<std::string> builtScenes;
+    for (auto& x : this->Internal->SceneBuilds)
+    {
+      // Simulations advanced by runBatchSimulation() are replaced after the run
+      if (x.second.Result.wait_for(std::chrono::seconds(0)) == std::future_status::ready
+        && !this->Internal->BatchRuns.count(x.first))
+      {
+        builtScenes.push_back(x.first);
+      }
+    }
+    for (const std::string& simName : builtScenes)
+    {
+      this->startBuiltScene(simName);
+    }
+  }
+
+  if (!this->Internal->Requests.empty())
+  {
+    for (int requestId : this->Internal->UpdateRequests())
+    {
+      this->InvokeEvent(RequestFinishedEvent, &requestId);
+    }
+  }
+
+  // Fetch the transform batches first so that large updates can be applied
+  // to MRML within a single batch process.
+  std::vector<std::pair<vtkInternal::TransformBatch*, vtkInternal::ClockType::time_point>>& pendingBatches =
+    this->Internal->PendingBatches;
+  pendingBatches.clear();
+  std::size_t numberOfTransforms = 0;
+  for (auto& x : this->Internal->Simulations)
+  {
+    for (auto& batch : x.second.TransformBatches)
+    {
+      if (batch->Mailbox.Consume())
+      {
+        pendingBatches.emplace_back(batch.get(), batch->Mailbox.GetReadBuffer().Timestamp);
+        numberOfTransforms += batch->Count;
+      }
+    }
+    // Device poses are interpolated at every call, see below
+    for (auto& observer : x.second.TransformObservers)
+    {
+      numberOfTransforms += observer->PoseSamples ? 1 : 0;
+    }
+  }
+
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  const bool batchProcess = scene && this->MRMLBatchThreshold > 0 &&
+    numberOfTransforms >= static_cast<std::size_t>(this->MRMLBatchThreshold);
+  if (batchProcess)
+  {
+    scene->StartState(vtkMRMLScene::BatchProcessState);
+  }
+  for (auto& pending : pendingBatches)
+  {
+    const vtkInternal::ClockType::time_point start = vtkInternal::ClockType::now();
+    vtkInternal::TransformBatch* batch = pending.first;
+    batch->Apply();
+    if (batch->Recorder->IsRecording())
+    {
+      const std::vector<double>& elements = batch->Mailbox.GetReadBuffer().Elements;
+      batch->Recorder->Record(vtkSlicerIMSTKSessionLog::TransformBatchRecord, batch->Stream, pending.second,
+        elements.data(), static_cast<std::uint32_t>(elements.size()));
+    }
+    batch->Applied(pending.second);
+    if (batch->Stats->Tracing)
+    {
+      batch->Stats->Trace->Record("ApplyBatchToMRML", start, vtkInternal::ClockType::now());
+    }
+  }
+
+  // The poses of all the devices of a simulation are interpolated at the
+  // same display time, and applied within the same batch process as the
+  // transform batches
+  for (auto& x : this->Internal->Simulations)
+  {
+    const vtkInternal::ClockType::time_point start = vtkInternal::ClockType::now();
 
+    for (auto& observer : x.second.TransformObservers)
+    {
+      const vtkInternal::Pose* posePtr = nullptr;
+      if (observer->PoseSamples)
+      {
+        // Pose at the display time, the device is sampled faster than the
+        // display refresh so this is mostly a short extrapolation.
+        vtkInternal::Pose& interpolated = observer->AppliedPose;
+        const std::array<double, 16> previous = interpolated.Matrix;
+        if (!observer->PoseSamples->Interpolate(start, this->PoseExtrapolation,
+              interpolated.Matrix.data(), &interpolated.Timestamp)
+          || interpolated.Matrix == previous)
+        {
+          continue;
+        }
+        posePtr = &interpolated;
+      }
+      else if (observer->Mailbox.Consume())
+      {
+        posePtr = &observer->Mailbox.GetReadBuffer();
+      }
+      else
+      {
+        continue;
+      }
+      vtkMRMLLinearTransformNode* transformNode = observer->TransformNode;
+      if (!transformNode)
+      {
+        continue;
+      }
+      const vtkInternal::Pose& pose = *posePtr;
+      observer->Matrix->DeepCopy(pose.Matrix.data());
+      if (observer->ToParent)
+      {
+        transformNode->SetMatrixTransformToParent(observer->Matrix);
+      }
+      else
+      {
+        transformNode->SetMatrixTransformFromParent(observer->Matrix);
+      }
+      observer->Applied(pose.Timestamp);
+      if (observer->Recorder->IsRecording())
+      {
+        observer->Recorder->Record(vtkSlicerIMSTKSessionLog::TransformRecord, observer->Stream, pose.Timestamp,
+          pose.Matrix.data(), 16);
+      }
+    }
 
-//----------------------------------------------------------------------------
-vtkStandardNewMacro(vtkSlicerIMSTKLogic);
+    for (auto& observer : x.second.MeshObservers)
+    {
+      if (!observer->Mailbox.Consume())
+      {
+        continue;
+      }
+      const vtkInternal::MeshObserver::Frame& frame = observer->Mailbox.GetReadBuffer();
+      if (!observer->SharedBuffer)
+      {
+        observer->PolyData->GetPoints()->SetData(frame.Points);
+      }
+      observer->PolyData->GetPoints()->Modified();
+      if (observer->UpdateNormals)
+      {
+        observer->PolyData->GetPointData()->SetNormals(frame.Normals);
+      }
+      // Notify the model node, the arrays were swapped without any allocation
+      observer->PolyData->Modified();
+      observer->Applied(frame.Timestamp);
+    }
 
-//----------------------------------------------------------------------------
-vtkSlicerIMSTKLogic::vtkSlicerIMSTKLogic()
+    for (auto& observer : x.second.ContactObservers)
+    {
+      if (observer->Mailbox.Consume())
+      {
+        observer->Apply();
+      }
+    }
+
+    // Write the device poses queued by the sampling tasks
+    x.second.Recorder->Flush();
+
+    const std::shared_ptr<vtkInternal::Instrumentation>& stats = x.second.Stats;
+    if (stats->Tracing)
+    {
+      stats->Trace->Record("ApplyToMRML", start, vtkInternal::ClockType::now());
+    }
+  }
+  if (batchProcess)
+  {
+    scene->EndState(vtkMRMLScene::BatchProcessState);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::setSyncMode(std::string simName, int mode)
 {
+  if (mode != SyncFixedRate && mode != SyncOnRender)
+  {
+    vtkErrorMacro("setSyncMode: invalid mode " << mode);
+    return;
+  }
+  this->Internal->Simulations[simName].Sync->Mode = mode;
 }
 
-//----------------------------------------------------------------------------
-vtkSlicerIMSTKLogic::~vtkSlicerIMSTKLogic()
+//-----------------------------------------------------------------------------
+int vtkSlicerIMSTKLogic::getSyncMode(std::string simName)
+{
+  auto it = this->Internal->Simulations.find(simName);
+  return it != this->Internal->Simulations.end() ? it->second.Sync->Mode.load() : vtkInternal::SyncState().Mode.load();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::setPublishFrequency(std::string simName, double frequency)
 {
-  for (auto const& x : this->simulations)
+  if (frequency <= 0.0)
   {
-    x.second->requestStatus(ModuleDriverStopped);
+    vtkErrorMacro("setPublishFrequency: frequency must be positive");
+    return;
   }
+  this->Internal->Simulations[simName].Sync->PublishPeriod = 1.0 / frequency;
 }
 
-//----------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic::PrintSelf(ostream& os, vtkIndent indent)
+//-----------------------------------------------------------------------------
+double vtkSlicerIMSTKLogic::getPublishFrequency(std::string simName)
 {
-  this->Superclass::PrintSelf(os, indent);
+  auto it = this->Internal->Simulations.find(simName);
+  return 1.0 / (it != this->Internal->Simulations.end()
+    ? it->second.Sync->PublishPeriod.load() : vtkInternal::SyncState().PublishPeriod.load());
 }
 
-//---------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene)
+//-----------------------------------------------------------------------------
+vtkSlicerIMSTKLogic::SyncStatistics vtkSlicerIMSTKLogic::getSyncStatistics(std::string simName)
 {
-  vtkNew<vtkIntArray> events;
-  events->InsertNextValue(vtkMRMLScene::NodeAddedEvent);
-  events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
-  events->InsertNextValue(vtkMRMLScene::EndBatchProcessEvent);
-  this->SetAndObserveMRMLSceneEventsInternal(newScene, events.GetPointer());
+  SyncStatistics statistics;
+  auto it = this->Internal->Simulations.find(simName);
+  if (it == this->Internal->Simulations.end())
+  {
+    return statistics;
+  }
+  const vtkInternal::SyncState& sync = *it->second.Sync;
+  statistics.Updates = sync.Updates;
+  statistics.Dropped = sync.Dropped;
+  statistics.Coalesced = sync.Coalesced;
+  statistics.Published = sync.Published;
+  return statistics;
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic::RegisterNodes()
+vtkSlicerIMSTKLogic::SimulationStatistics vtkSlicerIMSTKLogic::getSimulationStatistics(std::string simName)
 {
-  assert(this->GetMRMLScene() != 0);
+  SimulationStatistics statistics;
+  auto it = this->Internal->Simulations.find(simName);
+  if (it == this->Internal->Simulations.end())
+  {
+    return statistics;
+  }
+  const vtkInternal::Simulation& simulation = it->second;
+  statistics.StepDuration = simulation.Stats->StepDuration.GetSummary();
+  statistics.CallbackDuration = simulation.Stats->CallbackDuration.GetSummary();
+  statistics.PoseLatency = simulation.Stats->PoseLatency.GetSummary();
+  statistics.ActualDt = simulation.Stats->ActualDt.GetSummary();
+  statistics.RequestedDt = simulation.Stats->RequestedDt;
+  statistics.Sync = this->getSyncStatistics(simName);
+  return statistics;
 }
 
-//---------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic::UpdateFromMRMLScene()
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::setTracing(std::string simName, bool enabled)
 {
-  assert(this->GetMRMLScene() != 0);
+  const std::shared_ptr<vtkInternal::Instrumentation>& stats = this->Internal->Simulations[simName].Stats;
+  if (enabled && !stats->Trace)
+  {
+    stats->Trace = std::make_shared<vtkSlicerIMSTKTraceBuffer>();
+  }
+  stats->Tracing.store(enabled, std::memory_order_release);
 }
 
-//---------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic
-::OnMRMLSceneNodeAdded(vtkMRMLNode* vtkNotUsed(node))
+//-----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::writeChromeTrace(std::string simName, std::string fileName)
 {
+  auto it = this->Internal->Simulations.find(simName);
+  if (it == this->Internal->Simulations.end())
+  {
+    vtkErrorMacro("writeChromeTrace: unknown simulation " << simName);
+    return false;
+  }
+  std::ofstream output(fileName);
+  if (!output)
+  {
+    vtkErrorMacro("writeChromeTrace: failed to open " << fileName);
+    return false;
+  }
+  if (it->second.Stats->Trace)
+  {
+    it->second.Stats->Trace->WriteChromeTrace(output);
+  }
+  else
+  {
+    // Tracing was never enabled
+    vtkSlicerIMSTKTraceBuffer(1).WriteChromeTrace(output);
+  }
+  return true;
 }
 
-//---------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic
-::OnMRMLSceneNodeRemoved(vtkMRMLNode* vtkNotUsed(node))
+//-----------------------------------------------------------------------------
+vtkSlicerIMSTKGeometryCache* vtkSlicerIMSTKLogic::getGeometryCache()
 {
+  return &this->Internal->GeometryCache;
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic::runHapticDeviceExample(std::string simName, std::string deviceName, vtkMRMLLinearTransformNode* outputTransformNode)
+vtkSlicerIMSTKScheduler* vtkSlicerIMSTKLogic::getScheduler()
 {
-#ifdef Slicer_iMSTK_USE_OpenHaptics
-  imstk::imstkNew<imstk::Scene>               scene("SDFHaptics");
+  return &this->Internal->Scheduler;
+}
 
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::precomputeCollisionData(vtkMRMLModelNode* modelNode)
+{
+  if (!modelNode || !modelNode->GetID() || !modelNode->GetPolyData())
   {
-    scene->getActiveCamera()->setPosition(-2.3, 23.81, 45.65);
-    scene->getActiveCamera()->setFocalPoint(9.41, 8.45, 5.76);
-
-    // Light (white)
-    imstk::imstkNew<imstk::DirectionalLight> whiteLight;
+    return;
+  }
+  const std::string key = modelNode->GetID();
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->CollisionDataMutex);
+    if (!this->Internal->PendingCollisionData.insert(key).second)
     {
-      whiteLight->setDirection(imstk::Vec3d(0.0, -8.0, -5.0));
-      whiteLight->setIntensity(1.0);
-      scene->addLight("whitelight", whiteLight);
+      return;
     }
   }
+  // The worker only reads a shallow copy of the mesh
+  vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+  polyData->ShallowCopy(modelNode->GetPolyData());
+  const std::string directory = this->getCollisionDataDirectory();
+  const int levelOfDetailTriangles = this->LevelOfDetailTriangles;
+  vtkInternal* internal = this->Internal;
+  internal->CollisionDataTasks.run(
+    [internal, key, polyData, directory, levelOfDetailTriangles]()
+    {
+      vtkSlicerIMSTKCollisionData::Precompute(&internal->GeometryCache, key, polyData, directory);
+      if (levelOfDetailTriangles > 0)
+      {
+        vtkSlicerIMSTKLevelOfDetail::Get(&internal->GeometryCache, key, polyData, levelOfDetailTriangles);
+      }
+      std::lock_guard<std::mutex> lock(internal->CollisionDataMutex);
+      internal->PendingCollisionData.erase(key);
+    });
+}
 
-  imstk::imstkNew<imstk::HapticDeviceManager>       hapticManager;
-  std::shared_ptr<imstk::HapticDeviceClient> client = hapticManager->makeDeviceClient(deviceName);
+//-----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::isPrecomputingCollisionData()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->CollisionDataMutex);
+  return !this->Internal->PendingCollisionData.empty();
+}
 
-  // Run the simulation
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::generateVolumeMesh(vtkMRMLNode* node, std::string segmentId)
+{
+  std::string key;
+  vtkSmartPointer<vtkPolyData> polyData = vtkInternal::GetClosedSurface(node, segmentId, key);
+  if (!polyData)
   {
-    // Setup a viewer to render in its own thread
-    imstk::imstkNew<imstk::VTKViewer> viewer;
-    viewer->setActiveScene(scene);
-    viewer->getVtkRenderWindow()->SetShowWindow(false);
-
-    // Setup a scene manager to advance the scene in its own thread
-    imstk::imstkNew<imstk::SceneManager> sceneManager;
-    sceneManager->setActiveScene(scene);
-
-    imstk::imstkNew<imstk::SimulationManager> driver;
-    driver->addModule(viewer);
-    driver->addModule(sceneManager);
-    driver->addModule(hapticManager);
-
-    imstk::connect<imstk::Event>(sceneManager, &imstk::SceneManager::postUpdate, [&](imstk::Event*)
-      {
-        auto orientation = client->getOrientation();
-        auto position = client->getPosition();
-        vtkNew<vtkMatrix4x4> matrix;
-
-        Eigen::Affine3d t(Eigen::Translation3d(position[0], position[1], position[2]));
-        Eigen::Affine3d r(orientation.normalized().toRotationMatrix());
-        Eigen::Matrix4d m = t.matrix();
-        m *= r.matrix();
-        //Eigen is default column major
-        //VTK is default row major
-        matrix->DeepCopy(m.data());
-        matrix->Transpose();
-
-        outputTransformNode->SetMatrixTransformToParent(matrix.GetPointer());
-      });
-
-    // Add mouse and keyboard controls to the viewer
+    vtkErrorMacro("generateVolumeMesh: no closed surface to tetrahedralize");
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->CollisionDataMutex);
+    if (!this->Internal->PendingVolumeMeshes.insert(key).second)
     {
-      imstk::imstkNew<imstk::MouseSceneControl> mouseControl(viewer->getMouseDevice());
-      mouseControl->setSceneManager(sceneManager);
-      viewer->addControl(mouseControl);
-
-      imstk::imstkNew<imstk::KeyboardSceneControl> keyControl(viewer->getKeyboardDevice());
-      keyControl->setSceneManager(sceneManager);
-      keyControl->setModuleDriver(driver);
-      viewer->addControl(keyControl);
+      return;
     }
-
-    this->simulations[simName] = driver;
-    driver->start();
   }
-#else
-  (void)simName; // unused
-  (void)deviceName; // unused
-  (void)outputTransformNode; // unused
-#endif
+  vtkSlicerIMSTKVolumeMesh::Parameters parameters;
+  parameters.CellSize = this->VolumeMeshCellSize;
+  parameters.MinimumQuality = this->VolumeMeshMinimumQuality;
+  const std::string directory = this->getCollisionDataDirectory();
+  vtkInternal* internal = this->Internal;
+  internal->CollisionDataTasks.run(
+    [internal, key, polyData, parameters, directory]()
+    {
+      vtkSlicerIMSTKVolumeMesh::Generate(&internal->GeometryCache, key, polyData, parameters, directory);
+      std::lock_guard<std::mutex> lock(internal->CollisionDataMutex);
+      internal->PendingVolumeMeshes.erase(key);
+    });
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic::runObjectCtrlDummyClientExample(std::string simName, vtkMRMLModelNode* inputNode, vtkMRMLModelNode* outputNode, vtkMRMLLinearTransformNode* outputTransformNode)
+bool vtkSlicerIMSTKLogic::isGeneratingVolumeMesh()
 {
+  std::lock_guard<std::mutex> lock(this->Internal->CollisionDataMutex);
+  return !this->Internal->PendingVolumeMeshes.empty();
+}
 
-  imstk::imstkNew<imstk::Scene> scene("ObjectControllerDummyClient");
-
-  auto geom = imstk::GeometryUtils::copyToSurfaceMesh(inputNode->GetPolyData());
+//-----------------------------------------------------------------------------
+std::shared_ptr<vtkSlicerIMSTKVolumeMesh::Tetrahedralization> vtkSlicerIMSTKLogic::getVolumeMesh(vtkMRMLNode* node, std::string segmentId)
+{
+  std::string key;
+  vtkSmartPointer<vtkPolyData> polyData = vtkInternal::GetClosedSurface(node, segmentId, key);
+  if (!polyData || !this->Internal->GeometryCache.GetSurfaceMesh(key, polyData))
+  {
+    return nullptr;
+  }
+  vtkSlicerIMSTKVolumeMesh::Parameters parameters;
+  parameters.CellSize = this->VolumeMeshCellSize;
+  parameters.MinimumQuality = this->VolumeMeshMinimumQuality;
+  std::shared_ptr<const vtkSlicerIMSTKVolumeMesh::Tetrahedralization> found = vtkSlicerIMSTKVolumeMesh::Find(
+    &this->Internal->GeometryCache, key, parameters, this->getCollisionDataDirectory());
+  if (!found)
+  {
+    return nullptr;
+  }
+  auto copy = std::make_shared<vtkSlicerIMSTKVolumeMesh::Tetrahedralization>(*found);
+  copy->Mesh = std::make_shared<imstk::TetrahedralMesh>();
+  copy->Mesh->initialize(
+    std::make_shared<imstk::VecDataArray<double, 3>>(*found->Mesh->getInitialVertexPositions()),
+    std::make_shared<imstk::VecDataArray<int, 4>>(*found->Mesh->getTetrahedraIndices()));
+  return copy;
+}
 
-  imstk::imstkNew<imstk::CollidingObject> object("VirtualObject");
-  object->setVisualGeometry(geom);
-  object->setCollidingGeometry(geom);
-  scene->addSceneObject(object);
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::setCollisionDataDirectory(std::string directory)
+{
+  this->CollisionDataDirectory = directory;
+}
 
-  // Update Camera position
-  scene->getActiveCamera()->setPosition(0.0, 0.0, 10.0);
-  scene->getActiveCamera()->setFocalPoint(0, 0, 0);
+//-----------------------------------------------------------------------------
+std::string vtkSlicerIMSTKLogic::getCollisionDataDirectory()
+{
+  if (!this->CollisionDataDirectory.empty())
+  {
+    return this->CollisionDataDirectory;
+  }
+  // The root directory of a scene that was never saved nor loaded is a
+  // default location, nothing is written there.
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene || !scene->GetURL() || !*scene->GetURL()
+    || !scene->GetRootDirectory() || !*scene->GetRootDirectory())
+  {
+    return std::string();
+  }
+  return std::string(scene->GetRootDirectory()) + "/IMSTKCollisionData";
+}
 
-  // Device Client
-  imstk::imstkNew<imstk::DummyClient>           client("DummyClient");
-  imstk::imstkNew<imstk::SceneObjectController> controller(object, client);
-  scene->addController(controller);
+//-----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::startRecording(std::string simName, std::string fileName)
+{
+  // The recorder is kept when the simulation is (re)started, so recording
+  // can start before the simulation.
+  vtkInternal::Simulation& simulation = this->Internal->Simulations[simName];
+  if (!simulation.Recorder->StartRecording(fileName))
+  {
+    vtkErrorMacro("startRecording: cannot write " << fileName);
+    return false;
+  }
+  return true;
+}
 
-  // Run the simulation
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::stopRecording(std::string simName)
+{
+  auto it = this->Internal->Simulations.find(simName);
+  if (it != this->Internal->Simulations.end())
   {
-    // Setup a viewer to render in its own thread
-#ifdef Slicer_iMSTK_USE_RENDERING_VTK
-    imstk::imstkNew<imstk::VTKViewer> viewer;
-    viewer->setActiveScene(scene);
-    viewer->getVtkRenderWindow()->SetShowWindow(false);
-#endif
+    it->second.Recorder->StopRecording();
+  }
+}
 
-    // Setup a scene manager to advance the scene in its own thread
-    imstk::imstkNew<imstk::SceneManager> sceneManager;
-    sceneManager->setActiveScene(scene);
-    double t = 0.0;
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::setParameterNode(std::string simName, vtkMRMLNode* parameterNode)
+{
+  vtkInternal::Simulation& simulation = this->Internal->Simulations[simName];
+  if (simulation.ParameterNode == parameterNode)
+  {
+    return;
+  }
+  simulation.ParameterNode = parameterNode;
+  if (!this->Internal->ApplyParameters(simulation) && simulation.Rebuild)
+  {
+    std::function<void()> rebuild = simulation.Rebuild;
+    rebuild();
+  }
+  this->UpdateTunedNodeObservations();
+}
 
-    imstk::connect<imstk::Event>(sceneManager, &imstk::SceneManager::postUpdate,
-      [&](imstk::Event*)
-      {
-        t += sceneManager->getDt();
-        client->setPosition(imstk::Vec3d(cos(t) * 10.0, sin(t) * 5.0, 0.0));
-      });
+//-----------------------------------------------------------------------------
+vtkMRMLNode* vtkSlicerIMSTKLogic::getParameterNode(std::string simName)
+{
+  auto it = this->Internal->Simulations.find(simName);
+  return it != this->Internal->Simulations.end() ? it->second.ParameterNode.GetPointer() : nullptr;
+}
 
-    this->observeRigidBody(sceneManager, object, outputNode, outputTransformNode);
+//-----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::startPoseExport(std::string name, int capacity)
+{
+  this->stopPoseExport();
+  auto poseExport = std::make_shared<vtkSlicerIMSTKPoseSharedMemory>();
+  if (!poseExport->Create(name, capacity))
+  {
+    vtkErrorMacro("startPoseExport: cannot create the shared memory segment " << name);
+    return false;
+  }
+  this->Internal->PoseExport = poseExport;
+  this->Internal->PoseExportSlots.clear();
+  return true;
+}
 
-    imstk::imstkNew<imstk::SimulationManager> driver;
-#ifdef Slicer_iMSTK_USE_RENDERING_VTK
-    driver->addModule(viewer);
-#endif
-    driver->addModule(sceneManager);
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::stopPoseExport()
+{
+  if (this->Internal->PoseExport)
+  {
+    // Simulations exporting to it keep the memory mapped until they are released
+    this->Internal->PoseExport->Unlink();
+    this->Internal->PoseExport = nullptr;
+  }
+}
 
-    // Add mouse and keyboard controls to the viewer
-#ifdef Slicer_iMSTK_USE_RENDERING_VTK
-    {
-      imstk::imstkNew<imstk::MouseSceneControl> mouseControl(viewer->getMouseDevice());
-      mouseControl->setSceneManager(sceneManager);
-      viewer->addControl(mouseControl);
+//-----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::isExportingPoses()
+{
+  return this->Internal->PoseExport != nullptr;
+}
 
-      imstk::imstkNew<imstk::KeyboardSceneControl> keyControl(viewer->getKeyboardDevice());
-      keyControl->setSceneManager(sceneManager);
-      keyControl->setModuleDriver(driver);
-      viewer->addControl(keyControl);
-    }
-#endif
-    this->simulations[simName] = driver;
-    driver->start();
+//-----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::setDeviceReplay(std::string fileName, bool realTime)
+{
+  this->Internal->ReplayLog = nullptr;
+  if (fileName.empty())
+  {
+    return true;
+  }
+  auto log = std::make_shared<vtkSlicerIMSTKSessionLog>();
+  if (!log->Load(fileName))
+  {
+    vtkErrorMacro("setDeviceReplay: cannot read session log " << fileName);
+    return false;
   }
+  this->Internal->ReplayLog = log;
+  this->Internal->ReplayRealTime = realTime;
+  return true;
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic::observeRigidBody(std::shared_ptr<imstk::SceneManager> sceneManager, std::shared_ptr<imstk::SceneObject> object, vtkMRMLModelNode* outputNode, vtkMRMLLinearTransformNode* outputTransformNode)
+int vtkSlicerIMSTKLogic::saveSnapshotAsync(std::string simName, std::string snapshotName)
 {
-  vtkSmartPointer<vtkPolyData> polyDataOutput = imstk::GeometryUtils::copyToVtkPolyData(std::dynamic_pointer_cast<imstk::SurfaceMesh>(object->getVisualGeometry()));
-  outputNode->SetAndObservePolyData(polyDataOutput);
-  outputNode->SetAndObserveTransformNodeID(outputTransformNode->GetID());
+  auto it = this->Internal->Simulations.find(simName);
+  if (it == this->Internal->Simulations.end() || !it->second.SceneManager)
+  {
+    vtkErrorMacro("saveSnapshotAsync: unknown simulation " << simName);
+    const int requestId = this->Internal->AddRequest();
+    this->Internal->Requests[requestId].State->store(RequestFailed);
+    return requestId;
+  }
+  vtkInternal::Simulation& simulation = it->second;
 
-  imstk::connect<imstk::Event>(sceneManager, &imstk::SceneManager::postUpdate,
-    [&](imstk::Event*)
+  // Allocate the snapshot here so that the capture only copies. The number
+  // of vertices of the objects does not change while they are simulated.
+  std::size_t numberOfRecords = 2 * simulation.Objects.size() + simulation.Controllers.size();
+  std::size_t numberOfValues = 8 * simulation.Controllers.size();
+  for (const std::shared_ptr<imstk::SceneObject>& object : simulation.Objects)
+  {
+    auto pointSet = std::dynamic_pointer_cast<imstk::PointSet>(object->getVisualGeometry());
+    numberOfValues += 16 + std::max<std::size_t>(13, pointSet ? 3 * pointSet->getNumVertices() : 0);
+  }
+  auto snapshot = std::make_shared<vtkSlicerIMSTKSnapshot>();
+  snapshot->Clear(numberOfRecords, numberOfValues);
+
+  auto captured = std::make_shared<std::atomic<bool>>(false);
+  std::vector<std::shared_ptr<imstk::SceneObject>> objects = simulation.Objects;
+  std::vector<std::shared_ptr<imstk::SceneObjectController>> controllers = simulation.Controllers;
+  std::shared_ptr<vtkInternal::Instrumentation> stats = simulation.Stats;
+  vtkInternal::PushChange(simulation,
+    [snapshot, captured, objects, controllers, stats]()
     {
-      auto test = std::dynamic_pointer_cast<imstk::SurfaceMesh>(object->getVisualGeometry());
-      auto transform = test->getTransform();
-      vtkNew<vtkMatrix4x4> matrix;
-      for (int i = 0; i < 4; i++)
+      const vtkInternal::ClockType::time_point start = vtkInternal::ClockType::now();
+      vtkInternal::CaptureState(objects, controllers, *snapshot);
+      if (stats->Tracing.load(std::memory_order_acquire))
       {
-        for (int j = 0; j < 4; j++)
-        {
-          matrix->SetElement(i, j, transform(i, j));
-        }
+        stats->Trace->Record("Snapshot", start, vtkInternal::ClockType::now());
+      }
+      captured->store(true, std::memory_order_release);
+    });
+
+  vtkInternal* internal = this->Internal;
+  std::shared_ptr<vtkInternal::ChangeQueue> changes = simulation.Changes;
+  return this->Internal->AddRequest(
+    [internal, simName, snapshotName, snapshot, captured, changes]()
+    {
+      if (captured->load(std::memory_order_acquire))
+      {
+        internal->Snapshots[snapshotName] = snapshot;
+        return static_cast<int>(RequestCompleted);
+      }
+      auto simulation = internal->Simulations.find(simName);
+      if (simulation == internal->Simulations.end() || simulation->second.Changes != changes)
+      {
+        // Reset before the capture
+        return static_cast<int>(RequestCanceled);
       }
-      outputTransformNode->SetMatrixTransformFromParent(matrix);
+      return static_cast<int>(RequestPending);
     });
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlicerIMSTKLogic::stopSimulation(std::string simName)
+bool vtkSlicerIMSTKLogic::restoreSnapshot(std::string simName, std::string snapshotName)
+{
+  auto simulation = this->Internal->Simulations.find(simName);
+  auto snapshot = this->Internal->Snapshots.find(snapshotName);
+  if (simulation == this->Internal->Simulations.end() || !simulation->second.SceneManager
+    || snapshot == this->Internal->Snapshots.end())
+  {
+    vtkErrorMacro("restoreSnapshot: unknown simulation " << simName << " or snapshot " << snapshotName);
+    return false;
+  }
+  std::shared_ptr<const vtkSlicerIMSTKSnapshot> state = snapshot->second;
+  std::vector<std::shared_ptr<imstk::SceneObject>> objects = simulation->second.Objects;
+  std::vector<std::shared_ptr<imstk::SceneObjectController>> controllers = simulation->second.Controllers;
+  vtkInternal::PushChange(simulation->second,
+    [state, objects, controllers]()
+    {
+      vtkInternal::RestoreState(*state, objects, controllers);
+    });
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::writeSnapshot(std::string snapshotName, std::string fileName)
+{
+  auto it = this->Internal->Snapshots.find(snapshotName);
+  if (it == this->Internal->Snapshots.end() || !it->second->Write(fileName))
+  {
+    vtkErrorMacro("writeSnapshot: cannot write snapshot " << snapshotName << " to " << fileName);
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSlicerIMSTKLogic::readSnapshot(std::string fileName, std::string snapshotName)
+{
+  auto snapshot = std::make_shared<vtkSlicerIMSTKSnapshot>();
+  if (!snapshot->Load(fileName))
+  {
+    vtkErrorMacro("readSnapshot: cannot read snapshot " << fileName);
+    return false;
+  }
+  this->Internal->Snapshots[snapshotName] = snapshot;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlicerIMSTKLogic::removeSnapshot(std::string snapshotName)
 {
-  auto simulation = this->simulations[simName];
-  simulation->requestStatus(ModuleDriverStopped);
+  this->Internal->Snapshots.erase(snapshotName);
 }
@@ -21,27 +21,40 @@
 // Slicer includes
 #include "vtkSlicerModuleLogic.h"
 
+// VTK includes
+#include <vtkCommand.h>
+
 // MRML includes
 
 // iMSTK includes
 
 // STD includes
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <map>
+#include <string>
+#include <vector>
 
 
 #include "vtkSlicerIMSTKModuleLogicExport.h"
+#include "vtkSlicerIMSTKRollingStatistics.h"
+#include "vtkSlicerIMSTKVolumeMesh.h"
 
+class vtkDoubleArray;
 class vtkMRMLModelNode;
 class vtkMRMLLinearTransformNode;
+class vtkMRMLNode;
+class vtkSlicerIMSTKGeometryCache;
+class vtkSlicerIMSTKScheduler;
 
 
 namespace imstk
 {
+  class CollisionData;
   class SceneManager;
   class SceneObject;
-  class SimulationManager;
+  class SurfaceMesh;
 }
 
 
@@ -56,11 +69,456 @@ public:
 
   void PrintSelf(ostream& os, vtkIndent indent) override;
 
+  /// If enabled (default), simulations only run their scene manager and
+  /// device managers, stepped by the shared scheduler (see getScheduler()).
+  /// Visualization is left to the Slicer views and no iMSTK viewer is
+  /// created, saving its render thread.
+  /// If disabled and iMSTK is built with VTK rendering, each simulation also
+  /// runs a hidden iMSTK viewer.
+  /// Only affects simulations started afterward.
+  vtkSetMacro(Headless, bool);
+  vtkGetMacro(Headless, bool);
+  vtkBooleanMacro(Headless, bool);
+
+  /// Minimum number of transforms received in one processPendingUpdates()
+  /// call, device poses included, for them to be applied within a MRML
+  /// scene batch process.
+  /// Ending a batch process refreshes the whole scene in the GUI, so it only
+  /// pays off for large scenes. 0 disables batch processing. Default is 32.
+  vtkSetMacro(MRMLBatchThreshold, int);
+  vtkGetMacro(MRMLBatchThreshold, int);
+
+  /// Haptic device poses are sampled at the device rate and displayed at
+  /// their value interpolated at the time processPendingUpdates() is called.
+  /// This is the maximum time, in seconds, they are extrapolated past their
+  /// most recent sample. 0 displays the most recent sample. Default is 0.005.
+  vtkSetMacro(PoseExtrapolation, double);
+  vtkGetMacro(PoseExtrapolation, double);
+
+  /// If enabled (default), the collision data (see
+  /// vtkSlicerIMSTKCollisionData) of the models tagged as colliding objects
+  /// (see vtkSlicerIMSTKSceneBuilder) is precomputed in the background as
+  /// soon as they are added to the scene, or get their first mesh. Models
+  /// tagged later get it when the scene is built.
+  vtkSetMacro(PrecomputeCollisionData, bool);
+  vtkGetMacro(PrecomputeCollisionData, bool);
+  vtkBooleanMacro(PrecomputeCollisionData, bool);
+
+  /// Maximum number of triangles of the meshes models collide with, larger
+  /// models are decimated (see vtkSlicerIMSTKLevelOfDetail) and only
+  /// displayed at full resolution. Levels are precomputed with the collision
+  /// data. 0 disables decimation. Default is 10000.
+  vtkSetMacro(LevelOfDetailTriangles, int);
+  vtkGetMacro(LevelOfDetailTriangles, int);
+
+  /// Size of the tetrahedra generated by generateVolumeMesh(), 0 (default)
+  /// means 1/20 of the diagonal of the surface bounds.
+  vtkSetMacro(VolumeMeshCellSize, double);
+  vtkGetMacro(VolumeMeshCellSize, double);
+
+  /// Minimum quality (normalized radius ratio, 1 for a regular tetrahedron)
+  /// of the tetrahedra generated by generateVolumeMesh(). Default is 0.1.
+  vtkSetMacro(VolumeMeshMinimumQuality, double);
+  vtkGetMacro(VolumeMeshMinimumQuality, double);
+
+  /// Maximum number of contacts displayed by observeContacts(), the buffers
+  /// are allocated for this number and extra contacts are ignored.
+  /// Default is 4096.
+  vtkSetMacro(MaximumNumberOfContacts, int);
+  vtkGetMacro(MaximumNumberOfContacts, int);
+
+  /// Minimum time, in seconds, between two gatherings of the contacts
+  /// displayed by observeContacts(). Default is 1/30.
+  vtkSetMacro(ContactPublishPeriod, double);
+  vtkGetMacro(ContactPublishPeriod, double);
+
+  /// Policies for pushing simulation state into MRML
+  enum SyncMode
+  {
+    /// The simulation publishes at most at its publish frequency, steps in
+    /// between are dropped without any copy.
+    SyncFixedRate = 0,
+    /// The simulation publishes every step and MRML only receives the latest
+    /// state at each display refresh.
+    SyncOnRender
+  };
+
+  /// Lifecycle of the simulations run by the logic
+  enum SimulationState
+  {
+    /// No simulation, or a simulation advanced by the caller
+    SimulationNone = 0,
+    /// Threads are joined, the scene is kept for a restart
+    SimulationStopped,
+    SimulationRunning,
+    SimulationPaused
+  };
+
+  /// States of the requests returned by the asynchronous methods
+  enum RequestState
+  {
+    RequestPending = 0,
+    RequestCompleted,
+    RequestFailed,
+    /// The simulation was stopped before the request completed
+    RequestCanceled
+  };
+
+  enum
+  {
+    /// Invoked on the main thread, by processPendingUpdates(), when a
+    /// request finishes. The call data is a pointer to the request ID (int).
+    RequestFinishedEvent = vtkCommand::UserEvent + 1
+  };
+
+  /// Counters of pose updates produced by a simulation.
+  /// Updates = Dropped + Coalesced + Published, plus the ones still pending.
+  struct SyncStatistics
+  {
+    /// Pose updates produced by the simulation steps
+    std::uint64_t Updates = 0;
+    /// Updates skipped by the publish rate limiter
+    std::uint64_t Dropped = 0;
+    /// Updates overwritten by a newer one before reaching MRML
+    std::uint64_t Coalesced = 0;
+    /// Updates applied to MRML nodes
+    std::uint64_t Published = 0;
+  };
+
+  /// Hot path measurements of a simulation, over its most recent samples.
+  /// All durations are in microseconds.
+  struct SimulationStatistics
+  {
+    /// Duration of the scene manager steps, postUpdate callbacks excluded
+    vtkSlicerIMSTKRollingStatistics::Summary StepDuration;
+    /// Duration of each postUpdate callback publishing to MRML
+    vtkSlicerIMSTKRollingStatistics::Summary CallbackDuration;
+    /// Delay between a pose being published and being applied to MRML
+    vtkSlicerIMSTKRollingStatistics::Summary PoseLatency;
+    /// Time elapsed between the start of two consecutive steps
+    vtkSlicerIMSTKRollingStatistics::Summary ActualDt;
+    /// Time step requested by the scene manager
+    double RequestedDt = 0.0;
+    SyncStatistics Sync;
+  };
+
+  /// Throughput of a batch run, see runBatchSimulation()
+  struct BatchStatistics
+  {
+    int Steps = 0;
+    /// Simulated and elapsed time, in seconds
+    double SimulatedTime = 0.0;
+    double WallTime = 0.0;
+    double StepsPerSecond = 0.0;
+    /// Simulated time over elapsed time
+    double RealTimeFactor = 0.0;
+    /// Duration of the most recent steps, in microseconds
+    vtkSlicerIMSTKRollingStatistics::Summary StepDuration;
+  };
+
+  /// Attributes of the parameter node of a simulation, see setParameterNode():
+  /// simulated time of each step (in seconds), and translation scaling of the
+  /// device controllers.
+  static const char* TimeStepAttributeName;
+  static const char* TranslationScalingAttributeName;
+  /// References of the parameter node to the nodes of
+  /// runObjectCtrlDummyClientExample()
+  static const char* InputModelReferenceRole;
+  static const char* OutputModelReferenceRole;
+  static const char* OutputTransformReferenceRole;
+
+  /// Associate a scene manager advanced by the caller with \a simName, so
+  /// that its objects can be observed with observeRigidBody() and
+  /// observeDeformableBody().
+  /// Buffers are allocated when objects are observed: once the first steps
+  /// are done, the callbacks added to the scene manager do not allocate.
+  void registerSimulation(std::string simName, std::shared_ptr<imstk::SceneManager> sceneManager);
+
   void runObjectCtrlDummyClientExample(std::string simName, vtkMRMLModelNode* inputNode, vtkMRMLModelNode* outputNode, vtkMRMLLinearTransformNode* outputTransformNode);
   void observeRigidBody(std::shared_ptr<imstk::SceneManager> sceneManager, std::shared_ptr<imstk::SceneObject> object, vtkMRMLModelNode* outputNode, vtkMRMLLinearTransformNode* outputTransformNode);
+
+  /// Observe several rigid bodies with a single postUpdate callback.
+  /// Their transforms are gathered in one pass into a contiguous
+  /// structure-of-arrays buffer, and only the transforms that changed are
+  /// applied to MRML. Prefer this over calling observeRigidBody() for each
+  /// object of large scenes.
+  void observeRigidBodies(std::shared_ptr<imstk::SceneManager> sceneManager,
+    const std::vector<std::shared_ptr<imstk::SceneObject>>& objects,
+    const std::vector<vtkMRMLModelNode*>& outputNodes,
+    const std::vector<vtkMRMLLinearTransformNode*>& outputTransformNodes);
+
+  /// Stream the vertices of a deformable object to \a outputNode.
+  /// The connectivity is copied once, then only vertex positions (and normals
+  /// if \a updateNormals is true) are updated, through preallocated buffers
+  /// adopted by the model points without any per-frame allocation.
+  /// If \a sharedBuffer is true, the model points directly reference the
+  /// iMSTK vertex buffer: nothing is copied but the display may show a step
+  /// in progress.
+  void observeDeformableBody(std::shared_ptr<imstk::SceneManager> sceneManager, std::shared_ptr<imstk::SceneObject> object, vtkMRMLModelNode* outputNode, bool updateNormals = false, bool sharedBuffer = false);
+
+  /// Return a copy of the decimated mesh of \a modelNode, or null if the
+  /// model has no more than LevelOfDetailTriangles triangles. Objects
+  /// simulated on it are observed with observeDecimatedBody().
+  std::shared_ptr<imstk::SurfaceMesh> getLevelOfDetail(vtkMRMLModelNode* modelNode);
+
+  /// Same as observeDeformableBody() for an object whose visual geometry is
+  /// the level of detail of \a outputNode (see getLevelOfDetail()): its
+  /// motion is mapped onto the full resolution mesh of \a outputNode.
+  void observeDecimatedBody(std::shared_ptr<imstk::SceneManager> sceneManager, std::shared_ptr<imstk::SceneObject> object, vtkMRMLModelNode* outputNode, bool updateNormals = false);
+
+  /// Display the contacts found by collision detection algorithms in
+  /// \a outputNode: one vertex per contact point, with the contact normals
+  /// as point normals and the penetration depths as "PenetrationDepth"
+  /// scalars. Contacts are gathered after the steps of \a sceneManager, at
+  /// most every ContactPublishPeriod seconds, and only sent to MRML when they
+  /// changed. Only the contacts of the first geometry of each collision
+  /// data are displayed, those of the second one being the same seen from
+  /// the other side.
+  void observeContacts(std::shared_ptr<imstk::SceneManager> sceneManager,
+    const std::vector<std::shared_ptr<imstk::CollisionData>>& collisionData, vtkMRMLModelNode* outputNode);
+
+  /// Model displaying the contacts of the scenes built by
+  /// buildSceneFromMRML() as \a simName, see observeContacts(). It is used
+  /// from the next build on, and kept when the scene is rebuilt. Null
+  /// disables the contact display.
+  void setContactOutput(std::string simName, vtkMRMLModelNode* outputNode);
+  vtkMRMLModelNode* getContactOutput(std::string simName);
+
   void runHapticDeviceExample(std::string simName, std::string deviceName, vtkMRMLLinearTransformNode* outputTransformNode);
+
+  /// Same as runHapticDeviceExample() for several devices sharing a single
+  /// scene, for bimanual procedures: the pose of device \a i is displayed by
+  /// \a outputTransformNodes[i]. Each device is sampled by its own task of
+  /// the haptics lane, which run one after the other unless the lane has
+  /// more cores (see vtkSlicerIMSTKScheduler::SetLaneCores()), and the poses
+  /// of all the devices are applied to MRML together, at the same display
+  /// time. Device \a i replays stream \a i
+  /// of the log given to setDeviceReplay(), if any.
+  void runHapticDevicesExample(std::string simName,
+    const std::vector<std::string>& deviceNames,
+    const std::vector<vtkMRMLLinearTransformNode*>& outputTransformNodes);
+
+  /// Stop a simulation and wait for its threads to exit.
+  /// The scene and its connection to MRML are kept so that startSimulation()
+  /// can restart it without rebuilding anything. See releaseSimulation().
   void stopSimulation(std::string simName);
 
+  /// Restart a stopped simulation. If \a reset is true, the scene objects
+  /// are first reset to their initial state.
+  void startSimulation(std::string simName, bool reset = true);
+
+  /// Suspend the steps of a running simulation, its threads keep running
+  void pauseSimulation(std::string simName);
+  void resumeSimulation(std::string simName);
+
+  /// Stop a simulation and free its scene. Running a simulation with the
+  /// name of an existing one also releases the previous one.
+  void releaseSimulation(std::string simName);
+
+  /// Return the SimulationState of \a simName
+  int getSimulationState(std::string simName);
+
+  /// Advance a simulation by \a numberOfSteps steps of \a dt seconds, as
+  /// fast as possible, in the calling thread. The simulation is stopped
+  /// first, and the scene reset to its initial state if \a reset is true.
+  /// MRML is only updated at the end, and every \a syncInterval steps if not 0.
+  /// Scenes of \a simName built by buildSceneFromMRML() meanwhile are only
+  /// started once the run completes, and the simulation cannot be released
+  /// during the run.
+  /// The transforms observed by observeRigidBodies() or buildSceneFromMRML()
+  /// after each step are stored in getBatchTrajectory().
+  BatchStatistics runBatchSimulation(std::string simName, int numberOfSteps, double dt,
+    int syncInterval = 0, bool reset = true);
+
+  /// Same as runBatchSimulation() for several independent simulations,
+  /// advanced in parallel. MRML is only updated at the end. Nothing is run
+  /// if a name is given more than once.
+  std::vector<BatchStatistics> runBatchSimulations(const std::vector<std::string>& simNames,
+    int numberOfSteps, double dt, bool reset = true);
+
+  /// Trajectory of the last batch run of \a simName: one tuple per step,
+  /// holding the row-major 4x4 matrices of the observed transforms one after
+  /// the other, in observation order.
+  vtkDoubleArray* getBatchTrajectory(std::string simName);
+
+  /// Build a scene from the model nodes tagged with iMSTK attributes (see
+  /// vtkSlicerIMSTKSceneBuilder) and run it as \a simName.
+  /// MRML is read immediately but the iMSTK scene is assembled in a worker
+  /// thread, the simulation is started by processPendingUpdates() once the
+  /// scene is ready. Tagged models must not be modified in the meantime.
+  /// Rigid models are placed under a transform node receiving their pose,
+  /// created on first build and referenced by the model afterward.
+  /// Stopping the simulation before the scene is ready cancels its start.
+  void buildSceneFromMRML(std::string simName);
+
+  /// Return true while the scene of \a simName is being built
+  bool isBuildingScene(std::string simName);
+
+  /// Asynchronous variants of buildSceneFromMRML(), startSimulation(),
+  /// precomputeCollisionData() and generateVolumeMesh(). They return a
+  /// request ID at once, whose RequestState can be polled with
+  /// getRequestState() and whose end is notified by RequestFinishedEvent.
+  /// A scene build completes when its simulation is started, a start when
+  /// all the modules of the simulation are initialized.
+  int buildSceneFromMRMLAsync(std::string simName);
+  int startSimulationAsync(std::string simName, bool reset = true);
+  int precomputeCollisionDataAsync(vtkMRMLModelNode* modelNode);
+  int generateVolumeMeshAsync(vtkMRMLNode* node, std::string segmentId = "");
+
+  /// Return the RequestState of \a requestId, or -1 if it is unknown.
+  /// Only the state of the most recent finished requests is kept.
+  int getRequestState(int requestId);
+
+  /// Apply the latest poses published by the running simulations to their
+  /// MRML transform nodes.
+  /// The simulation threads never touch MRML directly, they publish into a
+  /// lock-free mailbox that must be drained from the main thread by calling
+  /// this method periodically (the module does it at display rate).
+  /// Scenes built by buildSceneFromMRML() are also started from here, and
+  /// RequestFinishedEvent is invoked from here.
+  void processPendingUpdates();
+
+  /// Set how the simulation state is synchronized to MRML. See SyncMode.
+  /// Settings may be set before the simulation is started and are kept when
+  /// it is restarted.
+  /// Getters do not create the simulation: unknown simulations report the
+  /// default settings and empty statistics, and writeChromeTrace() fails.
+  void setSyncMode(std::string simName, int mode);
+  int getSyncMode(std::string simName);
+
+  /// Maximum rate (in Hz) at which a simulation publishes to MRML when
+  /// using SyncFixedRate. Default is 60 Hz. MRML is never updated faster than
+  /// processPendingUpdates() is called.
+  void setPublishFrequency(std::string simName, double frequency);
+  double getPublishFrequency(std::string simName);
+
+  /// Update counters of a simulation since it was (re)started.
+  SyncStatistics getSyncStatistics(std::string simName);
+
+  /// Timing statistics of a simulation since it was (re)started.
+  SimulationStatistics getSimulationStatistics(std::string simName);
+
+  /// Record the steps, postUpdate callbacks and MRML updates of a simulation
+  /// in a fixed-size ring of trace events. Disabled by default. The ring is
+  /// allocated when tracing is first enabled, and kept with its events when
+  /// the simulation is restarted.
+  void setTracing(std::string simName, bool enabled);
+
+  /// Write the recorded trace events of a simulation in the Chrome trace
+  /// event format (see chrome://tracing or https://ui.perfetto.dev).
+  bool writeChromeTrace(std::string simName, std::string fileName);
+
+  /// Cache of the model geometries converted to iMSTK, keyed by model node ID.
+  /// Entries are removed with their model node.
+  vtkSlicerIMSTKGeometryCache* getGeometryCache();
+
+  /// Thread pool stepping the modules of the headless simulations. Device
+  /// managers run in its haptics lane, scene managers in its physics lane.
+  vtkSlicerIMSTKScheduler* getScheduler();
+
+  /// Compute the collision data of \a modelNode in the background, unless
+  /// it is already available in memory or on disk.
+  void precomputeCollisionData(vtkMRMLModelNode* modelNode);
+
+  /// Return true while collision data is being precomputed
+  bool isPrecomputingCollisionData();
+
+  /// Directory where precomputed collision data is stored. An empty
+  /// directory (default) means the IMSTKCollisionData directory next to the
+  /// scene, or no storage on disk if the scene has not been saved or loaded
+  /// from a file.
+  void setCollisionDataDirectory(std::string directory);
+  std::string getCollisionDataDirectory();
+
+  /// Generate in the background the tetrahedral mesh of a closed surface
+  /// model, or of a segment of a segmentation node (the first one if
+  /// \a segmentId is empty), see vtkSlicerIMSTKVolumeMesh. Nothing is done
+  /// if it is already available in memory or in the collision data
+  /// directory for the current cell size and quality.
+  void generateVolumeMesh(vtkMRMLNode* node, std::string segmentId = "");
+
+  /// Return true while volume meshes are being generated
+  bool isGeneratingVolumeMesh();
+
+  /// Return the tetrahedral mesh generated for \a node and the map of its
+  /// surface points, from memory or disk, or null if it was not generated.
+  /// The mesh is a copy that can be simulated.
+  std::shared_ptr<vtkSlicerIMSTKVolumeMesh::Tetrahedralization> getVolumeMesh(vtkMRMLNode* node, std::string segmentId = "");
+
+  /// Record the device poses of a simulation and the transforms it pushes to
+  /// MRML into \a fileName (see vtkSlicerIMSTKSessionLog). Recording can be
+  /// started before the simulation and goes on until stopRecording().
+  bool startRecording(std::string simName, std::string fileName);
+  void stopRecording(std::string simName);
+
+  /// Replace the devices of the examples started afterward by the device
+  /// poses recorded in \a fileName, so that they run without hardware.
+  /// If \a realTime is false, the log is replayed in simulation time and
+  /// gives the same device motion whatever the speed of the simulation: the
+  /// replay advances by the time step of each scene step, including the
+  /// steps of runBatchSimulation(). Batch runs that reset the scene do not
+  /// rewind the replay.
+  /// An empty file name goes back to the devices.
+  bool setDeviceReplay(std::string fileName, bool realTime = true);
+
+  /// Export the poses of the rigid bodies and devices observed from now on
+  /// to the POSIX shared memory segment \a name, so that other processes of
+  /// this machine can read them without locking (see
+  /// vtkSlicerIMSTKPoseSharedMemory). Poses are named
+  /// "<simName>/<transform node name>", or after the device when it has no
+  /// transform node, and written by the simulation threads at every step,
+  /// whatever the SyncMode. Each pose has its own slot, reused when its
+  /// simulation is restarted. At most \a capacity poses are exported.
+  /// Returns false if the segment cannot be created.
+  bool startPoseExport(std::string name = "SlicerIMSTKPoses", int capacity = 256);
+
+  /// Remove the segment. Running simulations keep writing to its memory,
+  /// which readers that opened it can still read.
+  void stopPoseExport();
+  bool isExportingPoses();
+
+  /// Apply the parameters of \a parameterNode (see TimeStepAttributeName)
+  /// to the simulation \a simName, and keep applying their changes, as well
+  /// as the changes of the models the simulation was built from, without
+  /// restarting it. Changes are applied to the running scene before its
+  /// next step:
+  /// - time step and controller parameters;
+  /// - model colors, and the transforms of static models;
+  /// - point edits of models colliding with their own mesh;
+  /// - a new output transform, the output model is moved under it.
+  /// Other changes (object type, mass, connectivity, input model...) rebuild
+  /// and restart the simulation. The parameter node is kept when the
+  /// simulation is rebuilt. Null stops observing the parameter node.
+  void setParameterNode(std::string simName, vtkMRMLNode* parameterNode);
+  vtkMRMLNode* getParameterNode(std::string simName);
+
+  /// Capture the state of the objects and controllers of simulation
+  /// \a simName into the in-memory snapshot \a snapshotName (see
+  /// vtkSlicerIMSTKSnapshot): transforms, vertices of the non-rigid objects
+  /// and rigid body states. Only the objects built by the logic, from MRML
+  /// or by the examples, are captured.
+  /// Running scenes are captured before their next step, which is only
+  /// delayed by the copy of the state to memory allocated beforehand; paused
+  /// ones when they are resumed. Snapshots are not modified once captured,
+  /// so restoring or writing one never blocks the simulations.
+  /// Returns a request ID, see getRequestState(). The snapshot is replaced
+  /// when the request completes.
+  int saveSnapshotAsync(std::string simName, std::string snapshotName);
+
+  /// Restore \a snapshotName into simulation \a simName before its next
+  /// step. The simulation must have been built from the same models as the
+  /// one the snapshot was taken from: this resets a simulation without
+  /// rebuilding it, or starts "what-if" branches from a common state.
+  /// Returns false if the snapshot or the simulation does not exist.
+  bool restoreSnapshot(std::string simName, std::string snapshotName);
+
+  /// Write a snapshot to \a fileName, or read one as \a snapshotName. Read
+  /// snapshots are restored from their memory mapping: their file must not
+  /// be overwritten while they are kept.
+  bool writeSnapshot(std::string snapshotName, std::string fileName);
+  bool readSnapshot(std::string fileName, std::string snapshotName);
+  void removeSnapshot(std::string snapshotName);
+
 protected:
   vtkSlicerIMSTKLogic();
   ~vtkSlicerIMSTKLogic() override;
@@ -73,11 +531,37 @@ protected:
   void UpdateFromMRMLScene() override;
   void OnMRMLSceneNodeAdded(vtkMRMLNode* node) override;
   void OnMRMLSceneNodeRemoved(vtkMRMLNode* node) override;
+  void ProcessMRMLNodesEvents(vtkObject* caller, unsigned long event, void* callData) override;
+
+  /// Observe the parameter nodes of the simulations and the models they were
+  /// built from, and stop observing the nodes no longer used
+  void UpdateTunedNodeObservations();
+
+  /// Apply the changes of a parameter node or model node to the simulations
+  /// using it, rebuilding those that cannot be updated
+  void ApplyTunedNodeChanges(vtkMRMLNode* node, unsigned long event);
+
+  bool Headless;
+  int MRMLBatchThreshold;
+  double PoseExtrapolation;
+  bool PrecomputeCollisionData;
+  int LevelOfDetailTriangles;
+  double VolumeMeshCellSize;
+  double VolumeMeshMinimumQuality;
+  int MaximumNumberOfContacts;
+  double ContactPublishPeriod;
+  std::string CollisionDataDirectory;
+
 private:
 
   vtkSlicerIMSTKLogic(const vtkSlicerIMSTKLogic&); // Not implemented
   void operator=(const vtkSlicerIMSTKLogic&); // Not implemented
-  std::map<std::string,std::shared_ptr<imstk::SimulationManager>> simulations;
+
+  /// Start the simulation of a scene built by buildSceneFromMRML()
+  void startBuiltScene(const std::string& simName);
+
+  class vtkInternal;
+  vtkInternal* Internal;
 };
 
 #endif
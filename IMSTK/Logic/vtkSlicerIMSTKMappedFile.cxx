@@ -0,0 +1,198 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKMappedFile.h"
+
+#ifdef _WIN32
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKMappedFile::vtkSlicerIMSTKMappedFile() = default;
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKMappedFile::~vtkSlicerIMSTKMappedFile()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKMappedFile::Open(const std::string& fileName, int mode, std::size_t size)
+{
+  this->Close();
+  this->OpenMode = mode;
+  const bool write = (mode == ReadWrite);
+#ifdef _WIN32
+  HANDLE file = CreateFileA(fileName.c_str(),
+    write ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+    FILE_SHARE_READ, nullptr, write ? OPEN_ALWAYS : OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+  this->File = file;
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize))
+  {
+    this->Close();
+    return false;
+  }
+  this->Size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+  this->File = open(fileName.c_str(), write ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+  if (this->File < 0)
+  {
+    return false;
+  }
+  struct stat status;
+  if (fstat(this->File, &status) != 0)
+  {
+    this->Close();
+    return false;
+  }
+  this->Size = static_cast<std::size_t>(status.st_size);
+#endif
+  if (write && size > 0)
+  {
+    return this->Resize(size);
+  }
+  if (!this->Map())
+  {
+    this->Close();
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKMappedFile::Close()
+{
+  this->Unmap();
+#ifdef _WIN32
+  if (this->File)
+  {
+    CloseHandle(this->File);
+    this->File = nullptr;
+  }
+#else
+  if (this->File >= 0)
+  {
+    close(this->File);
+    this->File = -1;
+  }
+#endif
+  this->Size = 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKMappedFile::Resize(std::size_t size)
+{
+  if (!this->IsOpen() || this->OpenMode != ReadWrite)
+  {
+    return false;
+  }
+  this->Unmap();
+#ifdef _WIN32
+  LARGE_INTEGER position;
+  position.QuadPart = static_cast<LONGLONG>(size);
+  const bool resized = SetFilePointerEx(this->File, position, nullptr, FILE_BEGIN)
+    && SetEndOfFile(this->File);
+#else
+  const bool resized = ftruncate(this->File, static_cast<off_t>(size)) == 0;
+#endif
+  if (!resized)
+  {
+    this->Close();
+    return false;
+  }
+  this->Size = size;
+  if (!this->Map())
+  {
+    this->Close();
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKMappedFile::IsOpen() const
+{
+#ifdef _WIN32
+  return this->File != nullptr;
+#else
+  return this->File >= 0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKMappedFile::Map()
+{
+  if (this->Size == 0)
+  {
+    // Empty files cannot be mapped
+    return true;
+  }
+  const bool write = (this->OpenMode == ReadWrite);
+#ifdef _WIN32
+  this->Mapping = CreateFileMappingA(this->File, nullptr, write ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+  if (!this->Mapping)
+  {
+    return false;
+  }
+  this->Data = static_cast<char*>(MapViewOfFile(this->Mapping, write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, this->Size));
+  return this->Data != nullptr;
+#else
+  void* data = mmap(nullptr, this->Size, write ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, this->File, 0);
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+  this->Data = static_cast<char*>(data);
+  return true;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKMappedFile::Unmap()
+{
+#ifdef _WIN32
+  if (this->Data)
+  {
+    UnmapViewOfFile(this->Data);
+  }
+  if (this->Mapping)
+  {
+    CloseHandle(this->Mapping);
+    this->Mapping = nullptr;
+  }
+#else
+  if (this->Data)
+  {
+    munmap(this->Data, this->Size);
+  }
+#endif
+  this->Data = nullptr;
+}
@@ -0,0 +1,77 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKMappedFile_h
+#define __vtkSlicerIMSTKMappedFile_h
+
+// STD includes
+#include <cstddef>
+#include <string>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+/// \brief File mapped in memory, on POSIX systems and Windows.
+///
+/// Files opened for writing are created if needed and can be resized, which
+/// remaps them: pointers returned by GetData() are invalidated by Resize().
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKMappedFile
+{
+public:
+  enum Mode
+  {
+    ReadOnly = 0,
+    ReadWrite
+  };
+
+  vtkSlicerIMSTKMappedFile();
+  ~vtkSlicerIMSTKMappedFile();
+
+  /// Map \a fileName. In ReadWrite mode, the file is created if it does not
+  /// exist and resized to \a size if \a size is not 0.
+  /// Returns false on error.
+  bool Open(const std::string& fileName, int mode, std::size_t size = 0);
+
+  /// Unmap and close the file
+  void Close();
+
+  /// Change the size of a file opened in ReadWrite mode and map it again.
+  /// Returns false on error, in which case the file is closed.
+  bool Resize(std::size_t size);
+
+  bool IsOpen() const;
+  char* GetData() const { return this->Data; }
+  std::size_t GetSize() const { return this->Size; }
+
+private:
+  bool Map();
+  void Unmap();
+
+  char* Data = nullptr;
+  std::size_t Size = 0;
+  int OpenMode = ReadOnly;
+#ifdef _WIN32
+  void* File = nullptr;
+  void* Mapping = nullptr;
+#else
+  int File = -1;
+#endif
+
+  vtkSlicerIMSTKMappedFile(const vtkSlicerIMSTKMappedFile&) = delete;
+  void operator=(const vtkSlicerIMSTKMappedFile&) = delete;
+};
+
+#endif
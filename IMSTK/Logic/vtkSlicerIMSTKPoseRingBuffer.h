@@ -0,0 +1,205 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKPoseRingBuffer_h
+#define __vtkSlicerIMSTKPoseRingBuffer_h
+
+// STD includes
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+/// \brief Single-producer/single-consumer lock-free history of timestamped poses.
+///
+/// The producer (typically a device sampling task running at the device
+/// rate) calls Push(). The consumer (typically the Slicer main thread) calls
+/// Interpolate() to get the pose at any time covered by the history,
+/// extrapolated for a short while past the most recent sample.
+///
+/// Neither side blocks: the consumer copies the samples it needs and checks
+/// afterward that the producer did not wrap around onto them, in which case
+/// it tries again.
+class vtkSlicerIMSTKPoseRingBuffer
+{
+public:
+  typedef std::chrono::steady_clock ClockType;
+
+  /// Number of samples kept, must be a power of 2
+  static const std::uint64_t Capacity = 64;
+
+  struct Sample
+  {
+    std::array<double, 3> Position{ { 0.0, 0.0, 0.0 } };
+    /// Unit quaternion (w, x, y, z)
+    std::array<double, 4> Orientation{ { 1.0, 0.0, 0.0, 0.0 } };
+    ClockType::time_point Timestamp;
+  };
+
+  vtkSlicerIMSTKPoseRingBuffer()
+    : Head(0)
+  {
+  }
+
+  /// Append a sample. Timestamps must be increasing.
+  /// Only call from the producer thread.
+  void Push(const Sample& sample)
+  {
+    const std::uint64_t head = this->Head.load(std::memory_order_relaxed);
+    this->Samples[head & (Capacity - 1)] = sample;
+    this->Head.store(head + 1, std::memory_order_release);
+  }
+
+  /// Total number of samples pushed
+  std::uint64_t GetNumberOfSamples() const { return this->Head.load(std::memory_order_acquire); }
+
+  /// Compute the pose at \a time as a row-major 4x4 matrix, as expected by
+  /// vtkMatrix4x4::DeepCopy. Poses between two samples are interpolated,
+  /// poses after the most recent sample are extrapolated from the last two
+  /// samples, by \a maxExtrapolation seconds at most. \a newest is set to
+  /// the timestamp of the most recent sample.
+  /// Returns false if no sample was pushed yet.
+  /// Only call from the consumer thread.
+  bool Interpolate(ClockType::time_point time, double maxExtrapolation,
+    double* matrix, ClockType::time_point* newest = nullptr) const
+  {
+    Sample before;
+    Sample after;
+    for (;;)
+    {
+      const std::uint64_t head = this->Head.load(std::memory_order_acquire);
+      if (head == 0)
+      {
+        return false;
+      }
+      // The oldest slot may be being overwritten by the next sample
+      const std::uint64_t oldest = head >= Capacity ? head - Capacity + 1 : 0;
+      std::uint64_t first = head - 1;
+      after = this->Samples[first & (Capacity - 1)];
+      before = after;
+      if (newest)
+      {
+        *newest = after.Timestamp;
+      }
+      if (first > oldest)
+      {
+        before = this->Samples[--first & (Capacity - 1)];
+      }
+      // Walk back to the samples surrounding the requested time
+      while (time < before.Timestamp && first > oldest)
+      {
+        after = before;
+        before = this->Samples[--first & (Capacity - 1)];
+      }
+      // Retry if the copied samples were overwritten meanwhile
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (this->Head.load(std::memory_order_relaxed) - first < Capacity)
+      {
+        break;
+      }
+    }
+
+    double alpha = 1.0;
+    const std::chrono::duration<double> span = after.Timestamp - before.Timestamp;
+    if (span.count() > 0.0)
+    {
+      const std::chrono::duration<double> offset =
+        std::min(time, after.Timestamp + std::chrono::duration_cast<ClockType::duration>(
+          std::chrono::duration<double>(maxExtrapolation))) - before.Timestamp;
+      alpha = std::max(0.0, offset.count() / span.count());
+    }
+
+    std::array<double, 3> position;
+    for (int i = 0; i < 3; i++)
+    {
+      position[i] = before.Position[i] + alpha * (after.Position[i] - before.Position[i]);
+    }
+    std::array<double, 4> orientation;
+    Slerp(before.Orientation, after.Orientation, alpha, orientation);
+    ToMatrix(position, orientation, matrix);
+    return true;
+  }
+
+  /// Spherical interpolation between unit quaternions \a q0 and \a q1,
+  /// extrapolated for \a alpha greater than 1.
+  static void Slerp(const std::array<double, 4>& q0, const std::array<double, 4>& q1, double alpha,
+    std::array<double, 4>& result)
+  {
+    double dot = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+    // Take the shortest path
+    const double sign = dot < 0.0 ? -1.0 : 1.0;
+    dot = std::min(1.0, dot * sign);
+    double w0 = 1.0 - alpha;
+    double w1 = alpha;
+    const double angle = std::acos(dot);
+    if (angle > 1e-6)
+    {
+      const double sinAngle = std::sin(angle);
+      w0 = std::sin((1.0 - alpha) * angle) / sinAngle;
+      w1 = std::sin(alpha * angle) / sinAngle;
+    }
+    double norm = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+      result[i] = w0 * q0[i] + w1 * sign * q1[i];
+      norm += result[i] * result[i];
+    }
+    norm = std::sqrt(norm);
+    for (int i = 0; i < 4; i++)
+    {
+      result[i] /= norm;
+    }
+  }
+
+  /// Write the rigid transform made of \a position and the unit quaternion
+  /// \a orientation into \a matrix, a row-major 4x4 matrix.
+  static void ToMatrix(const std::array<double, 3>& position, const std::array<double, 4>& orientation,
+    double* matrix)
+  {
+    const double w = orientation[0];
+    const double x = orientation[1];
+    const double y = orientation[2];
+    const double z = orientation[3];
+    matrix[0] = 1.0 - 2.0 * (y * y + z * z);
+    matrix[1] = 2.0 * (x * y - w * z);
+    matrix[2] = 2.0 * (x * z + w * y);
+    matrix[3] = position[0];
+    matrix[4] = 2.0 * (x * y + w * z);
+    matrix[5] = 1.0 - 2.0 * (x * x + z * z);
+    matrix[6] = 2.0 * (y * z - w * x);
+    matrix[7] = position[1];
+    matrix[8] = 2.0 * (x * z - w * y);
+    matrix[9] = 2.0 * (y * z + w * x);
+    matrix[10] = 1.0 - 2.0 * (x * x + y * y);
+    matrix[11] = position[2];
+    matrix[12] = 0.0;
+    matrix[13] = 0.0;
+    matrix[14] = 0.0;
+    matrix[15] = 1.0;
+  }
+
+private:
+  std::array<Sample, Capacity> Samples;
+  std::atomic<std::uint64_t> Head;
+
+  vtkSlicerIMSTKPoseRingBuffer(const vtkSlicerIMSTKPoseRingBuffer&) = delete;
+  void operator=(const vtkSlicerIMSTKPoseRingBuffer&) = delete;
+};
+
+#endif
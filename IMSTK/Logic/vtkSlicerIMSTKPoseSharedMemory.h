@@ -0,0 +1,365 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKPoseSharedMemory_h
+#define __vtkSlicerIMSTKPoseSharedMemory_h
+
+// STD includes
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// \brief Poses published to other processes through POSIX shared memory.
+///
+/// The segment holds a header followed by a fixed number of slots, one per
+/// pose. Each slot is protected by its own sequence lock: its writer makes
+/// the sequence odd, writes the pose and makes it even again, and readers
+/// retry until they read the same even sequence before and after copying
+/// the pose. Readers never block the writer nor each other, and never see a
+/// partially written pose.
+///
+/// Poses are added by a single thread (AddPose()), each slot must then be
+/// published by a single thread at a time (Publish()), any number of
+/// processes and threads can read them. Poses published by different
+/// threads must therefore be added separately, even if they have the same
+/// name.
+///
+/// This header only depends on the standard library so that it can be used
+/// by the reader processes as is:
+/// \code
+/// vtkSlicerIMSTKPoseSharedMemory poses;
+/// poses.Open("/SlicerIMSTKPoses");
+/// vtkSlicerIMSTKPoseSharedMemory::Pose pose;
+/// poses.Read(poses.FindPose("Simulation/Tool pose"), pose);
+/// \endcode
+///
+/// Only POSIX systems are supported, Create() and Open() fail elsewhere.
+class vtkSlicerIMSTKPoseSharedMemory
+{
+public:
+  typedef std::chrono::steady_clock ClockType;
+
+  enum
+  {
+    Version = 1,
+    NameLength = 64
+  };
+
+  struct Pose
+  {
+    char Name[NameLength];
+    /// Row-major 4x4 matrix, from the object to the world
+    double Matrix[16];
+    /// ClockType time of the pose in nanoseconds. On Linux, this is
+    /// CLOCK_MONOTONIC, which is shared by all the processes.
+    std::int64_t Timestamp;
+    /// Number of times the pose was published
+    std::uint64_t Count;
+  };
+
+  vtkSlicerIMSTKPoseSharedMemory() = default;
+  vtkSlicerIMSTKPoseSharedMemory(const vtkSlicerIMSTKPoseSharedMemory&) = delete;
+  vtkSlicerIMSTKPoseSharedMemory& operator=(const vtkSlicerIMSTKPoseSharedMemory&) = delete;
+  ~vtkSlicerIMSTKPoseSharedMemory() { this->Close(); }
+
+  /// Create the segment \a name with room for \a capacity poses, replacing
+  /// any segment with the same name (readers of the previous one keep
+  /// reading it). Names start with a '/', one is prepended otherwise.
+  bool Create(const std::string& name, int capacity)
+  {
+    this->Close();
+#ifndef _WIN32
+    if (capacity <= 0)
+    {
+      return false;
+    }
+    const std::string segmentName = GetSegmentName(name);
+    shm_unlink(segmentName.c_str());
+    const int fd = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+      return false;
+    }
+    const std::size_t size = sizeof(Header) + static_cast<std::size_t>(capacity) * sizeof(Slot);
+    void* memory = ftruncate(fd, static_cast<off_t>(size)) == 0
+      ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+      shm_unlink(segmentName.c_str());
+      return false;
+    }
+    // The new segment is zero-filled, which is a valid state of the atomics
+    this->Memory = memory;
+    this->Size = size;
+    this->Name = segmentName;
+    this->Writable = true;
+    Header* header = this->GetHeader();
+    header->Version = Version;
+    header->HeaderSize = sizeof(Header);
+    header->SlotSize = sizeof(Slot);
+    header->Capacity = static_cast<std::uint32_t>(capacity);
+    // Readers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->Magic, GetMagic(), sizeof(header->Magic));
+    return true;
+#else
+    (void)name; // unused
+    (void)capacity; // unused
+    return false;
+#endif
+  }
+
+  /// Map the existing segment \a name for reading
+  bool Open(const std::string& name)
+  {
+    this->Close();
+#ifndef _WIN32
+    const std::string segmentName = GetSegmentName(name);
+    const int fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+      return false;
+    }
+    struct stat status;
+    void* memory = MAP_FAILED;
+    std::size_t size = 0;
+    if (fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) >= sizeof(Header))
+    {
+      size = static_cast<std::size_t>(status.st_size);
+      memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+      return false;
+    }
+    this->Memory = memory;
+    this->Size = size;
+    this->Name = segmentName;
+    const Header* header = this->GetHeader();
+    if (std::memcmp(header->Magic, GetMagic(), sizeof(header->Magic)) != 0
+      || header->Version != Version
+      || header->HeaderSize != sizeof(Header)
+      || header->SlotSize != sizeof(Slot)
+      || sizeof(Header) + static_cast<std::size_t>(header->Capacity) * sizeof(Slot) > size)
+    {
+      this->Close();
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+#else
+    (void)name; // unused
+    return false;
+#endif
+  }
+
+  /// Unmap the segment. It is not removed, see Unlink().
+  void Close()
+  {
+#ifndef _WIN32
+    if (this->Memory)
+    {
+      munmap(this->Memory, this->Size);
+    }
+#endif
+    this->Memory = nullptr;
+    this->Size = 0;
+    this->Writable = false;
+  }
+
+  /// Remove the name of the segment, so that no new reader can open it.
+  /// The mapped memory stays valid until Close().
+  void Unlink()
+  {
+#ifndef _WIN32
+    if (this->Writable)
+    {
+      shm_unlink(this->Name.c_str());
+    }
+#endif
+  }
+
+  bool IsOpen() const { return this->Memory != nullptr; }
+
+  int GetCapacity() const
+  {
+    return this->Memory ? static_cast<int>(this->GetHeader()->Capacity) : 0;
+  }
+
+  /// Number of poses that can be read
+  int GetNumberOfPoses() const
+  {
+    return this->Memory
+      ? static_cast<int>(this->GetHeader()->NumberOfPoses.load(std::memory_order_acquire)) : 0;
+  }
+
+  /// Index of the first pose named \a name, or -1
+  int FindPose(const std::string& name) const
+  {
+    const int count = this->GetNumberOfPoses();
+    for (int i = 0; i < count; i++)
+    {
+      const Slot& slot = this->GetSlot(i);
+      if (name.size() < NameLength && std::strncmp(slot.Name, name.c_str(), NameLength) == 0)
+      {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  /// Add a pose named \a name and return its index. Each call adds a slot,
+  /// even if a pose already has the same name, so that every slot keeps a
+  /// single writer; FindPose() returns the first one. Returns -1 if \a name
+  /// is empty or the segment is not writable or full. Names longer than
+  /// NameLength - 1 characters are truncated.
+  int AddPose(const std::string& name)
+  {
+    if (!this->Writable || name.empty())
+    {
+      return -1;
+    }
+    const std::string truncated = name.substr(0, NameLength - 1);
+    Header* header = this->GetHeader();
+    const std::uint32_t index = header->NumberOfPoses.load(std::memory_order_relaxed);
+    if (index >= header->Capacity)
+    {
+      return -1;
+    }
+    Slot& slot = this->GetSlot(static_cast<int>(index));
+    std::memcpy(slot.Name, truncated.c_str(), truncated.size() + 1);
+    // Identity until the first publication
+    for (int e = 0; e < 16; e++)
+    {
+      slot.Matrix[e] = (e % 5 == 0) ? 1.0 : 0.0;
+    }
+    header->NumberOfPoses.store(index + 1, std::memory_order_release);
+    return static_cast<int>(index);
+  }
+
+  /// Write the row-major \a matrix of pose \a index. Lock-free and
+  /// allocation-free.
+  void Publish(int index, const double* matrix, ClockType::time_point timestamp)
+  {
+    if (!this->Writable || index < 0 || index >= this->GetNumberOfPoses())
+    {
+      return;
+    }
+    Slot& slot = this->GetSlot(index);
+    const std::uint64_t sequence = slot.Sequence.load(std::memory_order_relaxed);
+    slot.Sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(slot.Matrix, matrix, sizeof(slot.Matrix));
+    slot.Timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count();
+    slot.Count++;
+    slot.Sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  /// Copy the last published state of pose \a index. Returns false if there
+  /// is no such pose.
+  bool Read(int index, Pose& pose) const
+  {
+    if (index < 0 || index >= this->GetNumberOfPoses())
+    {
+      return false;
+    }
+    const Slot& slot = this->GetSlot(index);
+    for (int attempt = 0;; attempt++)
+    {
+      const std::uint64_t before = slot.Sequence.load(std::memory_order_acquire);
+      if ((before & 1) == 0)
+      {
+        std::memcpy(pose.Matrix, slot.Matrix, sizeof(pose.Matrix));
+        pose.Timestamp = slot.Timestamp;
+        pose.Count = slot.Count;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.Sequence.load(std::memory_order_relaxed) == before)
+        {
+          break;
+        }
+      }
+      // The writer was preempted in the middle of a publication
+      if (attempt >= 64)
+      {
+        std::this_thread::yield();
+      }
+    }
+    // Names are written once, before the pose is counted
+    std::memcpy(pose.Name, slot.Name, sizeof(pose.Name));
+    return true;
+  }
+
+private:
+  struct Header
+  {
+    char Magic[8];
+    std::uint32_t Version;
+    std::uint32_t HeaderSize;
+    std::uint32_t SlotSize;
+    std::uint32_t Capacity;
+    std::atomic<std::uint32_t> NumberOfPoses;
+    char Padding[36];
+  };
+
+  /// Each slot has its own cache lines so that writers of different poses
+  /// do not invalidate each other's
+  struct alignas(64) Slot
+  {
+    std::atomic<std::uint64_t> Sequence;
+    std::int64_t Timestamp;
+    std::uint64_t Count;
+    double Matrix[16];
+    char Name[NameLength];
+  };
+
+  static_assert(sizeof(Header) == 64, "the header must fill one cache line");
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the sequence must be lock-free to be shared between processes");
+
+  static const char* GetMagic() { return "IMSTKPOS"; }
+
+  static std::string GetSegmentName(const std::string& name)
+  {
+    return (!name.empty() && name[0] == '/') ? name : "/" + name;
+  }
+
+  Header* GetHeader() const { return static_cast<Header*>(this->Memory); }
+
+  Slot& GetSlot(int index) const
+  {
+    return reinterpret_cast<Slot*>(static_cast<char*>(this->Memory) + sizeof(Header))[index];
+  }
+
+  void* Memory = nullptr;
+  std::size_t Size = 0;
+  std::string Name;
+  bool Writable = false;
+};
+
+#endif
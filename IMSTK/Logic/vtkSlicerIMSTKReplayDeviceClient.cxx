@@ -0,0 +1,72 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKReplayDeviceClient.h"
+#include "vtkSlicerIMSTKSessionLog.h"
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKReplayDeviceClient::vtkSlicerIMSTKReplayDeviceClient(
+  std::shared_ptr<vtkSlicerIMSTKSessionLog> log, int stream, const std::string& name)
+  : imstk::DummyClient(name)
+  , Log(log)
+  , Stream(stream)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKReplayDeviceClient::~vtkSlicerIMSTKReplayDeviceClient() = default;
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKReplayDeviceClient::Rewind()
+{
+  this->Started = false;
+  this->Time = 0.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKReplayDeviceClient::Advance(double dt)
+{
+  if (this->RealTime)
+  {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!this->Started)
+    {
+      this->Start = now;
+    }
+    this->Time = std::chrono::duration<double>(now - this->Start).count();
+  }
+  else if (this->Started)
+  {
+    this->Time += dt;
+  }
+  this->Started = true;
+
+  std::array<double, 3> position;
+  std::array<double, 4> orientation;
+  if (!this->Log || !this->Log->GetDevicePose(this->Stream, this->Time, position, orientation))
+  {
+    return;
+  }
+  this->setPosition(imstk::Vec3d(position[0], position[1], position[2]));
+  this->setOrientation(imstk::Quatd(orientation[0], orientation[1], orientation[2], orientation[3]));
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKReplayDeviceClient::IsFinished() const
+{
+  return !this->Log || this->Time >= this->Log->GetDuration();
+}
@@ -0,0 +1,72 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKReplayDeviceClient_h
+#define __vtkSlicerIMSTKReplayDeviceClient_h
+
+// iMSTK includes
+#include <imstkDummyClient.h>
+
+// STD includes
+#include <chrono>
+#include <memory>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+class vtkSlicerIMSTKSessionLog;
+
+/// \brief Device client replaying the poses of a device recorded in a
+/// session log.
+///
+/// The client is moved by Advance(), typically called once per device or
+/// simulation step. In real time mode, the replay follows the wall clock
+/// since the first call. Otherwise it advances by the given time step, so
+/// that a simulation stepping as fast as possible replays the log
+/// deterministically.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKReplayDeviceClient : public imstk::DummyClient
+{
+public:
+  vtkSlicerIMSTKReplayDeviceClient(std::shared_ptr<vtkSlicerIMSTKSessionLog> log, int stream = 0,
+    const std::string& name = "ReplayDeviceClient");
+  ~vtkSlicerIMSTKReplayDeviceClient() override;
+
+  void SetRealTime(bool realTime) { this->RealTime = realTime; }
+  bool GetRealTime() const { return this->RealTime; }
+
+  /// Go back to the beginning of the log
+  void Rewind();
+
+  /// Move the device to its recorded pose \a dt seconds later, or at the
+  /// current time in real time mode.
+  void Advance(double dt);
+
+  /// Replay time, in seconds
+  double GetTime() const { return this->Time; }
+
+  /// True once the end of the log is reached
+  bool IsFinished() const;
+
+private:
+  std::shared_ptr<vtkSlicerIMSTKSessionLog> Log;
+  int Stream = 0;
+  bool RealTime = false;
+  bool Started = false;
+  double Time = 0.0;
+  std::chrono::steady_clock::time_point Start;
+};
+
+#endif
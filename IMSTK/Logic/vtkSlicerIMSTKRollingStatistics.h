@@ -0,0 +1,129 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKRollingStatistics_h
+#define __vtkSlicerIMSTKRollingStatistics_h
+
+// STD includes
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/// \brief Statistics over the most recent samples of a measurement.
+///
+/// Samples are added by a single thread without locking nor allocation.
+/// The summary, including a histogram with power-of-two bins, can be
+/// computed from any thread and reflects the last WindowSize samples.
+class vtkSlicerIMSTKRollingStatistics
+{
+public:
+  enum
+  {
+    /// Number of most recent samples taken into account (power of two)
+    WindowSize = 1024,
+    /// Bin 0 counts values below 1, bin i counts values in [2^(i-1), 2^i),
+    /// the last bin also counts everything above.
+    NumberOfBins = 24
+  };
+
+  struct Summary
+  {
+    /// Number of samples added since the last reset
+    std::uint64_t Count = 0;
+    double Mean = 0.0;
+    double Minimum = 0.0;
+    double Maximum = 0.0;
+    double Median = 0.0;
+    double Percentile95 = 0.0;
+    double Percentile99 = 0.0;
+    /// Histogram of the samples in the window
+    std::array<std::uint64_t, NumberOfBins> Histogram{};
+  };
+
+  vtkSlicerIMSTKRollingStatistics()
+    : Count(0)
+  {
+    for (auto& sample : this->Samples)
+    {
+      sample.store(0.0, std::memory_order_relaxed);
+    }
+  }
+
+  /// Add a sample. Only call from the thread owning the measurement.
+  void Add(double value)
+  {
+    const std::uint64_t index = this->Count.load(std::memory_order_relaxed);
+    this->Samples[index & (WindowSize - 1)].store(value, std::memory_order_relaxed);
+    this->Count.store(index + 1, std::memory_order_release);
+  }
+
+  /// Summarize the samples of the window. Safe to call from any thread,
+  /// samples added concurrently may or may not be taken into account.
+  Summary GetSummary() const
+  {
+    Summary summary;
+    summary.Count = this->Count.load(std::memory_order_acquire);
+    const std::size_t windowCount = static_cast<std::size_t>(std::min<std::uint64_t>(summary.Count, WindowSize));
+    if (windowCount == 0)
+    {
+      return summary;
+    }
+
+    std::vector<double> values(windowCount);
+    double sum = 0.0;
+    for (std::size_t i = 0; i < windowCount; i++)
+    {
+      values[i] = this->Samples[i].load(std::memory_order_relaxed);
+      sum += values[i];
+      summary.Histogram[GetBin(values[i])]++;
+    }
+    std::sort(values.begin(), values.end());
+    summary.Mean = sum / windowCount;
+    summary.Minimum = values.front();
+    summary.Maximum = values.back();
+    summary.Median = values[windowCount / 2];
+    summary.Percentile95 = values[std::min(windowCount - 1, windowCount * 95 / 100)];
+    summary.Percentile99 = values[std::min(windowCount - 1, windowCount * 99 / 100)];
+    return summary;
+  }
+
+  /// Forget all samples. Must not be called while samples are being added.
+  void Reset() { this->Count.store(0, std::memory_order_release); }
+
+  static int GetBin(double value)
+  {
+    int bin = 0;
+    double upperBound = 1.0;
+    while (value >= upperBound && bin < NumberOfBins - 1)
+    {
+      upperBound *= 2.0;
+      bin++;
+    }
+    return bin;
+  }
+
+private:
+  std::array<std::atomic<double>, WindowSize> Samples;
+  std::atomic<std::uint64_t> Count;
+
+  vtkSlicerIMSTKRollingStatistics(const vtkSlicerIMSTKRollingStatistics&) = delete;
+  void operator=(const vtkSlicerIMSTKRollingStatistics&) = delete;
+};
+
+#endif
@@ -0,0 +1,585 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKSceneBuilder.h"
+#include "vtkSlicerIMSTKCollisionData.h"
+#include "vtkSlicerIMSTKGeometryCache.h"
+#include "vtkSlicerIMSTKGeometryConversion.h"
+#include "vtkSlicerIMSTKLevelOfDetail.h"
+
+// MRML includes
+#include <vtkMRMLDisplayNode.h>
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLTransformNode.h>
+
+// iMSTK includes
+#include "imstkCamera.h"
+#include "imstkCollidingObject.h"
+#include "imstkCollisionData.h"
+#include "imstkCollisionDetectionAlgorithm.h"
+#include "imstkCollisionGraph.h"
+#include "imstkColor.h"
+#include "imstkDirectionalLight.h"
+#include "imstkIsometricMap.h"
+#include "imstkOrientedBox.h"
+#include "imstkRenderMaterial.h"
+#include "imstkRigidBodyModel2.h"
+#include "imstkRigidObject2.h"
+#include "imstkRigidObjectCollision.h"
+#include "imstkScene.h"
+#include "imstkSignedDistanceField.h"
+#include "imstkSphere.h"
+#include "imstkSurfaceMesh.h"
+#include "imstkVecDataArray.h"
+#include "imstkVisualModel.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkCellArray.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+const char* vtkSlicerIMSTKSceneBuilder::ObjectTypeAttributeName = "IMSTK.ObjectType";
+const char* vtkSlicerIMSTKSceneBuilder::CollisionGeometryAttributeName = "IMSTK.CollisionGeometry";
+const char* vtkSlicerIMSTKSceneBuilder::MassAttributeName = "IMSTK.Mass";
+const char* vtkSlicerIMSTKSceneBuilder::PoseTransformReferenceRole = "IMSTK.Pose";
+const char* vtkSlicerIMSTKSceneBuilder::AuthoredParentReferenceRole = "IMSTK.AuthoredParent";
+
+namespace
+{
+//----------------------------------------------------------------------------
+imstk::Mat4d ToMat4d(const std::array<double, 16>& rowMajor)
+{
+  imstk::Mat4d matrix;
+  for (int i = 0; i < 4; i++)
+  {
+    for (int j = 0; j < 4; j++)
+    {
+      matrix(i, j) = rowMajor[i * 4 + j];
+    }
+  }
+  return matrix;
+}
+
+//----------------------------------------------------------------------------
+/// Center of mass and inertia tensor about it of the volume enclosed by
+/// \a mesh, of uniform density and total \a mass. The moments are summed
+/// over the tetrahedra joining the origin to each triangle. Open or flat
+/// meshes get the tensor of their bounding box about its center instead.
+imstk::Mat3d ComputeMassProperties(imstk::SurfaceMesh& mesh, double mass, imstk::Vec3d& centerOfMass)
+{
+  const imstk::VecDataArray<double, 3>& vertices = *mesh.getVertexPositions();
+  const imstk::VecDataArray<int, 3>& triangles = *mesh.getTriangleIndices();
+  // Covariance of the canonical tetrahedron, scaled by its determinant
+  imstk::Mat3d canonical;
+  canonical << 2.0, 1.0, 1.0, 1.0, 2.0, 1.0, 1.0, 1.0, 2.0;
+  canonical /= 120.0;
+  double volume = 0.0;
+  imstk::Vec3d moment = imstk::Vec3d::Zero();
+  imstk::Mat3d covariance = imstk::Mat3d::Zero();
+  for (int t = 0; t < triangles.size(); t++)
+  {
+    imstk::Mat3d tetrahedron;
+    tetrahedron.col(0) = vertices[triangles[t][0]];
+    tetrahedron.col(1) = vertices[triangles[t][1]];
+    tetrahedron.col(2) = vertices[triangles[t][2]];
+    const double determinant = tetrahedron.determinant();
+    volume += determinant / 6.0;
+    moment += determinant / 24.0 * tetrahedron.rowwise().sum();
+    covariance += determinant * tetrahedron * canonical * tetrahedron.transpose();
+  }
+
+  imstk::Vec3d min, max;
+  mesh.computeBoundingBox(min, max);
+  const imstk::Vec3d size = max - min;
+  if (std::abs(volume) <= 1e-9 * size.prod())
+  {
+    centerOfMass = (min + max) / 2.0;
+    const imstk::Vec3d squares = size.cwiseProduct(size);
+    return (mass / 12.0 * imstk::Vec3d(squares[1] + squares[2], squares[0] + squares[2], squares[0] + squares[1]))
+      .asDiagonal();
+  }
+  // Inverted meshes have a negative volume, moment and covariance
+  centerOfMass = moment / volume;
+  covariance *= mass / volume;
+  // Parallel axis theorem, from the origin to the center of mass
+  covariance -= mass * centerOfMass * centerOfMass.transpose();
+  return covariance.trace() * imstk::Mat3d::Identity() - covariance;
+}
+
+//----------------------------------------------------------------------------
+/// Collision detection between the geometries of a rigid object and another
+/// object, or an empty string if the pair is not supported.
+std::string GetCollisionDetectionType(int rigidGeometry, int otherGeometry)
+{
+  if (rigidGeometry == vtkSlicerIMSTKSceneBuilder::MeshCollision)
+  {
+    switch (otherGeometry)
+    {
+      case vtkSlicerIMSTKSceneBuilder::MeshCollision: return "MeshToMeshBruteForceCD";
+      case vtkSlicerIMSTKSceneBuilder::SphereCollision: return "PointSetToSphereCD";
+      case vtkSlicerIMSTKSceneBuilder::OrientedBoxCollision: return "PointSetToOrientedBoxCD";
+      case vtkSlicerIMSTKSceneBuilder::SignedDistanceFieldCollision: return "ImplicitGeometryToPointSetCD";
+      default: break;
+    }
+  }
+  else if (rigidGeometry == vtkSlicerIMSTKSceneBuilder::SphereCollision
+    && otherGeometry == vtkSlicerIMSTKSceneBuilder::SphereCollision)
+  {
+    return "SphereToSphereCD";
+  }
+  return std::string();
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKSceneBuilder::GetObjectType(vtkMRMLModelNode* modelNode)
+{
+  const char* type = modelNode ? modelNode->GetAttribute(ObjectTypeAttributeName) : nullptr;
+  if (!type)
+  {
+    return -1;
+  }
+  if (!strcmp(type, "Visual"))
+  {
+    return VisualObject;
+  }
+  if (!strcmp(type, "Colliding"))
+  {
+    return CollidingObject;
+  }
+  if (!strcmp(type, "Rigid"))
+  {
+    return RigidObject;
+  }
+  vtkGenericWarningMacro("vtkSlicerIMSTKSceneBuilder: unknown object type " << type
+    << " for model " << modelNode->GetName());
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKSceneBuilder::SceneDescription vtkSlicerIMSTKSceneBuilder::Describe(vtkMRMLScene* scene, const std::string& name)
+{
+  SceneDescription description;
+  description.Name = name;
+  if (!scene)
+  {
+    return description;
+  }
+
+  std::vector<vtkMRMLNode*> nodes;
+  scene->GetNodesByClass("vtkMRMLModelNode", nodes);
+  for (vtkMRMLNode* node : nodes)
+  {
+    vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(node);
+    const int type = GetObjectType(modelNode);
+    if (type < 0 || !modelNode->GetPolyData())
+    {
+      continue;
+    }
+
+    ObjectDescription object;
+    object.Type = type;
+    if (DescribeObject(modelNode, object))
+    {
+      description.Objects.push_back(object);
+    }
+  }
+  return description;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKSceneBuilder::DescribeObject(vtkMRMLModelNode* modelNode, ObjectDescription& object)
+{
+  if (!modelNode || !modelNode->GetPolyData() || !modelNode->GetPolyData()->GetPoints())
+  {
+    return false;
+  }
+  object.NodeID = modelNode->GetID();
+  object.Name = modelNode->GetName() ? modelNode->GetName() : object.NodeID;
+
+  const char* collision = modelNode->GetAttribute(CollisionGeometryAttributeName);
+  if (collision && !strcmp(collision, "Sphere"))
+  {
+    object.CollisionGeometry = SphereCollision;
+  }
+  else if (collision && !strcmp(collision, "OrientedBox"))
+  {
+    object.CollisionGeometry = OrientedBoxCollision;
+  }
+
+  const char* mass = modelNode->GetAttribute(MassAttributeName);
+  if (mass && std::atof(mass) > 0.0)
+  {
+    object.Mass = std::atof(mass);
+  }
+
+  if (vtkMRMLDisplayNode* displayNode = modelNode->GetDisplayNode())
+  {
+    displayNode->GetColor(object.Color.data());
+  }
+
+  // Simulated rigid models are under their pose, start from the authored one
+  vtkMRMLTransformNode* transformNode = GetAuthoredParent(modelNode);
+  if (transformNode)
+  {
+    if (!transformNode->IsTransformToWorldLinear())
+    {
+      vtkGenericWarningMacro("vtkSlicerIMSTKSceneBuilder: model " << object.Name
+        << " is under a non-linear transform, it is ignored");
+      return false;
+    }
+    vtkNew<vtkMatrix4x4> toWorld;
+    transformNode->GetMatrixTransformToWorld(toWorld);
+    std::copy(&toWorld->Element[0][0], &toWorld->Element[0][0] + 16, object.ToWorld.begin());
+  }
+
+  // The arrays are shared, nothing is copied
+  object.PolyData = vtkSmartPointer<vtkPolyData>::New();
+  object.PolyData->ShallowCopy(modelNode->GetPolyData());
+  object.PointsMTime = object.PolyData->GetPoints()->GetMTime();
+  object.PolysMTime = object.PolyData->GetPolys() ? object.PolyData->GetPolys()->GetMTime() : 0;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLTransformNode* vtkSlicerIMSTKSceneBuilder::GetAuthoredParent(vtkMRMLModelNode* modelNode)
+{
+  vtkMRMLTransformNode* parent = modelNode->GetParentTransformNode();
+  if (parent && parent == modelNode->GetNodeReference(PoseTransformReferenceRole))
+  {
+    return vtkMRMLTransformNode::SafeDownCast(modelNode->GetNodeReference(AuthoredParentReferenceRole));
+  }
+  return parent;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKSceneBuilder::RestoreAuthoredParent(vtkMRMLModelNode* modelNode)
+{
+  vtkMRMLTransformNode* parent = modelNode->GetParentTransformNode();
+  if (!parent || parent != modelNode->GetNodeReference(PoseTransformReferenceRole))
+  {
+    return;
+  }
+  vtkMRMLTransformNode* authoredParent = GetAuthoredParent(modelNode);
+  modelNode->SetAndObserveTransformNodeID(authoredParent ? authoredParent->GetID() : nullptr);
+  modelNode->RemoveNodeReferenceIDs(AuthoredParentReferenceRole);
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKSceneBuilder::BuiltScene vtkSlicerIMSTKSceneBuilder::Build(const SceneDescription& description, vtkSlicerIMSTKGeometryCache* cache)
+{
+  BuiltScene built;
+  built.Scene = std::make_shared<imstk::Scene>(description.Name);
+
+  // All rigid objects are solved by the same model
+  std::shared_ptr<imstk::RigidBodyModel2> rigidBodyModel;
+
+  imstk::Vec3d sceneMin = imstk::Vec3d::Constant(std::numeric_limits<double>::max());
+  imstk::Vec3d sceneMax = imstk::Vec3d::Constant(std::numeric_limits<double>::lowest());
+
+  // Collision geometries actually used, static meshes may be replaced by
+  // their distance field
+  std::vector<int> collisionGeometries;
+
+  for (const ObjectDescription& objectDescription : description.Objects)
+  {
+    collisionGeometries.push_back(objectDescription.CollisionGeometry);
+    // Objects own their geometry: the cached meshes must not be transformed
+    std::shared_ptr<imstk::SurfaceMesh> mesh = cache
+      ? cache->GetSurfaceMeshCopy(objectDescription.NodeID, objectDescription.PolyData)
+      : vtkSlicerIMSTKGeometryConversion::ToSurfaceMesh(objectDescription.PolyData);
+    built.CentersOfMass.push_back(std::array<double, 3>{ { 0.0, 0.0, 0.0 } });
+    if (!mesh)
+    {
+      built.Objects.push_back(nullptr);
+      continue;
+    }
+
+    const imstk::Mat4d toWorld = ToMat4d(objectDescription.ToWorld);
+    imstk::Vec3d centerOfMass = imstk::Vec3d::Zero();
+    imstk::Mat3d inertiaTensor = imstk::Mat3d::Identity();
+    if (objectDescription.Type != RigidObject)
+    {
+      // Static objects live in world coordinates
+      mesh->transform(toWorld, imstk::Geometry::TransformType::ApplyToData);
+    }
+    else
+    {
+      // Rigid bodies rotate about the origin of their geometries, which is
+      // moved to the center of mass of the displayed mesh
+      inertiaTensor = ComputeMassProperties(*mesh, objectDescription.Mass, centerOfMass);
+      mesh->translate(-centerOfMass, imstk::Geometry::TransformType::ApplyToData);
+      built.CentersOfMass.back() = { { centerOfMass[0], centerOfMass[1], centerOfMass[2] } };
+    }
+
+    imstk::Vec3d min, max;
+    mesh->computeBoundingBox(min, max);
+    const imstk::Vec3d center = (min + max) / 2.0;
+    std::shared_ptr<imstk::Geometry> collidingGeometry = mesh;
+    if (objectDescription.CollisionGeometry == SphereCollision)
+    {
+      collidingGeometry = std::make_shared<imstk::Sphere>(center, (max - min).norm() / 2.0);
+    }
+    else if (objectDescription.CollisionGeometry == OrientedBoxCollision)
+    {
+      collidingGeometry = std::make_shared<imstk::OrientedBox>(center, (max - min) / 2.0);
+    }
+    else if (objectDescription.Type == CollidingObject && cache)
+    {
+      // The field is computed in model coordinates and shared by all the
+      // scenes, only the geometry wrapping it is transformed.
+      std::shared_ptr<imstk::ImageData> distances = vtkSlicerIMSTKCollisionData::Find(
+        cache, objectDescription.NodeID, description.CollisionDataDirectory);
+      if (distances)
+      {
+        auto distanceField = std::make_shared<imstk::SignedDistanceField>(distances);
+        distanceField->transform(toWorld);
+        collidingGeometry = distanceField;
+        collisionGeometries.back() = SignedDistanceFieldCollision;
+      }
+    }
+    if (collidingGeometry == mesh && objectDescription.Type != VisualObject
+      && cache && description.LevelOfDetailTriangles > 0)
+    {
+      std::shared_ptr<const vtkSlicerIMSTKLevelOfDetail::Level> level = vtkSlicerIMSTKLevelOfDetail::Get(
+        cache, objectDescription.NodeID, objectDescription.PolyData, description.LevelOfDetailTriangles);
+      if (level)
+      {
+        std::shared_ptr<imstk::SurfaceMesh> decimated = vtkSlicerIMSTKGeometryConversion::Copy(level->Mesh);
+        if (objectDescription.Type != RigidObject)
+        {
+          decimated->transform(toWorld, imstk::Geometry::TransformType::ApplyToData);
+        }
+        else
+        {
+          decimated->translate(-centerOfMass, imstk::Geometry::TransformType::ApplyToData);
+        }
+        collidingGeometry = decimated;
+      }
+    }
+
+    std::shared_ptr<imstk::SceneObject> object;
+    if (objectDescription.Type == VisualObject)
+    {
+      object = std::make_shared<imstk::SceneObject>(objectDescription.Name);
+      object->setVisualGeometry(mesh);
+    }
+    else if (objectDescription.Type == CollidingObject)
+    {
+      auto collidingObject = std::make_shared<imstk::CollidingObject>(objectDescription.Name);
+      collidingObject->setVisualGeometry(mesh);
+      collidingObject->setCollidingGeometry(collidingGeometry);
+      object = collidingObject;
+    }
+    else
+    {
+      if (!rigidBodyModel)
+      {
+        rigidBodyModel = std::make_shared<imstk::RigidBodyModel2>();
+        // Slicer uses millimeters and RAS coordinates
+        rigidBodyModel->getConfig()->m_gravity = imstk::Vec3d(0.0, 0.0, -9810.0);
+      }
+      auto rigidObject = std::make_shared<imstk::RigidObject2>(objectDescription.Name);
+      rigidObject->setDynamicalModel(rigidBodyModel);
+      rigidObject->setVisualGeometry(mesh);
+      rigidObject->setCollidingGeometry(collidingGeometry);
+      rigidObject->setPhysicsGeometry(collidingGeometry);
+      if (collidingGeometry != mesh)
+      {
+        rigidObject->setPhysicsToVisualMap(std::make_shared<imstk::IsometricMap>(collidingGeometry, mesh));
+      }
+      const imstk::Mat3d rotation = toWorld.block<3, 3>(0, 0);
+      rigidObject->getRigidBody()->m_mass = objectDescription.Mass;
+      rigidObject->getRigidBody()->m_initPos = (toWorld * centerOfMass.homogeneous()).head<3>();
+      rigidObject->getRigidBody()->m_initOrientation = imstk::Quatd(rotation).normalized();
+      rigidObject->getRigidBody()->m_intertiaTensor = inertiaTensor;
+      object = rigidObject;
+    }
+    object->getVisualModel(0)->getRenderMaterial()->setColor(
+      imstk::Color(objectDescription.Color[0], objectDescription.Color[1], objectDescription.Color[2]));
+    built.Scene->addSceneObject(object);
+    built.Objects.push_back(object);
+
+    const imstk::Vec3d worldCenter = objectDescription.Type == RigidObject
+      ? imstk::Vec3d((toWorld * (center + centerOfMass).homogeneous()).head<3>()) : center;
+    const imstk::Vec3d halfSize = (max - min) / 2.0;
+    sceneMin = sceneMin.cwiseMin(worldCenter - halfSize);
+    sceneMax = sceneMax.cwiseMax(worldCenter + halfSize);
+  }
+
+  // Rigid objects collide with every other colliding object
+  for (std::size_t i = 0; i < description.Objects.size(); i++)
+  {
+    auto rigidObject = std::dynamic_pointer_cast<imstk::RigidObject2>(built.Objects[i]);
+    if (!rigidObject)
+    {
+      continue;
+    }
+    for (std::size_t j = 0; j < description.Objects.size(); j++)
+    {
+      auto otherObject = std::dynamic_pointer_cast<imstk::CollidingObject>(built.Objects[j]);
+      // Pairs of rigid objects are only added once
+      const bool otherIsRigid = std::dynamic_pointer_cast<imstk::RigidObject2>(otherObject) != nullptr;
+      if (!otherObject || i == j || (otherIsRigid && j < i))
+      {
+        continue;
+      }
+      const std::string cdType = GetCollisionDetectionType(collisionGeometries[i], collisionGeometries[j]);
+      if (cdType.empty())
+      {
+        vtkGenericWarningMacro("vtkSlicerIMSTKSceneBuilder: unsupported collision between "
+          << description.Objects[i].Name << " and " << description.Objects[j].Name);
+        continue;
+      }
+      auto interaction = std::make_shared<imstk::RigidObjectCollision>(rigidObject, otherObject, cdType);
+      built.Scene->getCollisionGraph()->addInteraction(interaction);
+      built.CollisionData.push_back(interaction->getCollisionDetection()->getCollisionData());
+    }
+  }
+
+  // Light and camera are only used by the iMSTK viewer
+  auto light = std::make_shared<imstk::DirectionalLight>();
+  light->setDirection(imstk::Vec3d(0.0, 1.0, -1.0));
+  light->setIntensity(1.0);
+  built.Scene->addLight("light", light);
+  if (!description.Objects.empty())
+  {
+    const imstk::Vec3d sceneCenter = (sceneMin + sceneMax) / 2.0;
+    built.Scene->getActiveCamera()->setFocalPoint(sceneCenter);
+    built.Scene->getActiveCamera()->setPosition(sceneCenter + imstk::Vec3d(0.0, -2.0, 0.0) * (sceneMax - sceneMin).norm());
+    built.Scene->getActiveCamera()->setViewUp(0.0, 0.0, 1.0);
+  }
+  return built;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKSceneBuilder::PrepareUpdate(const ObjectDescription& previous, const ObjectDescription& current,
+  std::shared_ptr<imstk::SceneObject> object, std::function<void()>& update)
+{
+  update = nullptr;
+  auto mesh = object ? std::dynamic_pointer_cast<imstk::SurfaceMesh>(object->getVisualGeometry()) : nullptr;
+  if (!mesh || !previous.PolyData || !current.PolyData
+    || current.Type != previous.Type
+    || current.CollisionGeometry != previous.CollisionGeometry
+    || current.Mass != previous.Mass
+    || current.PolyData->GetNumberOfPoints() != mesh->getNumVertices()
+    || current.PolyData->GetPolys() != previous.PolyData->GetPolys()
+    || current.PolysMTime != previous.PolysMTime)
+  {
+    return false;
+  }
+  auto collidingObject = std::dynamic_pointer_cast<imstk::CollidingObject>(object);
+  std::shared_ptr<imstk::Geometry> collidingGeometry = collidingObject ? collidingObject->getCollidingGeometry() : nullptr;
+  const bool rigid = current.Type == RigidObject;
+
+  const bool colorChanged = current.Color != previous.Color;
+  const bool poseChanged = !rigid && current.ToWorld != previous.ToWorld;
+  const bool pointsChanged = current.PointsMTime != previous.PointsMTime
+    || current.PolyData->GetPoints() != previous.PolyData->GetPoints();
+  if (!colorChanged && !poseChanged && !pointsChanged)
+  {
+    return true;
+  }
+  // Spheres, boxes, distance fields and decimated meshes would have to be
+  // fitted or computed again, and rigid bodies get a new center of mass and
+  // inertia
+  if (pointsChanged && ((collidingGeometry && collidingGeometry != mesh) || rigid))
+  {
+    return false;
+  }
+
+  // Points are read here, the model may be edited again before the update
+  std::shared_ptr<imstk::VecDataArray<double, 3>> positions;
+  if (pointsChanged)
+  {
+    vtkPoints* points = current.PolyData->GetPoints();
+    const vtkIdType numberOfPoints = points->GetNumberOfPoints();
+    positions = std::make_shared<imstk::VecDataArray<double, 3>>(static_cast<int>(numberOfPoints));
+    // Static objects live in world coordinates
+    const imstk::Mat4d toWorld = rigid ? imstk::Mat4d::Identity() : ToMat4d(current.ToWorld);
+    imstk::Vec3d* output = positions->getPointer();
+    for (vtkIdType i = 0; i < numberOfPoints; i++)
+    {
+      double point[3];
+      points->GetPoint(i, point);
+      output[i] = (toWorld * imstk::Vec4d(point[0], point[1], point[2], 1.0)).head<3>();
+    }
+  }
+
+  // Row-major, Eigen matrices are not captured to avoid alignment issues
+  std::array<double, 16> delta;
+  const imstk::Mat4d deltaMatrix = ToMat4d(current.ToWorld) * ToMat4d(previous.ToWorld).inverse();
+  for (int row = 0; row < 4; row++)
+  {
+    for (int column = 0; column < 4; column++)
+    {
+      delta[row * 4 + column] = deltaMatrix(row, column);
+    }
+  }
+  const std::array<double, 3> color = current.Color;
+
+  update = [object, mesh, collidingGeometry, colorChanged, color, poseChanged, delta, positions]()
+  {
+    if (colorChanged)
+    {
+      object->getVisualModel(0)->getRenderMaterial()->setColor(imstk::Color(color[0], color[1], color[2]));
+    }
+    if (positions)
+    {
+      // The new points already have the new pose
+      const double* source = positions->getPointer()->data();
+      const std::size_t numberOfValues = 3 * static_cast<std::size_t>(positions->size());
+      std::shared_ptr<imstk::VecDataArray<double, 3>> initialVertices = mesh->getInitialVertexPositions();
+      std::shared_ptr<imstk::VecDataArray<double, 3>> vertices = mesh->getVertexPositions();
+      std::copy(source, source + numberOfValues, initialVertices->getPointer()->data());
+      if (vertices != initialVertices)
+      {
+        std::copy(source, source + numberOfValues, vertices->getPointer()->data());
+      }
+      mesh->postModified();
+    }
+    else if (poseChanged)
+    {
+      const imstk::Mat4d transform = ToMat4d(delta);
+      mesh->transform(transform, imstk::Geometry::TransformType::ApplyToData);
+      if (collidingGeometry && collidingGeometry != mesh)
+      {
+        // Meshes are in world coordinates, other geometries are transformed
+        // like when they were built
+        if (std::dynamic_pointer_cast<imstk::SurfaceMesh>(collidingGeometry))
+        {
+          collidingGeometry->transform(transform, imstk::Geometry::TransformType::ApplyToData);
+        }
+        else
+        {
+          collidingGeometry->transform(transform);
+        }
+      }
+    }
+  };
+  return true;
+}
@@ -0,0 +1,193 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKSceneBuilder_h
+#define __vtkSlicerIMSTKSceneBuilder_h
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+// STD includes
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+class vtkMRMLModelNode;
+class vtkMRMLScene;
+class vtkMRMLTransformNode;
+class vtkPolyData;
+class vtkSlicerIMSTKGeometryCache;
+
+namespace imstk
+{
+  class CollisionData;
+  class Scene;
+  class SceneObject;
+}
+
+/// \brief Assemble an iMSTK scene from the MRML model nodes tagged with
+/// iMSTK attributes.
+///
+/// Building is split in two steps:
+/// - Describe() reads MRML and must be called from the main thread. It only
+///   takes shallow copies of the model geometries.
+/// - Build() creates the iMSTK scene from the description and does not touch
+///   MRML, so it can run in a worker thread.
+///
+/// Attributes of the model nodes:
+/// - IMSTK.ObjectType: "Visual", "Colliding" (static obstacle) or "Rigid".
+///   Models without this attribute are ignored.
+/// - IMSTK.CollisionGeometry: "Mesh" (default), "Sphere" or "OrientedBox".
+///   Spheres and boxes are fitted to the bounds of the model.
+/// - IMSTK.Mass: mass of rigid objects, default is 1.
+///
+/// The color of the model display node is used as render material.
+///
+/// Rigid objects keep their model coordinates: their initial pose is the
+/// transform of the model to world. Once simulated, the model is under its
+/// pose node and the transform it was authored under is referenced with
+/// AuthoredParentReferenceRole: rebuilds start from the authored pose.
+/// Their center of mass and inertia tensor are the ones of the displayed,
+/// full resolution, closed mesh with uniform density. The geometries of the
+/// bodies are centered on their center of mass, which is the point they
+/// rotate about, see BuiltScene::CentersOfMass.
+///
+/// Static colliding meshes use their signed distance field instead of the
+/// mesh if it was precomputed, which is much faster to collide with.
+///
+/// Colliding and rigid meshes larger than the level of detail of the
+/// description collide with their decimated mesh (see
+/// vtkSlicerIMSTKLevelOfDetail), the full resolution mesh is only displayed.
+///
+/// Running scenes can follow the changes of the model nodes without being
+/// rebuilt: PrepareUpdate() compares two descriptions of an object on the
+/// main thread, and returns the change to apply to the iMSTK object between
+/// two steps.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKSceneBuilder
+{
+public:
+  static const char* ObjectTypeAttributeName;
+  static const char* CollisionGeometryAttributeName;
+  static const char* MassAttributeName;
+  /// Role of the reference from a rigid model to the transform node
+  /// receiving its simulated pose
+  static const char* PoseTransformReferenceRole;
+  /// Role of the reference from a rigid model to the transform it was under
+  /// before being moved under its pose node, see RestoreAuthoredParent()
+  static const char* AuthoredParentReferenceRole;
+
+  enum ObjectType
+  {
+    VisualObject = 0,
+    CollidingObject,
+    RigidObject
+  };
+
+  enum CollisionGeometryType
+  {
+    MeshCollision = 0,
+    SphereCollision,
+    OrientedBoxCollision,
+    /// Static meshes whose signed distance field was precomputed, see
+    /// vtkSlicerIMSTKCollisionData. Not settable as attribute.
+    SignedDistanceFieldCollision
+  };
+
+  struct ObjectDescription
+  {
+    std::string NodeID;
+    std::string Name;
+    int Type = VisualObject;
+    int CollisionGeometry = MeshCollision;
+    double Mass = 1.0;
+    std::array<double, 3> Color{ { 1.0, 1.0, 1.0 } };
+    /// Transform from the model coordinates to world, row-major
+    std::array<double, 16> ToWorld{ { 1., 0., 0., 0., 0., 1., 0., 0., 0., 0., 1., 0., 0., 0., 0., 1. } };
+    /// Shallow copy of the model polydata
+    vtkSmartPointer<vtkPolyData> PolyData;
+    /// Modification times of the points and polygons when described, to
+    /// detect edits of the shared arrays
+    vtkMTimeType PointsMTime = 0;
+    vtkMTimeType PolysMTime = 0;
+  };
+
+  struct SceneDescription
+  {
+    std::string Name;
+    std::vector<ObjectDescription> Objects;
+    /// Where precomputed collision data is looked for, may be empty
+    std::string CollisionDataDirectory;
+    /// Maximum number of triangles of the collision meshes, 0 to collide
+    /// with the full resolution meshes
+    int LevelOfDetailTriangles = 0;
+  };
+
+  struct BuiltScene
+  {
+    std::shared_ptr<imstk::Scene> Scene;
+    /// Objects in the same order as in the description
+    std::vector<std::shared_ptr<imstk::SceneObject>> Objects;
+    /// Collision data of the interactions between the objects
+    std::vector<std::shared_ptr<imstk::CollisionData>> CollisionData;
+    /// Center of mass of each rigid object in the coordinates of its model,
+    /// which is the origin of its geometries: the transform of the model to
+    /// world is the one of the geometries followed by a translation by
+    /// minus the center. Zero for other objects.
+    std::vector<std::array<double, 3>> CentersOfMass;
+  };
+
+  /// Describe the tagged model nodes of \a scene. Main thread only.
+  static SceneDescription Describe(vtkMRMLScene* scene, const std::string& name);
+
+  /// Describe \a modelNode, except for its type which is left unchanged.
+  /// Returns false if the model cannot be simulated. Main thread only.
+  static bool DescribeObject(vtkMRMLModelNode* modelNode, ObjectDescription& object);
+
+  /// Transform \a modelNode was authored under: its parent transform, or
+  /// the one referenced with AuthoredParentReferenceRole if it is under its
+  /// pose node. Null if the model is in world coordinates.
+  static vtkMRMLTransformNode* GetAuthoredParent(vtkMRMLModelNode* modelNode);
+
+  /// Move \a modelNode back from its pose node to the transform it was
+  /// authored under. Main thread only.
+  static void RestoreAuthoredParent(vtkMRMLModelNode* modelNode);
+
+  /// Return the object type of \a modelNode, or -1 if it is not tagged.
+  static int GetObjectType(vtkMRMLModelNode* modelNode);
+
+  /// Create the scene objects and their interactions. Geometries are
+  /// taken from \a cache if not null.
+  static BuiltScene Build(const SceneDescription& description, vtkSlicerIMSTKGeometryCache* cache);
+
+  /// Prepare the update of \a object, built from \a previous, to \a current.
+  /// Returns false if the changes need the scene to be rebuilt: type,
+  /// collision geometry, mass or connectivity changes, and point edits of
+  /// rigid objects or of objects colliding with another geometry than their
+  /// mesh. Otherwise \a update is set to the function applying the changes
+  /// (null if there are none), which only touches iMSTK and must be called
+  /// between two steps of the scene. The pose of rigid objects is ignored,
+  /// it is the output of the simulation. Main thread only.
+  static bool PrepareUpdate(const ObjectDescription& previous, const ObjectDescription& current,
+    std::shared_ptr<imstk::SceneObject> object, std::function<void()>& update);
+};
+
+#endif
@@ -0,0 +1,475 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKScheduler.h"
+
+// TBB includes
+#define TBB_PREVIEW_LOCAL_OBSERVER 1 // For arena observers before oneTBB
+#include <tbb/task_arena.h>
+#include <tbb/task_scheduler_observer.h>
+#if defined(__has_include)
+# if __has_include(<tbb/version.h>)
+#  include <tbb/version.h> // For TBB_VERSION_MAJOR with oneTBB
+# endif
+#endif
+
+// STD includes
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#elif defined(__linux__)
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+namespace
+{
+#if defined(_WIN32)
+typedef DWORD_PTR AffinityMask;
+#elif defined(__linux__)
+typedef cpu_set_t AffinityMask;
+#else
+typedef int AffinityMask;
+#endif
+
+/// Affinity of the current thread before it was pinned to the cores of a
+/// lane, and the lane it is pinned to if any
+struct ThreadAffinity
+{
+  const void* PinnedBy = nullptr;
+  AffinityMask Original;
+};
+thread_local ThreadAffinity CurrentThreadAffinity;
+
+//----------------------------------------------------------------------------
+/// Restrict the current thread to \a cores of \a lane. Nothing is done if it
+/// is already pinned to the lane. The affinity the thread had before, which
+/// may have been set outside of the application, is saved for
+/// RestoreCurrentThread().
+void PinCurrentThread(const void* lane, const std::vector<int>& cores)
+{
+  ThreadAffinity& affinity = CurrentThreadAffinity;
+  if (affinity.PinnedBy == lane || cores.empty())
+  {
+    return;
+  }
+#if defined(_WIN32)
+  DWORD_PTR mask = 0;
+  for (int core : cores)
+  {
+    if (core >= 0 && core < static_cast<int>(8 * sizeof(DWORD_PTR)))
+    {
+      mask |= static_cast<DWORD_PTR>(1) << core;
+    }
+  }
+  const DWORD_PTR previous = mask ? SetThreadAffinityMask(GetCurrentThread(), mask) : 0;
+  if (previous == 0)
+  {
+    return;
+  }
+  if (!affinity.PinnedBy)
+  {
+    affinity.Original = previous;
+  }
+  affinity.PinnedBy = lane;
+#elif defined(__linux__)
+  if (!affinity.PinnedBy && pthread_getaffinity_np(pthread_self(), sizeof(affinity.Original), &affinity.Original) != 0)
+  {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int core : cores)
+  {
+    if (core >= 0 && core < CPU_SETSIZE)
+    {
+      CPU_SET(core, &set);
+    }
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+  {
+    return;
+  }
+  affinity.PinnedBy = lane;
+  affinity.PinnedBy = lane;
+#else
+  (void)lane; // unused
+#endif
+}
+
+//----------------------------------------------------------------------------
+/// Give the current thread back the affinity it had before it was pinned
+void RestoreCurrentThread()
+{
+  ThreadAffinity& affinity = CurrentThreadAffinity;
+  if (!affinity.PinnedBy)
+  {
+    return;
+  }
+#if defined(_WIN32)
+  SetThreadAffinityMask(GetCurrentThread(), affinity.Original);
+#elif defined(__linux__)
+  pthread_setaffinity_np(pthread_self(), sizeof(affinity.Original), &affinity.Original);
+#endif
+  affinity.PinnedBy = nullptr;
+}
+
+//----------------------------------------------------------------------------
+/// Pin the workers entering an arena to the cores of its lane.
+/// Workers leave the arena between the steps of the lane, they keep its
+/// cores so that steps do not cost any system call, and are pinned again
+/// when they enter another lane. Application threads joining the arena get
+/// their affinity back when they leave it.
+class CoreAffinityObserver : public tbb::task_scheduler_observer
+{
+public:
+  CoreAffinityObserver(tbb::task_arena& arena, const std::vector<int>& cores)
+    : tbb::task_scheduler_observer(arena)
+    , Cores(cores)
+  {
+    this->observe(true);
+  }
+  ~CoreAffinityObserver() override
+  {
+    this->observe(false);
+  }
+  void on_scheduler_entry(bool) override
+  {
+    PinCurrentThread(this, this->Cores);
+  }
+  void on_scheduler_exit(bool isWorker) override
+  {
+    if (!isWorker)
+    {
+      RestoreCurrentThread();
+    }
+  }
+
+private:
+  const std::vector<int> Cores;
+};
+}
+
+//----------------------------------------------------------------------------
+class vtkSlicerIMSTKScheduler::vtkInternal
+{
+public:
+  typedef std::chrono::steady_clock ClockType;
+
+  struct Task
+  {
+    int Id = 0;
+    ClockType::duration Period;
+    TaskType Step;
+    TaskType Finish;
+    ClockType::time_point Next;
+    bool Paused = false;
+    /// Set while a step is enqueued or running
+    std::atomic<bool> Running{ false };
+  };
+
+  struct LaneState
+  {
+    std::vector<int> Cores;
+    double Period = 0.01;
+    std::unique_ptr<tbb::task_arena> Arena;
+    std::unique_ptr<CoreAffinityObserver> Observer;
+    std::vector<std::shared_ptr<Task>> Tasks;
+    std::thread Dispatcher;
+  };
+
+  void StartLane(int lane);
+  void Dispatch(int lane);
+  std::shared_ptr<Task> FindTask(int taskId, int* lane = nullptr);
+
+  std::mutex Mutex;
+  std::condition_variable Condition;
+  bool Stopping = false;
+  int NextTaskId = 1;
+  std::array<LaneState, NumberOfLanes> Lanes;
+};
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKScheduler::vtkInternal::StartLane(int lane)
+{
+  LaneState& state = this->Lanes[lane];
+  if (state.Arena)
+  {
+    return;
+  }
+  int concurrency = static_cast<int>(state.Cores.size());
+  if (concurrency == 0)
+  {
+    concurrency = lane == HapticsLane ? 1 : std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  }
+  // No slot is reserved for the dispatcher, it only enqueues
+#if TBB_VERSION_MAJOR >= 2021
+  state.Arena.reset(new tbb::task_arena(concurrency, 0,
+    lane == HapticsLane ? tbb::task_arena::priority::high : tbb::task_arena::priority::normal));
+#else
+  state.Arena.reset(new tbb::task_arena(concurrency, 0));
+#endif
+  state.Arena->initialize();
+  if (!state.Cores.empty())
+  {
+    state.Observer.reset(new CoreAffinityObserver(*state.Arena, state.Cores));
+  }
+  state.Dispatcher = std::thread(&vtkInternal::Dispatch, this, lane);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKScheduler::vtkInternal::Dispatch(int lane)
+{
+  LaneState& state = this->Lanes[lane];
+  PinCurrentThread(&state, state.Cores);
+
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  while (!this->Stopping)
+  {
+    const ClockType::time_point now = ClockType::now();
+    ClockType::time_point wakeUp = now + std::chrono::milliseconds(100);
+    for (const std::shared_ptr<Task>& task : state.Tasks)
+    {
+      if (task->Paused)
+      {
+        continue;
+      }
+      if (task->Next <= now)
+      {
+        // A step still running makes this one skipped
+        if (!task->Running.exchange(true, std::memory_order_acq_rel))
+        {
+          // Tasks are only destroyed once their step completed
+          Task* taskPtr = task.get();
+          auto step = [taskPtr]()
+          {
+            taskPtr->Step();
+            taskPtr->Running.store(false, std::memory_order_release);
+          };
+#if TBB_VERSION_MAJOR >= 2021
+          state.Arena->enqueue(step);
+#else
+          state.Arena->enqueue(step, lane == HapticsLane ? tbb::priority_high : tbb::priority_normal);
+#endif
+        }
+        // Late steps are not caught up
+        task->Next += task->Period;
+        if (task->Next <= now)
+        {
+          task->Next = now + task->Period;
+        }
+      }
+      wakeUp = std::min(wakeUp, task->Next);
+    }
+    this->Condition.wait_until(lock, wakeUp);
+  }
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<vtkSlicerIMSTKScheduler::vtkInternal::Task>
+vtkSlicerIMSTKScheduler::vtkInternal::FindTask(int taskId, int* lane)
+{
+  for (int i = 0; i < NumberOfLanes; i++)
+  {
+    for (const std::shared_ptr<Task>& task : this->Lanes[i].Tasks)
+    {
+      if (task->Id == taskId)
+      {
+        if (lane)
+        {
+          *lane = i;
+        }
+        return task;
+      }
+    }
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKScheduler::vtkSlicerIMSTKScheduler()
+  : Internal(new vtkInternal)
+{
+  const int numberOfCores = static_cast<int>(std::thread::hardware_concurrency());
+  if (numberOfCores >= 4)
+  {
+    // First core for the main thread, last one for the haptics
+    this->Internal->Lanes[HapticsLane].Cores.push_back(numberOfCores - 1);
+    for (int core = 1; core < numberOfCores - 1; core++)
+    {
+      this->Internal->Lanes[PhysicsLane].Cores.push_back(core);
+    }
+  }
+  this->Internal->Lanes[HapticsLane].Period = 0.001;
+  this->Internal->Lanes[PhysicsLane].Period = 0.01;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKScheduler::~vtkSlicerIMSTKScheduler()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+    this->Internal->Stopping = true;
+  }
+  this->Internal->Condition.notify_all();
+  for (vtkInternal::LaneState& state : this->Internal->Lanes)
+  {
+    if (state.Dispatcher.joinable())
+    {
+      state.Dispatcher.join();
+    }
+    // Enqueued steps reference their task
+    for (const auto& task : state.Tasks)
+    {
+      while (task->Running.load(std::memory_order_acquire))
+      {
+        std::this_thread::yield();
+      }
+    }
+    state.Observer.reset();
+    state.Arena.reset();
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKScheduler::AddTask(int lane, double period, TaskType step, TaskType finish)
+{
+  if (lane < 0 || lane >= NumberOfLanes || !step)
+  {
+    return 0;
+  }
+  auto task = std::make_shared<vtkInternal::Task>();
+  task->Step = step;
+  task->Finish = finish;
+  task->Period = std::chrono::duration_cast<vtkInternal::ClockType::duration>(
+    std::chrono::duration<double>(period > 0.0 ? period : this->GetLanePeriod(lane)));
+  task->Next = vtkInternal::ClockType::now();
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+    task->Id = this->Internal->NextTaskId++;
+    this->Internal->StartLane(lane);
+    this->Internal->Lanes[lane].Tasks.push_back(task);
+  }
+  this->Internal->Condition.notify_all();
+  return task->Id;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKScheduler::RemoveTask(int taskId)
+{
+  std::shared_ptr<vtkInternal::Task> task;
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+    int lane = 0;
+    task = this->Internal->FindTask(taskId, &lane);
+    if (!task)
+    {
+      return;
+    }
+    std::vector<std::shared_ptr<vtkInternal::Task>>& tasks = this->Internal->Lanes[lane].Tasks;
+    tasks.erase(std::find(tasks.begin(), tasks.end(), task));
+  }
+  while (task->Running.load(std::memory_order_acquire))
+  {
+    std::this_thread::yield();
+  }
+  if (task->Finish)
+  {
+    task->Finish();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKScheduler::SetTaskPaused(int taskId, bool paused)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+    std::shared_ptr<vtkInternal::Task> task = this->Internal->FindTask(taskId);
+    if (!task || task->Paused == paused)
+    {
+      return;
+    }
+    task->Paused = paused;
+    task->Next = vtkInternal::ClockType::now();
+  }
+  this->Internal->Condition.notify_all();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKScheduler::SetLaneCores(int lane, const std::vector<int>& cores)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  if (lane < 0 || lane >= NumberOfLanes || this->Internal->Lanes[lane].Arena)
+  {
+    return;
+  }
+  this->Internal->Lanes[lane].Cores = cores;
+}
+
+//----------------------------------------------------------------------------
+std::vector<int> vtkSlicerIMSTKScheduler::GetLaneCores(int lane) const
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  if (lane < 0 || lane >= NumberOfLanes)
+  {
+    return std::vector<int>();
+  }
+  return this->Internal->Lanes[lane].Cores;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKScheduler::SetLanePeriod(int lane, double period)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  if (lane >= 0 && lane < NumberOfLanes && period > 0.0)
+  {
+    this->Internal->Lanes[lane].Period = period;
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIMSTKScheduler::GetLanePeriod(int lane) const
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  if (lane < 0 || lane >= NumberOfLanes)
+  {
+    return 0.0;
+  }
+  return this->Internal->Lanes[lane].Period;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKScheduler::GetNumberOfTasks() const
+{
+  std::lock_guard<std::mutex> lock(this->Internal->Mutex);
+  int numberOfTasks = 0;
+  for (const vtkInternal::LaneState& state : this->Internal->Lanes)
+  {
+    numberOfTasks += static_cast<int>(state.Tasks.size());
+  }
+  return numberOfTasks;
+}
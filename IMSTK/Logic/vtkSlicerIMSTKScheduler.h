@@ -0,0 +1,90 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKScheduler_h
+#define __vtkSlicerIMSTKScheduler_h
+
+// STD includes
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+/// \brief Run the periodic tasks of all the simulations on shared TBB workers.
+///
+/// Tasks are assigned to a lane. Each lane has a TBB arena with a fixed
+/// number of workers, pinned to the cores of the lane, and a dispatcher
+/// thread that enqueues the tasks when they are due. The haptics lane has a
+/// higher priority than the physics lane and is meant for device updates.
+/// The number of threads therefore depends on the number of cores instead
+/// of the number of simulations.
+///
+/// A task never runs concurrently with itself: if a step is still running
+/// when the next one is due, the next one is skipped.
+///
+/// By default, the haptics lane gets the last core, the physics lane the
+/// others except the first one, which is left to the main thread. Cores are
+/// only pinned on Linux and Windows.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKScheduler
+{
+public:
+  enum Lane
+  {
+    HapticsLane = 0,
+    PhysicsLane,
+    NumberOfLanes
+  };
+
+  typedef std::function<void()> TaskType;
+
+  vtkSlicerIMSTKScheduler();
+  ~vtkSlicerIMSTKScheduler();
+
+  /// Run \a step every \a period seconds in \a lane, until the task is
+  /// removed. \a finish, if any, is called by RemoveTask() once the last
+  /// step completed. Returns the task identifier.
+  int AddTask(int lane, double period, TaskType step, TaskType finish = nullptr);
+
+  /// Stop running a task and wait for its current step, if any.
+  void RemoveTask(int taskId);
+
+  /// Paused tasks are kept but not run
+  void SetTaskPaused(int taskId, bool paused);
+
+  /// Cores the workers of \a lane are pinned to. An empty list disables
+  /// pinning. The number of workers of the lane is the number of cores.
+  /// Must be called before the first task of the lane is added.
+  void SetLaneCores(int lane, const std::vector<int>& cores);
+  std::vector<int> GetLaneCores(int lane) const;
+
+  /// Default period of the tasks of \a lane, in seconds
+  void SetLanePeriod(int lane, double period);
+  double GetLanePeriod(int lane) const;
+
+  /// Number of tasks, paused or not
+  int GetNumberOfTasks() const;
+
+private:
+  class vtkInternal;
+  std::unique_ptr<vtkInternal> Internal;
+
+  vtkSlicerIMSTKScheduler(const vtkSlicerIMSTKScheduler&) = delete;
+  void operator=(const vtkSlicerIMSTKScheduler&) = delete;
+};
+
+#endif
@@ -0,0 +1,317 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKSessionLog.h"
+#include "vtkSlicerIMSTKPoseRingBuffer.h"
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+
+const char vtkSlicerIMSTKSessionLog::Magic[8] = { 'I', 'M', 'S', 'T', 'K', 'L', 'O', 'G' };
+
+namespace
+{
+//----------------------------------------------------------------------------
+struct FileHeader
+{
+  char Magic[8];
+  std::uint32_t Version;
+  std::uint32_t HeaderSize;
+  /// Size of the records, 0 if the log was not closed
+  std::uint64_t DataSize;
+  std::uint64_t Reserved;
+};
+
+static_assert(sizeof(FileHeader) == vtkSlicerIMSTKSessionLog::HeaderSize, "Unexpected log header size");
+static_assert(sizeof(vtkSlicerIMSTKSessionLog::RecordHeader) == 16, "Unexpected record header size");
+
+const std::size_t InitialFileSize = 1 << 20;
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKSessionLog::vtkSlicerIMSTKSessionLog()
+  : Recording(false)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKSessionLog::~vtkSlicerIMSTKSessionLog()
+{
+  this->StopRecording();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKSessionLog::StartRecording(const std::string& fileName)
+{
+  this->StopRecording();
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Records.clear();
+  this->DevicePoses.clear();
+  // Drop any previous content, the new one is zero-filled
+  if (!this->File.Open(fileName, vtkSlicerIMSTKMappedFile::ReadWrite)
+    || !this->File.Resize(0) || !this->File.Resize(InitialFileSize))
+  {
+    this->File.Close();
+    return false;
+  }
+  FileHeader header = {};
+  std::memcpy(header.Magic, Magic, sizeof(Magic));
+  header.Version = Version;
+  header.HeaderSize = HeaderSize;
+  std::memcpy(this->File.GetData(), &header, sizeof(header));
+  this->End = HeaderSize;
+  this->Start = ClockType::now();
+  if (!this->PoseQueues)
+  {
+    this->PoseQueues.reset(new std::array<PoseQueue, NumberOfPoseQueues>());
+  }
+  // Drop the poses queued since the last recording stopped
+  this->WritePoseQueues();
+  this->Recording.store(true, std::memory_order_release);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKSessionLog::StopRecording()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  if (!this->Recording.load(std::memory_order_relaxed))
+  {
+    return;
+  }
+  this->WritePoseQueues();
+  this->Recording.store(false, std::memory_order_release);
+  FileHeader* header = reinterpret_cast<FileHeader*>(this->File.GetData());
+  header->DataSize = this->End - HeaderSize;
+  this->File.Resize(this->End);
+  this->File.Close();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKSessionLog::Record(int type, int stream, ClockType::time_point time,
+  const double* values, std::uint32_t numberOfValues)
+{
+  if (!this->Recording.load(std::memory_order_acquire))
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->WritePoseQueues();
+  this->WriteRecord(type, stream, time, values, numberOfValues);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKSessionLog::RecordDevicePose(int stream, ClockType::time_point time,
+  const std::array<double, 3>& position, const std::array<double, 4>& orientation)
+{
+  if (!this->IsRecording())
+  {
+    return;
+  }
+  if (stream < 0 || stream >= NumberOfPoseQueues)
+  {
+    const double values[7] = { position[0], position[1], position[2],
+      orientation[0], orientation[1], orientation[2], orientation[3] };
+    this->Record(DevicePoseRecord, stream, time, values, 7);
+    return;
+  }
+
+  PoseQueue& queue = (*this->PoseQueues)[stream];
+  const std::uint64_t head = queue.Head.load(std::memory_order_relaxed);
+  if (head - queue.Tail.load(std::memory_order_acquire) == PoseQueue::Capacity)
+  {
+    // Nobody wrote the queue for a while, write it here
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->WritePoseQueues();
+  }
+  PoseQueue::Entry& entry = queue.Entries[head & (PoseQueue::Capacity - 1)];
+  entry.Time = time;
+  std::copy(position.begin(), position.end(), entry.Values);
+  std::copy(orientation.begin(), orientation.end(), entry.Values + 3);
+  queue.Head.store(head + 1, std::memory_order_release);
+
+  if (head + 1 - queue.Tail.load(std::memory_order_acquire) >= PoseQueue::Capacity / 2
+    && this->Mutex.try_lock())
+  {
+    this->WritePoseQueues();
+    this->Mutex.unlock();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKSessionLog::Flush()
+{
+  if (!this->Recording.load(std::memory_order_acquire))
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->WritePoseQueues();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKSessionLog::WriteRecord(int type, int stream, ClockType::time_point time,
+  const double* values, std::uint32_t numberOfValues)
+{
+  if (!this->Recording.load(std::memory_order_relaxed))
+  {
+    return;
+  }
+  const std::size_t size = sizeof(RecordHeader) + numberOfValues * sizeof(double);
+  if (this->End + size > this->File.GetSize()
+    && !this->File.Resize(std::max(2 * this->File.GetSize(), this->End + size)))
+  {
+    // Out of disk space, keep what was written
+    this->Recording.store(false, std::memory_order_release);
+    return;
+  }
+  RecordHeader record;
+  record.Type = static_cast<std::uint16_t>(type);
+  record.Stream = static_cast<std::uint16_t>(stream);
+  record.NumberOfValues = numberOfValues;
+  record.Time = std::chrono::duration_cast<std::chrono::nanoseconds>(time - this->Start).count();
+  char* destination = this->File.GetData() + this->End;
+  std::memcpy(destination, &record, sizeof(record));
+  std::memcpy(destination + sizeof(record), values, numberOfValues * sizeof(double));
+  this->End += size;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKSessionLog::WritePoseQueues()
+{
+  if (!this->PoseQueues)
+  {
+    return;
+  }
+  for (int stream = 0; stream < NumberOfPoseQueues; stream++)
+  {
+    PoseQueue& queue = (*this->PoseQueues)[stream];
+    std::uint64_t tail = queue.Tail.load(std::memory_order_relaxed);
+    const std::uint64_t head = queue.Head.load(std::memory_order_acquire);
+    // Poses queued while not recording are dropped
+    for (; tail != head; tail++)
+    {
+      const PoseQueue::Entry& entry = queue.Entries[tail & (PoseQueue::Capacity - 1)];
+      this->WriteRecord(DevicePoseRecord, stream, entry.Time, entry.Values, 7);
+    }
+    queue.Tail.store(tail, std::memory_order_release);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKSessionLog::Load(const std::string& fileName)
+{
+  this->StopRecording();
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Records.clear();
+  this->DevicePoses.clear();
+  if (!this->File.Open(fileName, vtkSlicerIMSTKMappedFile::ReadOnly)
+    || this->File.GetSize() < HeaderSize)
+  {
+    this->File.Close();
+    return false;
+  }
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(this->File.GetData());
+  if (std::memcmp(header->Magic, Magic, sizeof(Magic)) != 0 || header->Version != Version)
+  {
+    this->File.Close();
+    return false;
+  }
+
+  // Unclosed logs end with the zero-filled part of the file
+  std::size_t end = this->File.GetSize();
+  if (header->DataSize > 0)
+  {
+    end = std::min<std::size_t>(end, header->HeaderSize + header->DataSize);
+  }
+  std::size_t offset = header->HeaderSize;
+  while (offset + sizeof(RecordHeader) <= end)
+  {
+    RecordHeader record;
+    std::memcpy(&record, this->File.GetData() + offset, sizeof(record));
+    const std::size_t size = sizeof(RecordHeader) + record.NumberOfValues * sizeof(double);
+    if (record.Type == 0 || offset + size > end)
+    {
+      break;
+    }
+    if (record.Type == DevicePoseRecord && record.NumberOfValues == 7)
+    {
+      this->DevicePoses[record.Stream].push_back(this->Records.size());
+    }
+    this->Records.push_back(offset);
+    offset += size;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+const vtkSlicerIMSTKSessionLog::RecordHeader& vtkSlicerIMSTKSessionLog::GetRecord(std::size_t index) const
+{
+  return *reinterpret_cast<const RecordHeader*>(this->File.GetData() + this->Records[index]);
+}
+
+//----------------------------------------------------------------------------
+const double* vtkSlicerIMSTKSessionLog::GetValues(std::size_t index) const
+{
+  return reinterpret_cast<const double*>(this->File.GetData() + this->Records[index] + sizeof(RecordHeader));
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerIMSTKSessionLog::GetDuration() const
+{
+  return this->Records.empty() ? 0.0 : this->GetRecord(this->Records.size() - 1).Time * 1e-9;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKSessionLog::GetDevicePose(int stream, double time,
+  std::array<double, 3>& position, std::array<double, 4>& orientation) const
+{
+  auto it = this->DevicePoses.find(stream);
+  if (it == this->DevicePoses.end() || it->second.empty())
+  {
+    return false;
+  }
+  const std::vector<std::size_t>& poses = it->second;
+  const std::int64_t nanoseconds = static_cast<std::int64_t>(time * 1e9);
+
+  // First pose recorded after the requested time
+  auto after = std::upper_bound(poses.begin(), poses.end(), nanoseconds,
+    [this](std::int64_t t, std::size_t index) { return t < this->GetRecord(index).Time; });
+  if (after == poses.begin() || after == poses.end())
+  {
+    const double* values = this->GetValues(after == poses.end() ? poses.back() : poses.front());
+    std::copy(values, values + 3, position.begin());
+    std::copy(values + 3, values + 7, orientation.begin());
+    return true;
+  }
+  const std::size_t index1 = *after;
+  const std::size_t index0 = *(after - 1);
+  const double t0 = this->GetRecord(index0).Time * 1e-9;
+  const double t1 = this->GetRecord(index1).Time * 1e-9;
+  const double alpha = t1 > t0 ? (time - t0) / (t1 - t0) : 1.0;
+  const double* values0 = this->GetValues(index0);
+  const double* values1 = this->GetValues(index1);
+  for (int i = 0; i < 3; i++)
+  {
+    position[i] = values0[i] + alpha * (values1[i] - values0[i]);
+  }
+  const std::array<double, 4> q0 = { { values0[3], values0[4], values0[5], values0[6] } };
+  const std::array<double, 4> q1 = { { values1[3], values1[4], values1[5], values1[6] } };
+  vtkSlicerIMSTKPoseRingBuffer::Slerp(q0, q1, alpha, orientation);
+  return true;
+}
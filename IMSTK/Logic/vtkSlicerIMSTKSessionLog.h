@@ -0,0 +1,171 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKSessionLog_h
+#define __vtkSlicerIMSTKSessionLog_h
+
+// STD includes
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerIMSTKMappedFile.h"
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+/// \brief Binary log of a simulation session: device poses and the
+/// transforms pushed to MRML, timestamped.
+///
+/// The file is a 32 bytes header followed by records, in native byte order.
+/// Each record is a RecordHeader followed by its values as doubles:
+/// - DevicePoseRecord: position (3) and orientation quaternion (w, x, y, z)
+/// - TransformRecord: row-major 4x4 matrix of one transform observer
+/// - TransformBatchRecord: structure-of-arrays matrices of a transform batch
+///
+/// The stream identifies the device or observer within its record type.
+/// Times are in nanoseconds since the recording started.
+///
+/// Logs are written and read through a memory mapping. Writing is
+/// thread-safe and does nothing while no file is open, so recording calls
+/// can be left in place. A log is still readable if the application
+/// stopped before closing it.
+///
+/// Device poses are recorded at the device rate from real-time threads, so
+/// they do not take the lock: they are queued per stream and written by the
+/// next Record() or Flush() call, or by the recording thread itself, without
+/// waiting, once its queue is half full.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKSessionLog
+{
+public:
+  typedef std::chrono::steady_clock ClockType;
+
+  enum RecordType
+  {
+    DevicePoseRecord = 1,
+    TransformRecord,
+    TransformBatchRecord
+  };
+
+  struct RecordHeader
+  {
+    std::uint16_t Type;
+    std::uint16_t Stream;
+    std::uint32_t NumberOfValues;
+    std::int64_t Time;
+  };
+
+  vtkSlicerIMSTKSessionLog();
+  ~vtkSlicerIMSTKSessionLog();
+
+  //@{
+  /// Writing
+
+  /// Start writing \a fileName, replacing its content. Times of the records
+  /// are relative to this call.
+  bool StartRecording(const std::string& fileName);
+  void StopRecording();
+  bool IsRecording() const { return this->Recording.load(std::memory_order_acquire); }
+
+  /// Append a record, if recording, after the queued device poses
+  void Record(int type, int stream, ClockType::time_point time, const double* values, std::uint32_t numberOfValues);
+
+  /// Queue a device pose, if recording. Poses of a stream must be recorded
+  /// by one thread at a time.
+  void RecordDevicePose(int stream, ClockType::time_point time,
+    const std::array<double, 3>& position, const std::array<double, 4>& orientation);
+
+  /// Write the queued device poses, call regularly while recording
+  void Flush();
+  //@}
+
+  //@{
+  /// Reading
+
+  /// Map an existing log for reading
+  bool Load(const std::string& fileName);
+
+  std::size_t GetNumberOfRecords() const { return this->Records.size(); }
+  const RecordHeader& GetRecord(std::size_t index) const;
+  const double* GetValues(std::size_t index) const;
+
+  /// Time of the last record, in seconds
+  double GetDuration() const;
+
+  /// Pose of the device \a stream at \a time seconds, interpolated between
+  /// the recorded poses. Returns false if the device has no recorded pose.
+  bool GetDevicePose(int stream, double time,
+    std::array<double, 3>& position, std::array<double, 4>& orientation) const;
+  //@}
+
+  static const char Magic[8];
+  static const std::uint32_t Version = 1;
+  static const std::size_t HeaderSize = 32;
+
+  /// Number of device streams whose poses are queued, poses of the other
+  /// streams are written directly
+  static const int NumberOfPoseQueues = 16;
+
+private:
+  /// Single-producer/single-consumer queue of the device poses of a stream.
+  /// The consumer side only runs with the mutex held.
+  struct PoseQueue
+  {
+    /// Must be a power of 2
+    static const std::uint64_t Capacity = 128;
+
+    struct Entry
+    {
+      ClockType::time_point Time;
+      double Values[7];
+    };
+
+    std::array<Entry, Capacity> Entries;
+    std::atomic<std::uint64_t> Head{ 0 };
+    std::atomic<std::uint64_t> Tail{ 0 };
+  };
+
+  /// Append a record, with the mutex held
+  void WriteRecord(int type, int stream, ClockType::time_point time, const double* values,
+    std::uint32_t numberOfValues);
+  /// Write the queued device poses, with the mutex held
+  void WritePoseQueues();
+
+  vtkSlicerIMSTKMappedFile File;
+
+  // Writing
+  std::mutex Mutex;
+  std::atomic<bool> Recording;
+  std::size_t End = 0;
+  ClockType::time_point Start;
+  /// Allocated by the first recording, then kept as threads may still be
+  /// queuing poses after it stopped
+  std::unique_ptr<std::array<PoseQueue, NumberOfPoseQueues>> PoseQueues;
+
+  // Reading
+  std::vector<std::size_t> Records;
+  std::map<int, std::vector<std::size_t>> DevicePoses;
+
+  vtkSlicerIMSTKSessionLog(const vtkSlicerIMSTKSessionLog&) = delete;
+  void operator=(const vtkSlicerIMSTKSessionLog&) = delete;
+};
+
+#endif
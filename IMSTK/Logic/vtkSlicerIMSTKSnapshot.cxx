@@ -0,0 +1,193 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKSnapshot.h"
+
+// STD includes
+#include <cstring>
+
+const char vtkSlicerIMSTKSnapshot::Magic[8] = { 'I', 'M', 'S', 'T', 'K', 'S', 'N', 'P' };
+
+namespace
+{
+//----------------------------------------------------------------------------
+struct FileHeader
+{
+  char Magic[8];
+  std::uint32_t Version;
+  std::uint32_t HeaderSize;
+  /// Size of the records
+  std::uint64_t DataSize;
+  std::uint64_t NumberOfRecords;
+};
+
+static_assert(sizeof(FileHeader) == vtkSlicerIMSTKSnapshot::HeaderSize, "Unexpected snapshot header size");
+static_assert(sizeof(vtkSlicerIMSTKSnapshot::RecordHeader) == 8, "Unexpected record header size");
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKSnapshot::vtkSlicerIMSTKSnapshot()
+{
+  this->Clear();
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerIMSTKSnapshot::~vtkSlicerIMSTKSnapshot() = default;
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKSnapshot::Clear(std::size_t numberOfRecords, std::size_t numberOfValues)
+{
+  this->File.Close();
+  this->Records.clear();
+  this->Records.reserve(numberOfRecords);
+  this->Buffer.reserve(HeaderSize + numberOfRecords * sizeof(RecordHeader) + numberOfValues * sizeof(double));
+  this->Buffer.assign(HeaderSize, 0);
+  FileHeader header = {};
+  std::memcpy(header.Magic, Magic, sizeof(Magic));
+  header.Version = Version;
+  header.HeaderSize = HeaderSize;
+  std::memcpy(this->Buffer.data(), &header, sizeof(header));
+}
+
+//----------------------------------------------------------------------------
+double* vtkSlicerIMSTKSnapshot::AddRecord(int type, int stream, std::uint32_t numberOfValues)
+{
+  if (this->File.IsOpen())
+  {
+    this->Clear();
+  }
+  const std::size_t offset = this->Buffer.size();
+  this->Buffer.resize(offset + sizeof(RecordHeader) + numberOfValues * sizeof(double));
+  RecordHeader record;
+  record.Type = static_cast<std::uint16_t>(type);
+  record.Stream = static_cast<std::uint16_t>(stream);
+  record.NumberOfValues = numberOfValues;
+  std::memcpy(this->Buffer.data() + offset, &record, sizeof(record));
+  this->Records.push_back(offset);
+
+  FileHeader* header = reinterpret_cast<FileHeader*>(this->Buffer.data());
+  header->DataSize = this->Buffer.size() - HeaderSize;
+  header->NumberOfRecords = this->Records.size();
+  return reinterpret_cast<double*>(this->Buffer.data() + offset + sizeof(RecordHeader));
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKSnapshot::Write(const std::string& fileName) const
+{
+  vtkSlicerIMSTKMappedFile file;
+  // Drop any previous content
+  if (!file.Open(fileName, vtkSlicerIMSTKMappedFile::ReadWrite)
+    || !file.Resize(0) || !file.Resize(this->GetSize()))
+  {
+    return false;
+  }
+  std::memcpy(file.GetData(), this->GetData(), this->GetSize());
+  file.Close();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKSnapshot::Load(const std::string& fileName)
+{
+  this->Clear();
+  if (!this->File.Open(fileName, vtkSlicerIMSTKMappedFile::ReadOnly)
+    || this->File.GetSize() < HeaderSize)
+  {
+    this->Clear();
+    return false;
+  }
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(this->File.GetData());
+  if (std::memcmp(header->Magic, Magic, sizeof(Magic)) != 0 || header->Version != Version
+    || header->HeaderSize < HeaderSize || header->HeaderSize % sizeof(double) != 0
+    || header->HeaderSize > this->File.GetSize()
+    || header->DataSize > this->File.GetSize() - header->HeaderSize)
+  {
+    this->Clear();
+    return false;
+  }
+
+  // Snapshots are written at once, a truncated one is invalid
+  const std::size_t end = header->HeaderSize + header->DataSize;
+  std::size_t offset = header->HeaderSize;
+  while (offset < end)
+  {
+    RecordHeader record;
+    if (offset + sizeof(RecordHeader) > end)
+    {
+      this->Clear();
+      return false;
+    }
+    std::memcpy(&record, this->File.GetData() + offset, sizeof(record));
+    const std::size_t size = sizeof(RecordHeader) + record.NumberOfValues * sizeof(double);
+    if (offset + size > end)
+    {
+      this->Clear();
+      return false;
+    }
+    this->Records.push_back(offset);
+    offset += size;
+  }
+  if (this->Records.size() != header->NumberOfRecords)
+  {
+    this->Clear();
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+const vtkSlicerIMSTKSnapshot::RecordHeader& vtkSlicerIMSTKSnapshot::GetRecord(std::size_t index) const
+{
+  return *reinterpret_cast<const RecordHeader*>(this->GetData() + this->Records[index]);
+}
+
+//----------------------------------------------------------------------------
+const double* vtkSlicerIMSTKSnapshot::GetValues(std::size_t index) const
+{
+  return reinterpret_cast<const double*>(this->GetData() + this->Records[index] + sizeof(RecordHeader));
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKSnapshot::FindRecord(int type, int stream) const
+{
+  for (std::size_t i = 0; i < this->Records.size(); i++)
+  {
+    const RecordHeader& record = this->GetRecord(i);
+    if (record.Type == type && record.Stream == stream)
+    {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkSlicerIMSTKSnapshot::GetData() const
+{
+  return this->File.IsOpen() ? this->File.GetData() : this->Buffer.data();
+}
+
+//----------------------------------------------------------------------------
+std::size_t vtkSlicerIMSTKSnapshot::GetSize() const
+{
+  if (this->File.IsOpen())
+  {
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(this->File.GetData());
+    return header->HeaderSize + header->DataSize;
+  }
+  return this->Buffer.size();
+}
@@ -0,0 +1,118 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKSnapshot_h
+#define __vtkSlicerIMSTKSnapshot_h
+
+// STD includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerIMSTKMappedFile.h"
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+/// \brief Compact binary state of the objects of a simulation.
+///
+/// A snapshot is a 32 bytes header followed by records, in native byte
+/// order. Each record is a RecordHeader followed by its values as doubles:
+/// - TransformRecord: row-major 4x4 matrix of the visual geometry
+/// - VerticesRecord: vertex positions of the visual geometry (3 per vertex)
+/// - RigidBodyRecord: position (3), orientation quaternion (w, x, y, z),
+///   linear velocity (3) and angular velocity (3) of a rigid body
+/// - ControllerRecord: translation offset (3), rotation offset quaternion
+///   (w, x, y, z) and translation scaling of an object controller
+///
+/// The stream is the index of the object or controller in its simulation.
+///
+/// Snapshots are built in memory, the file format being the memory layout:
+/// writing is a single copy to a mapped file, and loaded snapshots are read
+/// from their mapping without copying.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKSnapshot
+{
+public:
+  enum RecordType
+  {
+    TransformRecord = 1,
+    VerticesRecord,
+    RigidBodyRecord,
+    ControllerRecord
+  };
+
+  struct RecordHeader
+  {
+    std::uint16_t Type;
+    std::uint16_t Stream;
+    std::uint32_t NumberOfValues;
+  };
+
+  vtkSlicerIMSTKSnapshot();
+  ~vtkSlicerIMSTKSnapshot();
+
+  //@{
+  /// Writing
+
+  /// Start a new snapshot in memory, closing any loaded file. Memory for
+  /// \a numberOfRecords records holding \a numberOfValues values in total is
+  /// reserved, so that adding them does not allocate.
+  void Clear(std::size_t numberOfRecords = 0, std::size_t numberOfValues = 0);
+
+  /// Append a record and return its values, to be filled by the caller.
+  /// The pointer is invalidated by the next call.
+  double* AddRecord(int type, int stream, std::uint32_t numberOfValues);
+
+  /// Write the snapshot to \a fileName, replacing its content
+  bool Write(const std::string& fileName) const;
+  //@}
+
+  //@{
+  /// Reading
+
+  /// Map an existing snapshot. Returns false if it is not a valid snapshot,
+  /// in which case the snapshot is empty.
+  bool Load(const std::string& fileName);
+
+  std::size_t GetNumberOfRecords() const { return this->Records.size(); }
+  const RecordHeader& GetRecord(std::size_t index) const;
+  const double* GetValues(std::size_t index) const;
+
+  /// Index of the record of \a type for \a stream, or -1 if there is none
+  int FindRecord(int type, int stream) const;
+
+  /// Header and records, GetSize() bytes
+  const char* GetData() const;
+  std::size_t GetSize() const;
+  //@}
+
+  static const char Magic[8];
+  static const std::uint32_t Version = 1;
+  static const std::size_t HeaderSize = 32;
+
+private:
+  /// Snapshot built in memory
+  std::vector<char> Buffer;
+  /// Snapshot loaded from a file, used instead of Buffer while open
+  vtkSlicerIMSTKMappedFile File;
+  /// Offsets of the records
+  std::vector<std::size_t> Records;
+
+  vtkSlicerIMSTKSnapshot(const vtkSlicerIMSTKSnapshot&) = delete;
+  void operator=(const vtkSlicerIMSTKSnapshot&) = delete;
+};
+
+#endif
@@ -0,0 +1,146 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKTraceBuffer_h
+#define __vtkSlicerIMSTKTraceBuffer_h
+
+// STD includes
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <thread>
+
+/// \brief Fixed-capacity ring of timed events, exportable as a Chrome trace.
+///
+/// Events can be recorded from any number of threads without locking nor
+/// allocation, the oldest events are overwritten once the ring is full.
+/// Each slot is protected by a sequence lock: writers claim a slot before
+/// writing it, and an event whose slot is still being written by a thread
+/// that went around the whole ring meanwhile is dropped.
+/// Event names must be string literals (only the pointer is stored).
+///
+/// The output of WriteChromeTrace() can be loaded in chrome://tracing or
+/// https://ui.perfetto.dev
+class vtkSlicerIMSTKTraceBuffer
+{
+public:
+  typedef std::chrono::steady_clock ClockType;
+
+  explicit vtkSlicerIMSTKTraceBuffer(std::size_t capacity = 16384)
+    : Capacity(capacity)
+    , Events(new Event[capacity])
+    , Head(0)
+    , Origin(ClockType::now())
+  {
+  }
+
+  /// Record an event that lasted from \a start to \a end
+  void Record(const char* name, ClockType::time_point start, ClockType::time_point end)
+  {
+    const std::uint64_t index = this->Head.fetch_add(1, std::memory_order_relaxed);
+    Event& event = this->Events[index % this->Capacity];
+    // Odd sequences mark the slot as being written: claim it, readers skip
+    // it until the final even sequence is set. Acquiring the previous
+    // sequence orders these writes after the ones of the previous writer.
+    std::uint64_t sequence = event.Sequence.load(std::memory_order_relaxed);
+    if ((sequence & 1) != 0 || !event.Sequence.compare_exchange_strong(sequence, 2 * index + 1,
+      std::memory_order_acquire, std::memory_order_relaxed))
+    {
+      return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    event.Name = name;
+    event.Thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+    event.Start = std::chrono::duration<double, std::micro>(start - this->Origin).count();
+    event.Duration = std::chrono::duration<double, std::micro>(end - start).count();
+    event.Sequence.store(2 * index + 2, std::memory_order_release);
+  }
+
+  /// Forget all events. Must not be called while events are being recorded.
+  void Clear()
+  {
+    for (std::size_t i = 0; i < this->Capacity; i++)
+    {
+      this->Events[i].Sequence.store(0, std::memory_order_relaxed);
+    }
+    this->Head.store(0, std::memory_order_relaxed);
+    this->Origin = ClockType::now();
+  }
+
+  /// Write the recorded events using the Chrome trace event format
+  void WriteChromeTrace(std::ostream& os, int processId = 1) const
+  {
+    const std::ios::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << "{\"traceEvents\":[";
+    bool first = true;
+    for (std::size_t i = 0; i < this->Capacity; i++)
+    {
+      const Event& event = this->Events[i];
+      const std::uint64_t sequence = event.Sequence.load(std::memory_order_acquire);
+      // Empty, or being written
+      if (sequence == 0 || (sequence & 1) != 0)
+      {
+        continue;
+      }
+      const char* name = event.Name;
+      const std::size_t thread = event.Thread;
+      const double start = event.Start;
+      const double duration = event.Duration;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (event.Sequence.load(std::memory_order_relaxed) != sequence)
+      {
+        // Overwritten while reading
+        continue;
+      }
+      os << (first ? "" : ",") << "\n{\"name\":\"" << name << "\",\"ph\":\"X\""
+         << ",\"ts\":" << start << ",\"dur\":" << duration
+         << ",\"pid\":" << processId << ",\"tid\":" << (thread % 100000) << "}";
+      first = false;
+    }
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    os.flags(flags);
+    os.precision(precision);
+  }
+
+private:
+  struct Event
+  {
+    /// 0 if empty, 2 * index + 1 while event index is written, then
+    /// 2 * index + 2
+    std::atomic<std::uint64_t> Sequence{ 0 };
+    const char* Name = nullptr;
+    std::size_t Thread = 0;
+    double Start = 0.0;
+    double Duration = 0.0;
+  };
+
+  const std::size_t Capacity;
+  std::unique_ptr<Event[]> Events;
+  std::atomic<std::uint64_t> Head;
+  ClockType::time_point Origin;
+
+  vtkSlicerIMSTKTraceBuffer(const vtkSlicerIMSTKTraceBuffer&) = delete;
+  void operator=(const vtkSlicerIMSTKTraceBuffer&) = delete;
+};
+
+#endif
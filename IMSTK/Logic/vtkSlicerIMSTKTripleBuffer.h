@@ -0,0 +1,95 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKTripleBuffer_h
+#define __vtkSlicerIMSTKTripleBuffer_h
+
+// STD includes
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/// \brief Single-producer/single-consumer lock-free triple buffer.
+///
+/// The producer (typically the iMSTK scene manager thread) fills the slot
+/// returned by GetWriteBuffer() and calls Publish(). The consumer (typically
+/// the Slicer main thread) calls Consume() and reads GetReadBuffer().
+///
+/// Neither side ever blocks: the producer and the consumer each own one slot
+/// and the third one is exchanged atomically between them. The consumer only
+/// ever sees the most recently published value, older values are overwritten.
+template <typename T>
+class vtkSlicerIMSTKTripleBuffer
+{
+public:
+  vtkSlicerIMSTKTripleBuffer()
+    : Back(0)
+    , Middle(1)
+    , Front(2)
+  {
+  }
+
+  /// Slot owned by the producer. Only call from the producer thread.
+  T& GetWriteBuffer() { return this->Buffers[this->Back]; }
+
+  /// Hand the write buffer over to the consumer.
+  /// Returns false if the previously published value had not been consumed
+  /// yet and was therefore overwritten.
+  bool Publish()
+  {
+    const std::uint8_t previous =
+      this->Middle.exchange(static_cast<std::uint8_t>(this->Back | DirtyBit), std::memory_order_acq_rel);
+    this->Back = previous & IndexMask;
+    return (previous & DirtyBit) == 0;
+  }
+
+  /// Fetch the most recently published value, if any.
+  /// Returns false if nothing was published since the last call.
+  /// Only call from the consumer thread.
+  bool Consume()
+  {
+    if ((this->Middle.load(std::memory_order_relaxed) & DirtyBit) == 0)
+    {
+      return false;
+    }
+    const std::uint8_t previous = this->Middle.exchange(this->Front, std::memory_order_acq_rel);
+    this->Front = previous & IndexMask;
+    return true;
+  }
+
+  /// Slot owned by the consumer. Only call from the consumer thread.
+  T& GetReadBuffer() { return this->Buffers[this->Front]; }
+  const T& GetReadBuffer() const { return this->Buffers[this->Front]; }
+
+  /// Direct access to the three slots. Only use before the producer starts,
+  /// for instance to preallocate them.
+  T& GetSlot(int index) { return this->Buffers[index]; }
+
+private:
+  static const std::uint8_t IndexMask = 0x3;
+  static const std::uint8_t DirtyBit = 0x4;
+
+  std::array<T, 3> Buffers;
+  std::uint8_t Back;
+  std::atomic<std::uint8_t> Middle;
+  std::uint8_t Front;
+
+  vtkSlicerIMSTKTripleBuffer(const vtkSlicerIMSTKTripleBuffer&) = delete;
+  void operator=(const vtkSlicerIMSTKTripleBuffer&) = delete;
+};
+
+#endif
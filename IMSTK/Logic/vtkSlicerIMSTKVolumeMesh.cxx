@@ -0,0 +1,452 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSlicerIMSTKVolumeMesh.h"
+#include "vtkSlicerIMSTKFileCache.h"
+#include "vtkSlicerIMSTKGeometryCache.h"
+#include "vtkSlicerIMSTKMappedFile.h"
+
+// iMSTK includes
+#include <imstkTetrahedralMesh.h>
+#include <imstkVecDataArray.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCleanPolyData.h>
+#include <vtkDelaunay3D.h>
+#include <vtkGenericCell.h>
+#include <vtkIdList.h>
+#include <vtkImplicitPolyDataDistance.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkSMPThreadLocalObject.h>
+#include <vtkSMPTools.h>
+#include <vtkStaticCellLocator.h>
+#include <vtkTriangleFilter.h>
+#include <vtkUnstructuredGrid.h>
+
+// STD includes
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+const char* vtkSlicerIMSTKVolumeMesh::DerivedDataName = "VolumeMesh";
+
+namespace
+{
+//----------------------------------------------------------------------------
+const char VolumeMeshMagic[8] = { 'I', 'M', 'S', 'T', 'K', 'T', 'E', 'T' };
+const std::uint32_t VolumeMeshVersion = 1;
+
+//----------------------------------------------------------------------------
+struct FileHeader
+{
+  vtkSlicerIMSTKFileCache::FileHeader Common;
+  double CellSize;
+  double MinimumQuality;
+  std::int64_t NumberOfVertices;
+  std::int64_t NumberOfTetrahedra;
+  std::int64_t NumberOfSurfacePoints;
+};
+
+/// Inner points per diagonal of the surface bounds when no cell size is given
+const double DefaultCellsPerDiagonal = 20.0;
+
+//----------------------------------------------------------------------------
+/// Normalized radius ratio of a tetrahedron, 1 if regular, 0 if flat
+double ComputeQuality(const imstk::Vec3d& p0, const imstk::Vec3d& p1, const imstk::Vec3d& p2, const imstk::Vec3d& p3)
+{
+  const imstk::Vec3d a = p1 - p0;
+  const imstk::Vec3d b = p2 - p0;
+  const imstk::Vec3d c = p3 - p0;
+  const double sixVolume = std::abs(a.dot(b.cross(c)));
+  if (sixVolume <= 0.0)
+  {
+    return 0.0;
+  }
+  const double area = 0.5 * (a.cross(b).norm() + b.cross(c).norm() + c.cross(a).norm()
+    + (p2 - p1).cross(p3 - p1).norm());
+  const double inradius = sixVolume / (2.0 * area);
+  const double circumradius = (a.squaredNorm() * b.cross(c) + b.squaredNorm() * c.cross(a)
+    + c.squaredNorm() * a.cross(b)).norm() / (2.0 * sixVolume);
+  return 3.0 * inradius / circumradius;
+}
+
+//----------------------------------------------------------------------------
+/// Barycentric coordinates of \a point in the tetrahedron (\a p0, ..., \a p3)
+void ComputeWeights(const imstk::Vec3d& point, const imstk::Vec3d& p0, const imstk::Vec3d& p1,
+  const imstk::Vec3d& p2, const imstk::Vec3d& p3, double* weights)
+{
+  imstk::Mat3d edges;
+  edges << p1 - p0, p2 - p0, p3 - p0;
+  const imstk::Vec3d coordinates = edges.colPivHouseholderQr().solve(point - p0);
+  weights[0] = 1.0 - coordinates.sum();
+  weights[1] = coordinates[0];
+  weights[2] = coordinates[1];
+  weights[3] = coordinates[2];
+}
+
+//----------------------------------------------------------------------------
+bool SameParameters(const vtkSlicerIMSTKVolumeMesh::Parameters& a, const vtkSlicerIMSTKVolumeMesh::Parameters& b)
+{
+  return a.CellSize == b.CellSize && a.MinimumQuality == b.MinimumQuality;
+}
+
+//----------------------------------------------------------------------------
+/// Tetrahedralizations generated with \a parameters
+vtkSlicerIMSTKFileCache::Storage GetStorage(const vtkSlicerIMSTKVolumeMesh::Parameters& parameters)
+{
+  vtkSlicerIMSTKFileCache::Storage storage;
+  storage.Name = vtkSlicerIMSTKVolumeMesh::DerivedDataName;
+  storage.FileName = [parameters](const std::string& directory, std::uint64_t contentHash)
+  {
+    return vtkSlicerIMSTKVolumeMesh::GetFileName(directory, contentHash, parameters);
+  };
+  storage.Read = [](const std::string& fileName, std::uint64_t contentHash)
+  {
+    return std::shared_ptr<void>(vtkSlicerIMSTKVolumeMesh::Read(fileName, contentHash));
+  };
+  storage.Write = [](const std::string& fileName, std::uint64_t contentHash, const std::shared_ptr<void>& data)
+  {
+    return vtkSlicerIMSTKVolumeMesh::Write(fileName, contentHash,
+      *std::static_pointer_cast<const vtkSlicerIMSTKVolumeMesh::Tetrahedralization>(data));
+  };
+  storage.Accept = [parameters](const std::shared_ptr<void>& data)
+  {
+    return SameParameters(
+      std::static_pointer_cast<const vtkSlicerIMSTKVolumeMesh::Tetrahedralization>(data)->Generation, parameters);
+  };
+  return storage;
+}
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerIMSTKVolumeMesh::Tetrahedralization::Apply(const imstk::VecDataArray<double, 3>& vertices, double* output) const
+{
+  const imstk::Vec3d* volumeVertices = vertices.getPointer();
+  const imstk::Vec4i* tetrahedra = this->Mesh->getTetrahedraIndices()->getPointer();
+  const int* tetrahedronIds = this->SurfaceTetrahedra.data();
+  const double* weights = this->SurfaceWeights.data();
+  vtkSMPTools::For(0, this->GetNumberOfSurfacePoints(),
+    [=](vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType i = begin; i < end; i++)
+      {
+        const imstk::Vec4i& tetrahedron = tetrahedra[tetrahedronIds[i]];
+        const double* w = weights + 4 * i;
+        const imstk::Vec3d point = w[0] * volumeVertices[tetrahedron[0]] + w[1] * volumeVertices[tetrahedron[1]]
+          + w[2] * volumeVertices[tetrahedron[2]] + w[3] * volumeVertices[tetrahedron[3]];
+        output[3 * i] = point[0];
+        output[3 * i + 1] = point[1];
+        output[3 * i + 2] = point[2];
+      }
+    });
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<const vtkSlicerIMSTKVolumeMesh::Tetrahedralization> vtkSlicerIMSTKVolumeMesh::Generate(
+  vtkSlicerIMSTKGeometryCache* cache, const std::string& key, vtkPolyData* polyData,
+  const Parameters& parameters, const std::string& directory)
+{
+  // Tetrahedralized from the polydata rather than from the cached mesh, to
+  // get the original surface points
+  return std::static_pointer_cast<const Tetrahedralization>(vtkSlicerIMSTKFileCache::Precompute(
+    cache, key, polyData, GetStorage(parameters), directory,
+    [polyData, &parameters](std::shared_ptr<imstk::SurfaceMesh>)
+    {
+      return std::shared_ptr<void>(Compute(polyData, parameters));
+    }));
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<const vtkSlicerIMSTKVolumeMesh::Tetrahedralization> vtkSlicerIMSTKVolumeMesh::Find(
+  vtkSlicerIMSTKGeometryCache* cache, const std::string& key, const Parameters& parameters, const std::string& directory)
+{
+  return std::static_pointer_cast<const Tetrahedralization>(
+    vtkSlicerIMSTKFileCache::Find(cache, key, GetStorage(parameters), directory));
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<vtkSlicerIMSTKVolumeMesh::Tetrahedralization> vtkSlicerIMSTKVolumeMesh::Compute(
+  vtkPolyData* polyData, const Parameters& parameters)
+{
+  if (!polyData || polyData->GetNumberOfPolys() == 0)
+  {
+    return nullptr;
+  }
+
+  // Consistently oriented triangles, so that distances are negative inside
+  vtkNew<vtkTriangleFilter> triangulate;
+  triangulate->SetInputData(polyData);
+  triangulate->PassVertsOff();
+  triangulate->PassLinesOff();
+  vtkNew<vtkCleanPolyData> clean;
+  clean->SetInputConnection(triangulate->GetOutputPort());
+  vtkNew<vtkPolyDataNormals> normals;
+  normals->SetInputConnection(clean->GetOutputPort());
+  normals->SplittingOff();
+  normals->ConsistencyOn();
+  normals->AutoOrientNormalsOn();
+  normals->Update();
+  vtkPolyData* surface = normals->GetOutput();
+  if (surface->GetNumberOfPolys() == 0)
+  {
+    return nullptr;
+  }
+
+  double bounds[6];
+  surface->GetBounds(bounds);
+  const double diagonal = std::sqrt((bounds[1] - bounds[0]) * (bounds[1] - bounds[0])
+    + (bounds[3] - bounds[2]) * (bounds[3] - bounds[2]) + (bounds[5] - bounds[4]) * (bounds[5] - bounds[4]));
+  const double cellSize = parameters.CellSize > 0.0 ? parameters.CellSize : diagonal / DefaultCellsPerDiagonal;
+  if (cellSize <= 0.0)
+  {
+    return nullptr;
+  }
+
+  // Surface points, then inner grid points far enough from the surface not
+  // to create slivers
+  vtkNew<vtkImplicitPolyDataDistance> distance;
+  distance->SetInput(surface);
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToDouble();
+  points->DeepCopy(surface->GetPoints());
+  for (double z = bounds[4] + cellSize / 2.0; z < bounds[5]; z += cellSize)
+  {
+    for (double y = bounds[2] + cellSize / 2.0; y < bounds[3]; y += cellSize)
+    {
+      for (double x = bounds[0] + cellSize / 2.0; x < bounds[1]; x += cellSize)
+      {
+        double point[3] = { x, y, z };
+        if (distance->EvaluateFunction(point) < -0.5 * cellSize)
+        {
+          points->InsertNextPoint(point);
+        }
+      }
+    }
+  }
+  vtkNew<vtkPolyData> cloud;
+  cloud->SetPoints(points);
+  vtkNew<vtkDelaunay3D> delaunay;
+  delaunay->SetInputData(cloud);
+  delaunay->Update();
+  vtkUnstructuredGrid* grid = delaunay->GetOutput();
+
+  // The triangulation fills the convex hull, only the tetrahedra inside the
+  // surface are kept, with their points renumbered.
+  std::vector<int> pointIds(grid->GetNumberOfPoints(), -1);
+  std::vector<imstk::Vec3d> vertices;
+  std::vector<imstk::Vec4i> tetrahedra;
+  vtkNew<vtkIdList> cellPoints;
+  for (vtkIdType cellId = 0; cellId < grid->GetNumberOfCells(); cellId++)
+  {
+    if (grid->GetCellType(cellId) != VTK_TETRA)
+    {
+      continue;
+    }
+    grid->GetCellPoints(cellId, cellPoints);
+    imstk::Vec3d corners[4];
+    for (int i = 0; i < 4; i++)
+    {
+      grid->GetPoint(cellPoints->GetId(i), corners[i].data());
+    }
+    imstk::Vec3d centroid = (corners[0] + corners[1] + corners[2] + corners[3]) / 4.0;
+    if (distance->EvaluateFunction(centroid.data()) >= 0.0
+      || ComputeQuality(corners[0], corners[1], corners[2], corners[3]) < parameters.MinimumQuality)
+    {
+      continue;
+    }
+    imstk::Vec4i tetrahedron;
+    for (int i = 0; i < 4; i++)
+    {
+      int& pointId = pointIds[cellPoints->GetId(i)];
+      if (pointId < 0)
+      {
+        pointId = static_cast<int>(vertices.size());
+        vertices.push_back(corners[i]);
+      }
+      tetrahedron[i] = pointId;
+    }
+    tetrahedra.push_back(tetrahedron);
+  }
+  if (tetrahedra.empty())
+  {
+    return nullptr;
+  }
+
+  auto tetrahedralization = std::make_shared<Tetrahedralization>();
+  tetrahedralization->Generation = parameters;
+  auto vertexArray = std::make_shared<imstk::VecDataArray<double, 3>>(static_cast<int>(vertices.size()));
+  std::copy(vertices.begin(), vertices.end(), vertexArray->getPointer());
+  auto tetrahedronArray = std::make_shared<imstk::VecDataArray<int, 4>>(static_cast<int>(tetrahedra.size()));
+  std::copy(tetrahedra.begin(), tetrahedra.end(), tetrahedronArray->getPointer());
+  tetrahedralization->Mesh = std::make_shared<imstk::TetrahedralMesh>();
+  tetrahedralization->Mesh->initialize(vertexArray, tetrahedronArray);
+
+  // Attach the points of the original surface to their closest tetrahedron
+  vtkNew<vtkPoints> volumePoints;
+  volumePoints->SetDataTypeToDouble();
+  volumePoints->SetNumberOfPoints(static_cast<vtkIdType>(vertices.size()));
+  std::copy(vertices[0].data(), vertices[0].data() + 3 * vertices.size(),
+    static_cast<double*>(volumePoints->GetVoidPointer(0)));
+  vtkNew<vtkCellArray> volumeCells;
+  for (const imstk::Vec4i& tetrahedron : tetrahedra)
+  {
+    const vtkIdType ids[4] = { tetrahedron[0], tetrahedron[1], tetrahedron[2], tetrahedron[3] };
+    volumeCells->InsertNextCell(4, ids);
+  }
+  vtkNew<vtkUnstructuredGrid> volume;
+  volume->SetPoints(volumePoints);
+  volume->SetCells(VTK_TETRA, volumeCells);
+  vtkNew<vtkStaticCellLocator> locator;
+  locator->SetDataSet(volume);
+  locator->BuildLocator();
+
+  const vtkIdType numberOfSurfacePoints = polyData->GetNumberOfPoints();
+  tetrahedralization->SurfaceTetrahedra.resize(numberOfSurfacePoints);
+  tetrahedralization->SurfaceWeights.resize(4 * numberOfSurfacePoints);
+  vtkPoints* surfacePoints = polyData->GetPoints();
+  vtkSMPThreadLocalObject<vtkGenericCell> cells;
+  Tetrahedralization* output = tetrahedralization.get();
+  vtkSMPTools::For(0, numberOfSurfacePoints,
+    [&](vtkIdType begin, vtkIdType end)
+    {
+      vtkGenericCell* cell = cells.Local();
+      for (vtkIdType i = begin; i < end; i++)
+      {
+        double point[3], closest[3], distance2;
+        vtkIdType cellId;
+        int subId;
+        surfacePoints->GetPoint(i, point);
+        locator->FindClosestPoint(point, closest, cell, cellId, subId, distance2);
+        const imstk::Vec4i& tetrahedron = tetrahedra[cellId];
+        output->SurfaceTetrahedra[i] = static_cast<int>(cellId);
+        ComputeWeights(imstk::Vec3d(point[0], point[1], point[2]), vertices[tetrahedron[0]],
+          vertices[tetrahedron[1]], vertices[tetrahedron[2]], vertices[tetrahedron[3]],
+          &output->SurfaceWeights[4 * i]);
+      }
+    });
+  return tetrahedralization;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerIMSTKVolumeMesh::Write(const std::string& fileName, std::uint64_t contentHash,
+  const Tetrahedralization& tetrahedralization)
+{
+  FileHeader header = {};
+  header.Common = vtkSlicerIMSTKFileCache::MakeHeader(VolumeMeshMagic, VolumeMeshVersion, sizeof(FileHeader), contentHash);
+  header.CellSize = tetrahedralization.Generation.CellSize;
+  header.MinimumQuality = tetrahedralization.Generation.MinimumQuality;
+  header.NumberOfVertices = tetrahedralization.Mesh->getNumVertices();
+  header.NumberOfTetrahedra = tetrahedralization.Mesh->getNumTetrahedra();
+  header.NumberOfSurfacePoints = tetrahedralization.GetNumberOfSurfacePoints();
+  const std::size_t verticesSize = 3 * header.NumberOfVertices * sizeof(double);
+  const std::size_t weightsSize = 4 * header.NumberOfSurfacePoints * sizeof(double);
+  const std::size_t tetrahedraSize = 4 * header.NumberOfTetrahedra * sizeof(std::int32_t);
+  const std::size_t surfaceTetrahedraSize = header.NumberOfSurfacePoints * sizeof(std::int32_t);
+
+  return vtkSlicerIMSTKFileCache::WriteFile(fileName,
+    sizeof(FileHeader) + verticesSize + weightsSize + tetrahedraSize + surfaceTetrahedraSize,
+    [&](char* data)
+    {
+      std::memcpy(data, &header, sizeof(header));
+      data += sizeof(header);
+      std::memcpy(data, tetrahedralization.Mesh->getInitialVertexPositions()->getVoidPointer(), verticesSize);
+      data += verticesSize;
+      std::memcpy(data, tetrahedralization.SurfaceWeights.data(), weightsSize);
+      data += weightsSize;
+      std::memcpy(data, tetrahedralization.Mesh->getTetrahedraIndices()->getVoidPointer(), tetrahedraSize);
+      data += tetrahedraSize;
+      std::memcpy(data, tetrahedralization.SurfaceTetrahedra.data(), surfaceTetrahedraSize);
+    });
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<vtkSlicerIMSTKVolumeMesh::Tetrahedralization> vtkSlicerIMSTKVolumeMesh::Read(
+  const std::string& fileName, std::uint64_t contentHash)
+{
+  vtkSlicerIMSTKMappedFile file;
+  if (!vtkSlicerIMSTKFileCache::OpenFile(file, fileName,
+    vtkSlicerIMSTKFileCache::MakeHeader(VolumeMeshMagic, VolumeMeshVersion, sizeof(FileHeader), contentHash)))
+  {
+    return nullptr;
+  }
+  FileHeader header;
+  std::memcpy(&header, file.GetData(), sizeof(header));
+  if (header.NumberOfVertices <= 0
+    || header.NumberOfTetrahedra <= 0 || header.NumberOfSurfacePoints < 0)
+  {
+    return nullptr;
+  }
+  const std::size_t verticesSize = 3 * header.NumberOfVertices * sizeof(double);
+  const std::size_t weightsSize = 4 * header.NumberOfSurfacePoints * sizeof(double);
+  const std::size_t tetrahedraSize = 4 * header.NumberOfTetrahedra * sizeof(std::int32_t);
+  const std::size_t surfaceTetrahedraSize = header.NumberOfSurfacePoints * sizeof(std::int32_t);
+  if (file.GetSize() < sizeof(FileHeader) + verticesSize + weightsSize + tetrahedraSize + surfaceTetrahedraSize)
+  {
+    return nullptr;
+  }
+
+  auto tetrahedralization = std::make_shared<Tetrahedralization>();
+  tetrahedralization->Generation.CellSize = header.CellSize;
+  tetrahedralization->Generation.MinimumQuality = header.MinimumQuality;
+  auto vertices = std::make_shared<imstk::VecDataArray<double, 3>>(static_cast<int>(header.NumberOfVertices));
+  auto tetrahedra = std::make_shared<imstk::VecDataArray<int, 4>>(static_cast<int>(header.NumberOfTetrahedra));
+  tetrahedralization->SurfaceWeights.resize(4 * header.NumberOfSurfacePoints);
+  tetrahedralization->SurfaceTetrahedra.resize(header.NumberOfSurfacePoints);
+
+  const char* data = file.GetData() + sizeof(header);
+  std::memcpy(vertices->getVoidPointer(), data, verticesSize);
+  data += verticesSize;
+  std::memcpy(tetrahedralization->SurfaceWeights.data(), data, weightsSize);
+  data += weightsSize;
+  std::memcpy(tetrahedra->getVoidPointer(), data, tetrahedraSize);
+  data += tetrahedraSize;
+  std::memcpy(tetrahedralization->SurfaceTetrahedra.data(), data, surfaceTetrahedraSize);
+
+  // Indices are validated once here rather than at each use
+  const int* indices = static_cast<const int*>(tetrahedra->getVoidPointer());
+  for (std::int64_t i = 0; i < 4 * header.NumberOfTetrahedra; i++)
+  {
+    if (indices[i] < 0 || indices[i] >= header.NumberOfVertices)
+    {
+      return nullptr;
+    }
+  }
+  for (int tetrahedron : tetrahedralization->SurfaceTetrahedra)
+  {
+    if (tetrahedron < 0 || tetrahedron >= header.NumberOfTetrahedra)
+    {
+      return nullptr;
+    }
+  }
+
+  tetrahedralization->Mesh = std::make_shared<imstk::TetrahedralMesh>();
+  tetrahedralization->Mesh->initialize(vertices, tetrahedra);
+  return tetrahedralization;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkSlicerIMSTKVolumeMesh::GetFileName(const std::string& directory, std::uint64_t contentHash,
+  const Parameters& parameters)
+{
+  std::ostringstream suffix;
+  suffix << "_" << parameters.CellSize << "_" << parameters.MinimumQuality << ".tet";
+  return vtkSlicerIMSTKFileCache::GetFileName(directory, contentHash, suffix.str());
+}
@@ -0,0 +1,117 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerIMSTKVolumeMesh_h
+#define __vtkSlicerIMSTKVolumeMesh_h
+
+// STD includes
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vtkSlicerIMSTKModuleLogicExport.h"
+
+class vtkPolyData;
+class vtkSlicerIMSTKGeometryCache;
+
+namespace imstk
+{
+  class TetrahedralMesh;
+  template<typename T, int N> class VecDataArray;
+}
+
+/// \brief Tetrahedral meshes of closed surfaces, for deformable objects.
+///
+/// The surface is tetrahedralized by a Delaunay triangulation of its points
+/// and of a regular grid of points inside it. Tetrahedra outside the surface
+/// and tetrahedra of poor quality (slivers) are discarded. Each point of the
+/// original surface is then attached to its closest tetrahedron by its
+/// barycentric coordinates, so that the surface follows the deformations of
+/// the volume.
+///
+/// Like vtkSlicerIMSTKCollisionData, tetrahedralizations are stored in memory
+/// and on disk by vtkSlicerIMSTKFileCache, in a file named after the content
+/// hash of the surface and the generation parameters.
+///
+/// File format (native byte order): FileHeader, then the vertices and the
+/// surface weights as doubles, then the tetrahedra and the surface
+/// tetrahedra as 32 bits integers.
+///
+/// All methods are thread-safe.
+class VTK_SLICER_IMSTK_MODULE_LOGIC_EXPORT vtkSlicerIMSTKVolumeMesh
+{
+public:
+  struct Parameters
+  {
+    /// Spacing of the inner points, which is about the size of the
+    /// tetrahedra. 0 means 1/20 of the diagonal of the surface bounds.
+    double CellSize = 0.0;
+    /// Tetrahedra whose normalized radius ratio (3 * inradius / circumradius,
+    /// 1 for a regular tetrahedron) is lower are discarded
+    double MinimumQuality = 0.1;
+  };
+
+  struct Tetrahedralization
+  {
+    /// Shared by all the users, it must be copied before being simulated
+    std::shared_ptr<imstk::TetrahedralMesh> Mesh;
+    /// Per surface point: tetrahedron and barycentric coordinates in it
+    /// (4 values)
+    std::vector<int> SurfaceTetrahedra;
+    std::vector<double> SurfaceWeights;
+    /// Parameters of the generation
+    Parameters Generation;
+
+    int GetNumberOfSurfacePoints() const { return static_cast<int>(this->SurfaceTetrahedra.size()); }
+
+    /// Compute the surface points from the tetrahedral mesh \a vertices.
+    /// \a output holds GetNumberOfSurfacePoints() points.
+    void Apply(const imstk::VecDataArray<double, 3>& vertices, double* output) const;
+  };
+
+  /// Name of the derived data in the geometry cache
+  static const char* DerivedDataName;
+
+  /// Return the tetrahedralization of \a polyData, from memory, disk, or
+  /// computed (slow) and then stored in both. \a directory may be empty, in
+  /// which case nothing is read from or written to disk.
+  static std::shared_ptr<const Tetrahedralization> Generate(vtkSlicerIMSTKGeometryCache* cache,
+    const std::string& key, vtkPolyData* polyData, const Parameters& parameters, const std::string& directory);
+
+  /// Return the tetrahedralization of the geometry cached as \a key if it was
+  /// generated with \a parameters, from memory or disk, or null. Never
+  /// computes it.
+  static std::shared_ptr<const Tetrahedralization> Find(vtkSlicerIMSTKGeometryCache* cache,
+    const std::string& key, const Parameters& parameters, const std::string& directory);
+
+  /// Return null if \a polyData has no polygons
+  static std::shared_ptr<Tetrahedralization> Compute(vtkPolyData* polyData, const Parameters& parameters);
+
+  static bool Write(const std::string& fileName, std::uint64_t contentHash, const Tetrahedralization& tetrahedralization);
+
+  /// Return null if the file does not exist or was written for another content
+  static std::shared_ptr<Tetrahedralization> Read(const std::string& fileName, std::uint64_t contentHash);
+
+  /// File of the tetrahedralization of a geometry in \a directory, for
+  /// \a parameters. Close parameters may share a file, the parameters
+  /// stored in the file tell them apart.
+  static std::string GetFileName(const std::string& directory, std::uint64_t contentHash,
+    const Parameters& parameters);
+};
+
+#endif
@@ -0,0 +1,443 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Checks that the callbacks the logic adds to a scene manager do not
+// allocate once warmed up: all the forms of the global operator new are
+// replaced to count the allocations of the thread stepping the scene, which
+// are compared with and without the rigid, deformable, statistics, tracing
+// and pose export callbacks. With glibc, malloc, calloc, realloc and the
+// aligned variants are replaced as well, so that the allocations of Eigen
+// and of C code are counted. With other C libraries they are not counted.
+//
+// iMSTK itself allocates when posting events, so the steps are compared
+// with the steps of the same scene before it is observed rather than with
+// zero. Allocations made by the MRML updates, on the main thread, are not
+// counted.
+//
+// The replacements apply to the whole executable, so this test has its own
+// driver. It is not built on Windows, where the allocations of the logic
+// and iMSTK DLLs do not go through the functions of the executable.
+
+// IMSTK Logic includes
+#include "vtkSlicerIMSTKLogic.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScene.h>
+
+// iMSTK includes
+#include "imstkCollidingObject.h"
+#include "imstkGeometryUtilities.h"
+#include "imstkNew.h"
+#include "imstkScene.h"
+#include "imstkSceneManager.h"
+#include "imstkSurfaceMesh.h"
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+
+// STD includes
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace
+{
+/// Only the allocations of the thread stepping the scene are counted
+thread_local bool CountAllocations = false;
+thread_local std::uint64_t NumberOfAllocations = 0;
+
+//----------------------------------------------------------------------------
+void CountAllocation()
+{
+  if (CountAllocations)
+  {
+    NumberOfAllocations++;
+  }
+}
+
+#if defined(__GLIBC__)
+/// The C allocation functions are replaced below and count the allocations
+/// made through operator new
+const bool MallocIsCounted = true;
+#else
+const bool MallocIsCounted = false;
+#endif
+
+//----------------------------------------------------------------------------
+void* AlignedMalloc(std::size_t size, std::size_t alignment)
+{
+  alignment = std::max(alignment, sizeof(void*));
+  void* memory = nullptr;
+  return posix_memalign(&memory, alignment, size > 0 ? size : 1) == 0 ? memory : nullptr;
+}
+
+//----------------------------------------------------------------------------
+void AlignedFree(void* memory)
+{
+  std::free(memory);
+}
+
+//----------------------------------------------------------------------------
+/// Allocate with \a allocate, calling the new handler until it succeeds
+template <typename TAllocate>
+void* Allocate(TAllocate allocate)
+{
+  if (!MallocIsCounted)
+  {
+    CountAllocation();
+  }
+  for (;;)
+  {
+    if (void* memory = allocate())
+    {
+      return memory;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (!handler)
+    {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+}
+
+#if defined(__GLIBC__)
+// Eigen, VTK and iMSTK also allocate with malloc and its variants, which
+// glibc lets the executable replace. Other C libraries are not interposed,
+// so only operator new is counted there.
+extern "C"
+{
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* memory, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+
+//----------------------------------------------------------------------------
+void* malloc(std::size_t size) noexcept
+{
+  CountAllocation();
+  return __libc_malloc(size);
+}
+
+//----------------------------------------------------------------------------
+void* calloc(std::size_t count, std::size_t size) noexcept
+{
+  CountAllocation();
+  return __libc_calloc(count, size);
+}
+
+//----------------------------------------------------------------------------
+void* realloc(void* memory, std::size_t size) noexcept
+{
+  CountAllocation();
+  return __libc_realloc(memory, size);
+}
+
+//----------------------------------------------------------------------------
+void* memalign(std::size_t alignment, std::size_t size) noexcept
+{
+  CountAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+//----------------------------------------------------------------------------
+void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+{
+  CountAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+//----------------------------------------------------------------------------
+int posix_memalign(void** memory, std::size_t alignment, std::size_t size) noexcept
+{
+  CountAllocation();
+  if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+  {
+    return EINVAL;
+  }
+  void* result = __libc_memalign(alignment, size);
+  if (!result)
+  {
+    return ENOMEM;
+  }
+  *memory = result;
+  return 0;
+}
+}
+#endif
+
+//----------------------------------------------------------------------------
+void* operator new(std::size_t size)
+{
+  return Allocate([size]() { return std::malloc(size > 0 ? size : 1); });
+}
+
+//----------------------------------------------------------------------------
+void* operator new[](std::size_t size)
+{
+  return ::operator new(size);
+}
+
+//----------------------------------------------------------------------------
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  try
+  {
+    return ::operator new(size);
+  }
+  catch (...)
+  {
+    return nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  try
+  {
+    return ::operator new[](size);
+  }
+  catch (...)
+  {
+    return nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+  return Allocate([size, alignment]() { return AlignedMalloc(size, static_cast<std::size_t>(alignment)); });
+}
+
+//----------------------------------------------------------------------------
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return ::operator new(size, alignment);
+}
+
+//----------------------------------------------------------------------------
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+  try
+  {
+    return ::operator new(size, alignment);
+  }
+  catch (...)
+  {
+    return nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+  try
+  {
+    return ::operator new[](size, alignment);
+  }
+  catch (...)
+  {
+    return nullptr;
+  }
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* memory) noexcept
+{
+  std::free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete[](void* memory) noexcept
+{
+  std::free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* memory, std::size_t) noexcept
+{
+  std::free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete[](void* memory, std::size_t) noexcept
+{
+  std::free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+  std::free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+  std::free(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+  AlignedFree(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+  AlignedFree(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+  AlignedFree(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+  AlignedFree(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  AlignedFree(memory);
+}
+
+//----------------------------------------------------------------------------
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  AlignedFree(memory);
+}
+
+namespace
+{
+//----------------------------------------------------------------------------
+/// Move the objects and step the scene \a numberOfSteps times, draining the
+/// mailboxes as the display would. Returns the number of allocations made
+/// by the steps.
+std::uint64_t Step(const std::shared_ptr<imstk::SceneManager>& sceneManager, vtkSlicerIMSTKLogic* logic,
+  const std::vector<std::shared_ptr<imstk::SceneObject>>& objects, int numberOfSteps)
+{
+  std::uint64_t numberOfAllocations = 0;
+  for (int step = 0; step < numberOfSteps; step++)
+  {
+    NumberOfAllocations = 0;
+    CountAllocations = true;
+    for (const std::shared_ptr<imstk::SceneObject>& object : objects)
+    {
+      object->getVisualGeometry()->translate(imstk::Vec3d(0.01, 0.0, 0.0),
+        imstk::Geometry::TransformType::ConcatenateToTransform);
+    }
+    sceneManager->update();
+    CountAllocations = false;
+    numberOfAllocations += NumberOfAllocations;
+    if (logic && step % 16 == 0)
+    {
+      logic->processPendingUpdates();
+    }
+  }
+  return numberOfAllocations;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKAllocationTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  const std::string simName = "AllocationTest";
+  const int numberOfObjects = 10;
+  const int numberOfWarmUpSteps = 100;
+  const int numberOfSteps = 1000;
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerIMSTKLogic> logic;
+  logic->SetMRMLScene(scene);
+
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(16);
+  sphere->SetPhiResolution(16);
+  sphere->Update();
+
+  imstk::imstkNew<imstk::Scene> imstkScene("AllocationTest");
+  std::vector<std::shared_ptr<imstk::SceneObject>> objects;
+  std::vector<vtkMRMLModelNode*> modelNodes;
+  std::vector<vtkMRMLLinearTransformNode*> transformNodes;
+  for (int i = 0; i < numberOfObjects; i++)
+  {
+    auto geometry = imstk::GeometryUtils::copyToSurfaceMesh(sphere->GetOutput());
+    imstk::imstkNew<imstk::CollidingObject> object("Object" + std::to_string(i));
+    object->setVisualGeometry(geometry);
+    object->setCollidingGeometry(geometry);
+    imstkScene->addSceneObject(object);
+    objects.push_back(object);
+    modelNodes.push_back(vtkMRMLModelNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLModelNode")));
+    transformNodes.push_back(
+      vtkMRMLLinearTransformNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLLinearTransformNode")));
+  }
+  // The last object is also observed as a deformable body
+  vtkMRMLModelNode* deformableNode = vtkMRMLModelNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLModelNode"));
+
+  imstk::imstkNew<imstk::SceneManager> sceneManager;
+  sceneManager->setActiveScene(imstkScene);
+  sceneManager->init();
+
+  // Allocations of iMSTK alone
+  Step(sceneManager, nullptr, objects, numberOfWarmUpSteps);
+  const std::uint64_t baseline = Step(sceneManager, nullptr, objects, numberOfSteps);
+
+  // Observe everything, publishing at every step
+  logic->registerSimulation(simName, sceneManager);
+  logic->setSyncMode(simName, vtkSlicerIMSTKLogic::SyncOnRender);
+  logic->setTracing(simName, true);
+  logic->startPoseExport("vtkSlicerIMSTKAllocationTest" + std::to_string(getpid()), numberOfObjects);
+  logic->observeRigidBodies(sceneManager, objects, modelNodes, transformNodes);
+  logic->observeDeformableBody(sceneManager, objects.back(), deformableNode, /* updateNormals= */ true);
+
+  Step(sceneManager, logic, objects, numberOfWarmUpSteps);
+  const std::uint64_t observed = Step(sceneManager, logic, objects, numberOfSteps);
+
+  logic->stopPoseExport();
+  sceneManager->uninit();
+
+  std::cout << "Allocations in " << numberOfSteps << " steps: " << baseline << " without observers, "
+    << observed << " with observers" << std::endl;
+  if (observed > baseline)
+  {
+    std::cerr << "The observers allocated " << (observed - baseline) << " times in " << numberOfSteps
+      << " steps" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
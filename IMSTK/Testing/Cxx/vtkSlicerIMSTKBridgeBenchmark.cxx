@@ -0,0 +1,370 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Measures the cost of the Slicer <-> iMSTK bridge:
+//  - VTK <-> iMSTK mesh conversion throughput against mesh size
+//  - per-tick cost of the rigid body transform observers, one callback per
+//    object or batched
+//  - latency between draining a pose and the MRML transform modified event
+//
+// Everything runs headless on synthetic vtkSphereSource meshes. Results are
+// written as JSON, using the Google Benchmark layout, to the file given as
+// first argument (or to the standard output).
+
+// IMSTK Logic includes
+#include "vtkSlicerIMSTKLogic.h"
+#include "vtkSlicerIMSTKGeometryConversion.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScene.h>
+
+// iMSTK includes
+#include "imstkCollidingObject.h"
+#include "imstkGeometryUtilities.h"
+#include "imstkNew.h"
+#include "imstkScene.h"
+#include "imstkSceneManager.h"
+#include "imstkSurfaceMesh.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+
+// STD includes
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+typedef std::chrono::steady_clock ClockType;
+
+//----------------------------------------------------------------------------
+struct BenchmarkResult
+{
+  std::string Name;
+  int Iterations = 0;
+  /// Median time of one iteration, in microseconds
+  double Median = 0.0;
+  /// 99th percentile time of one iteration, in microseconds
+  double P99 = 0.0;
+  /// Additional counters, emitted as extra fields
+  std::vector<std::pair<std::string, double>> Counters;
+};
+
+//----------------------------------------------------------------------------
+/// Run \a function \a iterations times and summarize the timings
+template <typename Function>
+BenchmarkResult Measure(const std::string& name, int iterations, Function function)
+{
+  std::vector<double> timings;
+  timings.reserve(iterations);
+  for (int i = 0; i < iterations; i++)
+  {
+    const ClockType::time_point start = ClockType::now();
+    function();
+    const std::chrono::duration<double, std::micro> elapsed = ClockType::now() - start;
+    timings.push_back(elapsed.count());
+  }
+  std::sort(timings.begin(), timings.end());
+
+  BenchmarkResult result;
+  result.Name = name;
+  result.Iterations = iterations;
+  result.Median = timings[timings.size() / 2];
+  result.P99 = timings[std::min(timings.size() - 1, timings.size() * 99 / 100)];
+  return result;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> CreateSphere(int resolution)
+{
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(resolution);
+  sphere->SetPhiResolution(resolution);
+  sphere->SetRadius(50.0);
+  sphere->Update();
+  return sphere->GetOutput();
+}
+
+//----------------------------------------------------------------------------
+void BenchmarkConversion(std::vector<BenchmarkResult>& results)
+{
+  const int resolutions[] = { 16, 32, 64, 128, 256 };
+  for (int resolution : resolutions)
+  {
+    vtkSmartPointer<vtkPolyData> polyData = CreateSphere(resolution);
+    const double numberOfPoints = static_cast<double>(polyData->GetNumberOfPoints());
+    const double numberOfCells = static_cast<double>(polyData->GetNumberOfCells());
+    const int iterations = std::max(5, 2000 / resolution);
+
+    std::shared_ptr<imstk::SurfaceMesh> mesh;
+    BenchmarkResult toIMSTK = Measure("copyToSurfaceMesh/" + std::to_string(resolution), iterations,
+      [&]() { mesh = imstk::GeometryUtils::copyToSurfaceMesh(polyData); });
+    toIMSTK.Counters.emplace_back("points", numberOfPoints);
+    toIMSTK.Counters.emplace_back("triangles", numberOfCells);
+    toIMSTK.Counters.emplace_back("points_per_second", numberOfPoints / (toIMSTK.Median * 1e-6));
+    results.push_back(toIMSTK);
+
+    BenchmarkResult toVTK = Measure("copyToVtkPolyData/" + std::to_string(resolution), iterations,
+      [&]() { imstk::GeometryUtils::copyToVtkPolyData(mesh); });
+    toVTK.Counters.emplace_back("points", numberOfPoints);
+    toVTK.Counters.emplace_back("triangles", numberOfCells);
+    toVTK.Counters.emplace_back("points_per_second", numberOfPoints / (toVTK.Median * 1e-6));
+    results.push_back(toVTK);
+
+    BenchmarkResult toIMSTKParallel = Measure("ToSurfaceMesh/" + std::to_string(resolution), iterations,
+      [&]() { mesh = vtkSlicerIMSTKGeometryConversion::ToSurfaceMesh(polyData); });
+    toIMSTKParallel.Counters.emplace_back("points", numberOfPoints);
+    toIMSTKParallel.Counters.emplace_back("triangles", numberOfCells);
+    toIMSTKParallel.Counters.emplace_back("points_per_second", numberOfPoints / (toIMSTKParallel.Median * 1e-6));
+    results.push_back(toIMSTKParallel);
+
+    BenchmarkResult adopt = Measure("ToSurfaceMesh/adopt/" + std::to_string(resolution), iterations,
+      [&]() { vtkSlicerIMSTKGeometryConversion::ToSurfaceMesh(polyData, true); });
+    adopt.Counters.emplace_back("points", numberOfPoints);
+    adopt.Counters.emplace_back("triangles", numberOfCells);
+    adopt.Counters.emplace_back("points_per_second", numberOfPoints / (adopt.Median * 1e-6));
+    results.push_back(adopt);
+
+    BenchmarkResult toVTKParallel = Measure("ToPolyData/" + std::to_string(resolution), iterations,
+      [&]() { vtkSlicerIMSTKGeometryConversion::ToPolyData(mesh); });
+    toVTKParallel.Counters.emplace_back("points", numberOfPoints);
+    toVTKParallel.Counters.emplace_back("triangles", numberOfCells);
+    toVTKParallel.Counters.emplace_back("points_per_second", numberOfPoints / (toVTKParallel.Median * 1e-6));
+    results.push_back(toVTKParallel);
+  }
+}
+
+//----------------------------------------------------------------------------
+void BenchmarkTransformObserver(std::vector<BenchmarkResult>& results, bool batched)
+{
+  const int objectCounts[] = { 0, 1, 10, 100, 250 };
+  const std::string suffix = batched ? "/batched" : "";
+  vtkSmartPointer<vtkPolyData> polyData = CreateSphere(8);
+  for (int objectCount : objectCounts)
+  {
+    vtkNew<vtkMRMLScene> scene;
+    vtkNew<vtkSlicerIMSTKLogic> logic;
+    logic->SetMRMLScene(scene);
+
+    imstk::imstkNew<imstk::Scene> imstkScene("Benchmark");
+    imstk::imstkNew<imstk::SceneManager> sceneManager;
+    sceneManager->setActiveScene(imstkScene);
+    logic->registerSimulation("Benchmark", sceneManager);
+    // Publish every step so that the full observer path is measured
+    logic->setSyncMode("Benchmark", vtkSlicerIMSTKLogic::SyncOnRender);
+
+    std::vector<std::shared_ptr<imstk::SceneObject>> objects;
+    std::vector<vtkMRMLModelNode*> modelNodes;
+    std::vector<vtkMRMLLinearTransformNode*> transformNodes;
+    for (int i = 0; i < objectCount; i++)
+    {
+      auto geometry = imstk::GeometryUtils::copyToSurfaceMesh(polyData);
+      imstk::imstkNew<imstk::CollidingObject> object("Object" + std::to_string(i));
+      object->setVisualGeometry(geometry);
+      object->setCollidingGeometry(geometry);
+      imstkScene->addSceneObject(object);
+      objects.push_back(object);
+
+      modelNodes.push_back(vtkMRMLModelNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLModelNode")));
+      transformNodes.push_back(
+        vtkMRMLLinearTransformNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLLinearTransformNode")));
+      if (!batched)
+      {
+        logic->observeRigidBody(sceneManager, object, modelNodes.back(), transformNodes.back());
+      }
+    }
+    if (batched)
+    {
+      logic->observeRigidBodies(sceneManager, objects, modelNodes, transformNodes);
+    }
+
+    sceneManager->init();
+    for (int i = 0; i < 100; i++)
+    {
+      sceneManager->update();
+    }
+    BenchmarkResult tick = Measure("SceneManagerTick/objects:" + std::to_string(objectCount) + suffix, 2000,
+      [&]() { sceneManager->update(); });
+    tick.Counters.emplace_back("objects", objectCount);
+    results.push_back(tick);
+
+    // Move every object so that each drain modifies all the transform nodes
+    BenchmarkResult drain = Measure("ProcessPendingUpdates/objects:" + std::to_string(objectCount) + suffix, 200,
+      [&]()
+      {
+        for (auto& object : objects)
+        {
+          object->getVisualGeometry()->translate(imstk::Vec3d(0.01, 0.0, 0.0), imstk::Geometry::TransformType::ConcatenateToTransform);
+        }
+        sceneManager->update();
+        logic->processPendingUpdates();
+      });
+    drain.Counters.emplace_back("objects", objectCount);
+    results.push_back(drain);
+
+    sceneManager->uninit();
+  }
+}
+
+//----------------------------------------------------------------------------
+struct LatencyProbe
+{
+  ClockType::time_point Received;
+  bool Triggered = false;
+};
+
+//----------------------------------------------------------------------------
+void OnTransformModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  LatencyProbe* probe = static_cast<LatencyProbe*>(clientData);
+  probe->Received = ClockType::now();
+  probe->Triggered = true;
+}
+
+//----------------------------------------------------------------------------
+/// Returns false if the transform changes never reach the model node
+bool BenchmarkMRMLPropagation(std::vector<BenchmarkResult>& results)
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerIMSTKLogic> logic;
+  logic->SetMRMLScene(scene);
+
+  vtkSmartPointer<vtkPolyData> polyData = CreateSphere(8);
+  imstk::imstkNew<imstk::Scene> imstkScene("Benchmark");
+  auto geometry = imstk::GeometryUtils::copyToSurfaceMesh(polyData);
+  imstk::imstkNew<imstk::CollidingObject> object("Object");
+  object->setVisualGeometry(geometry);
+  object->setCollidingGeometry(geometry);
+  imstkScene->addSceneObject(object);
+
+  imstk::imstkNew<imstk::SceneManager> sceneManager;
+  sceneManager->setActiveScene(imstkScene);
+  logic->registerSimulation("Benchmark", sceneManager);
+  logic->setSyncMode("Benchmark", vtkSlicerIMSTKLogic::SyncOnRender);
+
+  vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLModelNode"));
+  vtkMRMLLinearTransformNode* transformNode =
+    vtkMRMLLinearTransformNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLLinearTransformNode"));
+  logic->observeRigidBody(sceneManager, object, modelNode, transformNode);
+
+  LatencyProbe probe;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(OnTransformModified);
+  callback->SetClientData(&probe);
+  modelNode->AddObserver(vtkMRMLTransformableNode::TransformModifiedEvent, callback);
+
+  sceneManager->init();
+  std::vector<double> latencies;
+  for (int i = 0; i < 500; i++)
+  {
+    geometry->translate(imstk::Vec3d(0.01, 0.0, 0.0), imstk::Geometry::TransformType::ConcatenateToTransform);
+    sceneManager->update();
+    probe.Triggered = false;
+    const ClockType::time_point start = ClockType::now();
+    logic->processPendingUpdates();
+    if (probe.Triggered)
+    {
+      const std::chrono::duration<double, std::micro> latency = probe.Received - start;
+      latencies.push_back(latency.count());
+    }
+  }
+  sceneManager->uninit();
+  modelNode->RemoveObserver(callback);
+
+  if (latencies.empty())
+  {
+    std::cerr << "MRML propagation benchmark: transform modified event was never received" << std::endl;
+    return false;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  BenchmarkResult result;
+  result.Name = "MRMLPropagationLatency";
+  result.Iterations = static_cast<int>(latencies.size());
+  result.Median = latencies[latencies.size() / 2];
+  result.P99 = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+  results.push_back(result);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void WriteJSON(std::ostream& os, const std::vector<BenchmarkResult>& results)
+{
+  os << "{\n";
+  os << "  \"context\": {\n";
+  os << "    \"executable\": \"vtkSlicerIMSTKBridgeBenchmark\",\n";
+  os << "    \"time_unit\": \"us\"\n";
+  os << "  },\n";
+  os << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const BenchmarkResult& result = results[i];
+    os << "    {\n";
+    os << "      \"name\": \"" << result.Name << "\",\n";
+    os << "      \"iterations\": " << result.Iterations << ",\n";
+    os << "      \"real_time\": " << result.Median << ",\n";
+    os << "      \"p99_time\": " << result.P99 << ",\n";
+    for (const auto& counter : result.Counters)
+    {
+      os << "      \"" << counter.first << "\": " << counter.second << ",\n";
+    }
+    os << "      \"time_unit\": \"us\"\n";
+    os << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n";
+  os << "}\n";
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKBridgeBenchmark(int argc, char* argv[])
+{
+  std::vector<BenchmarkResult> results;
+  BenchmarkConversion(results);
+  BenchmarkTransformObserver(results, /* batched= */ false);
+  BenchmarkTransformObserver(results, /* batched= */ true);
+  const bool propagated = BenchmarkMRMLPropagation(results);
+
+  if (argc > 1)
+  {
+    std::ofstream output(argv[1]);
+    if (!output)
+    {
+      std::cerr << "Failed to open " << argv[1] << std::endl;
+      return EXIT_FAILURE;
+    }
+    WriteJSON(output, results);
+  }
+  else
+  {
+    WriteJSON(std::cout, results);
+  }
+  // The other results are still written
+  return propagated ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,221 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Checks the pose shared memory: writer threads publish poses whose matrix
+// elements all equal the publication count, while reader threads, using
+// their own read-only mappings as another process would, check that they
+// never read a partially written pose.
+//
+// With an argument, the test instead reads the given segment, as exported
+// by vtkSlicerIMSTKLogic::startPoseExport(), and prints its poses:
+//   vtkSlicerIMSTKPoseSharedMemoryTest /SlicerIMSTKPoses
+
+// IMSTK Logic includes
+#include "vtkSlicerIMSTKPoseSharedMemory.h"
+
+// STD includes
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace
+{
+//----------------------------------------------------------------------------
+int PrintPoses(const std::string& name)
+{
+  vtkSlicerIMSTKPoseSharedMemory poses;
+  if (!poses.Open(name))
+  {
+    std::cerr << "Cannot open " << name << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < poses.GetNumberOfPoses(); i++)
+  {
+    vtkSlicerIMSTKPoseSharedMemory::Pose pose;
+    poses.Read(i, pose);
+    std::cout << pose.Name << " (" << pose.Count << " publications, t = " << pose.Timestamp << " ns):";
+    for (int e = 0; e < 16; e++)
+    {
+      std::cout << (e % 4 == 0 ? "\n  " : " ") << pose.Matrix[e];
+    }
+    std::cout << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool IsConsistent(const vtkSlicerIMSTKPoseSharedMemory::Pose& pose)
+{
+  // Not published yet
+  if (pose.Count == 0)
+  {
+    return pose.Timestamp == 0 && pose.Matrix[0] == 1.0 && pose.Matrix[1] == 0.0;
+  }
+  for (int e = 0; e < 16; e++)
+  {
+    if (pose.Matrix[e] != static_cast<double>(pose.Count))
+    {
+      return false;
+    }
+  }
+  return pose.Timestamp == static_cast<std::int64_t>(pose.Count);
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKPoseSharedMemoryTest(int argc, char* argv[])
+{
+  if (argc > 1)
+  {
+    return PrintPoses(argv[1]);
+  }
+#ifdef _WIN32
+  std::cout << "Shared memory poses are not supported on this platform" << std::endl;
+  return EXIT_SUCCESS;
+#else
+  const std::string name = "/vtkSlicerIMSTKPoseSharedMemoryTest" + std::to_string(getpid());
+  const int numberOfPoses = 4;
+  const std::uint64_t numberOfPublications = 1000000;
+
+  vtkSlicerIMSTKPoseSharedMemory writer;
+  if (!writer.Create(name, numberOfPoses))
+  {
+    std::cerr << "Cannot create " << name << std::endl;
+    return EXIT_FAILURE;
+  }
+  // The last pose has the same name as the second one, as poses of two
+  // simulations would, but its own slot and writer
+  std::vector<int> indices;
+  for (int i = 0; i < numberOfPoses; i++)
+  {
+    indices.push_back(writer.AddPose("Pose" + std::to_string(i < numberOfPoses - 1 ? i : 1)));
+  }
+  if (indices[numberOfPoses - 1] == indices[1] || writer.AddPose("Extra") != -1)
+  {
+    std::cerr << "AddPose must add a slot for each pose and fail when full" << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSlicerIMSTKPoseSharedMemory unnamed;
+  if (unnamed.Create(name + "Unnamed", 1) && unnamed.AddPose("") != -1)
+  {
+    std::cerr << "AddPose must reject empty names" << std::endl;
+    return EXIT_FAILURE;
+  }
+  unnamed.Unlink();
+
+  vtkSlicerIMSTKPoseSharedMemory reader;
+  if (!reader.Open(name) || reader.GetNumberOfPoses() != numberOfPoses
+    || reader.FindPose("Pose2") != indices[2] || reader.FindPose("Pose1") != indices[1]
+    || reader.FindPose("Pose") != -1
+    || reader.AddPose("Other") != -1)
+  {
+    std::cerr << "Reader does not see the poses of the writer" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::atomic<bool> writing(true);
+  std::atomic<int> tornReads(0);
+  std::atomic<int> backwardReads(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 2; r++)
+  {
+    readers.emplace_back(
+      [&name, &writing, &tornReads, &backwardReads, numberOfPoses]()
+      {
+        vtkSlicerIMSTKPoseSharedMemory poses;
+        poses.Open(name);
+        std::vector<std::uint64_t> lastCounts(numberOfPoses, 0);
+        vtkSlicerIMSTKPoseSharedMemory::Pose pose;
+        while (writing.load())
+        {
+          for (int i = 0; i < numberOfPoses; i++)
+          {
+            poses.Read(i, pose);
+            if (!IsConsistent(pose))
+            {
+              tornReads++;
+            }
+            if (pose.Count < lastCounts[i])
+            {
+              backwardReads++;
+            }
+            lastCounts[i] = pose.Count;
+          }
+        }
+      });
+  }
+
+  // One writer per pose, as the physics and haptics lanes would
+  std::vector<std::thread> writers;
+  for (int i = 0; i < numberOfPoses; i++)
+  {
+    const int index = indices[i];
+    writers.emplace_back(
+      [&writer, index, numberOfPublications]()
+      {
+        double matrix[16];
+        for (std::uint64_t count = 1; count <= numberOfPublications; count++)
+        {
+          for (int e = 0; e < 16; e++)
+          {
+            matrix[e] = static_cast<double>(count);
+          }
+          writer.Publish(index, matrix, vtkSlicerIMSTKPoseSharedMemory::ClockType::time_point(
+            std::chrono::nanoseconds(count)));
+        }
+      });
+  }
+  for (std::thread& thread : writers)
+  {
+    thread.join();
+  }
+  writing.store(false);
+  for (std::thread& thread : readers)
+  {
+    thread.join();
+  }
+
+  writer.Unlink();
+  vtkSlicerIMSTKPoseSharedMemory unlinked;
+  if (unlinked.Open(name))
+  {
+    std::cerr << "Segment still opened after Unlink()" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkSlicerIMSTKPoseSharedMemory::Pose pose;
+  if (!reader.Read(indices[3], pose) || pose.Count != numberOfPublications || !IsConsistent(pose)
+    || std::string(pose.Name) != "Pose1" || reader.Read(numberOfPoses, pose))
+  {
+    std::cerr << "Unexpected final pose" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (tornReads.load() != 0 || backwardReads.load() != 0)
+  {
+    std::cerr << tornReads.load() << " torn reads, " << backwardReads.load() << " reads going back in time" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+#endif
+}
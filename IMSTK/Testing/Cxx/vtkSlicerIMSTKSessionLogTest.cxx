@@ -0,0 +1,241 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Checks the session logs: device poses written to the file given as
+// argument load back with their times and values, and are interpolated in
+// between. A copy of the file taken while it is still being written, as
+// left by an application that stopped before closing the log, loads back
+// too. The replay client follows the log in simulation time.
+
+// IMSTK Logic includes
+#include "vtkSlicerIMSTKReplayDeviceClient.h"
+#include "vtkSlicerIMSTKSessionLog.h"
+
+// STD includes
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace
+{
+const int NumberOfPoses = 11;
+const double Period = 0.01;
+const double Pi = 3.14159265358979323846;
+
+//----------------------------------------------------------------------------
+/// Recorded pose \a i: moves along x and turns by up to 90 degrees around z
+void GetPose(int i, std::array<double, 3>& position, std::array<double, 4>& orientation)
+{
+  const double angle = 0.5 * Pi * i / (NumberOfPoses - 1);
+  position = { { 10.0 * i, 1.0, -1.0 } };
+  orientation = { { std::cos(0.5 * angle), 0.0, 0.0, std::sin(0.5 * angle) } };
+}
+
+//----------------------------------------------------------------------------
+/// Write the poses to \a log, \a numberOfPoses of them
+void RecordPoses(vtkSlicerIMSTKSessionLog& log, int numberOfPoses)
+{
+  typedef vtkSlicerIMSTKSessionLog::ClockType ClockType;
+  const ClockType::time_point start = ClockType::now();
+  ClockType::time_point time = start;
+  for (int i = 0; i < numberOfPoses; i++)
+  {
+    std::array<double, 3> position;
+    std::array<double, 4> orientation;
+    GetPose(i, position, orientation);
+    time = start + std::chrono::duration_cast<ClockType::duration>(std::chrono::duration<double>(i * Period));
+    log.RecordDevicePose(0, time, position, orientation);
+  }
+  // Other records are skipped by the replay
+  const double transform[16] = { 1., 0., 0., 0., 0., 1., 0., 0., 0., 0., 1., 0., 0., 0., 0., 1. };
+  log.Record(vtkSlicerIMSTKSessionLog::TransformRecord, 0, time, transform, 16);
+}
+
+//----------------------------------------------------------------------------
+bool IsClose(double a, double b)
+{
+  return std::abs(a - b) < 1e-6;
+}
+
+//----------------------------------------------------------------------------
+/// Check the poses of \a log, that must hold \a numberOfPoses poses
+bool CheckPoses(const vtkSlicerIMSTKSessionLog& log, int numberOfPoses)
+{
+  if (log.GetNumberOfRecords() != static_cast<std::size_t>(numberOfPoses + 1))
+  {
+    std::cerr << log.GetNumberOfRecords() << " records instead of " << numberOfPoses + 1 << std::endl;
+    return false;
+  }
+  // Times are relative to the start of the recording, not to the first pose
+  const double start = log.GetRecord(0).Time * 1e-9;
+  for (int i = 0; i < numberOfPoses; i++)
+  {
+    std::array<double, 3> expectedPosition;
+    std::array<double, 4> expectedOrientation;
+    GetPose(i, expectedPosition, expectedOrientation);
+    const double* values = log.GetValues(i);
+    if (log.GetRecord(i).Type != vtkSlicerIMSTKSessionLog::DevicePoseRecord
+      || log.GetRecord(i).NumberOfValues != 7
+      || !IsClose(log.GetRecord(i).Time * 1e-9 - start, i * Period)
+      || values[0] != expectedPosition[0] || values[6] != expectedOrientation[3])
+    {
+      std::cerr << "Unexpected record " << i << std::endl;
+      return false;
+    }
+  }
+  if (log.GetRecord(numberOfPoses).Type != vtkSlicerIMSTKSessionLog::TransformRecord)
+  {
+    std::cerr << "Missing transform record" << std::endl;
+    return false;
+  }
+
+  // Halfway between two poses, and before and after the recording
+  std::array<double, 3> position;
+  std::array<double, 4> orientation;
+  std::array<double, 3> position0;
+  std::array<double, 4> orientation0;
+  std::array<double, 3> position1;
+  std::array<double, 4> orientation1;
+  GetPose(0, position0, orientation0);
+  GetPose(1, position1, orientation1);
+  const double halfAngle = 0.25 * (0.5 * Pi / (NumberOfPoses - 1));
+  if (!log.GetDevicePose(0, start + 0.5 * Period, position, orientation)
+    || !IsClose(position[0], 0.5 * (position0[0] + position1[0])) || !IsClose(position[1], 1.0)
+    || !IsClose(orientation[0], std::cos(halfAngle)) || !IsClose(orientation[3], std::sin(halfAngle)))
+  {
+    std::cerr << "Wrong interpolated pose: " << position[0] << " " << orientation[0] << " " << orientation[3]
+      << std::endl;
+    return false;
+  }
+  std::array<double, 3> lastPosition;
+  std::array<double, 4> lastOrientation;
+  GetPose(numberOfPoses - 1, lastPosition, lastOrientation);
+  if (!log.GetDevicePose(0, -1.0, position, orientation) || position != position0
+    || !log.GetDevicePose(0, start + numberOfPoses * Period, position, orientation) || position != lastPosition)
+  {
+    std::cerr << "Wrong pose outside of the recording" << std::endl;
+    return false;
+  }
+  if (log.GetDevicePose(1, start, position, orientation))
+  {
+    std::cerr << "Pose of a device that was not recorded" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool CopyFile(const std::string& source, const std::string& destination)
+{
+  std::ifstream input(source, std::ios::binary);
+  std::ofstream output(destination, std::ios::binary | std::ios::trunc);
+  output << input.rdbuf();
+  return input.good() && output.good();
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKSessionLogTest(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: vtkSlicerIMSTKSessionLogTest <log file>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string fileName = argv[1];
+  const std::string unclosedFileName = fileName + ".unclosed";
+
+  // Closed log
+  {
+    vtkSlicerIMSTKSessionLog log;
+    if (!log.StartRecording(fileName))
+    {
+      std::cerr << "Cannot write " << fileName << std::endl;
+      return EXIT_FAILURE;
+    }
+    RecordPoses(log, NumberOfPoses);
+    log.StopRecording();
+  }
+  auto log = std::make_shared<vtkSlicerIMSTKSessionLog>();
+  if (!log->Load(fileName) || !CheckPoses(*log, NumberOfPoses))
+  {
+    std::cerr << "Closed log " << fileName << " does not load back" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Unclosed log, copied while being written
+  {
+    vtkSlicerIMSTKSessionLog writer;
+    if (!writer.StartRecording(fileName + ".writing"))
+    {
+      std::cerr << "Cannot write " << fileName << ".writing" << std::endl;
+      return EXIT_FAILURE;
+    }
+    RecordPoses(writer, NumberOfPoses);
+    const bool copied = CopyFile(fileName + ".writing", unclosedFileName);
+    writer.StopRecording();
+    vtkSlicerIMSTKSessionLog unclosed;
+    if (!copied || !unclosed.Load(unclosedFileName) || !CheckPoses(unclosed, NumberOfPoses))
+    {
+      std::cerr << "Unclosed log " << unclosedFileName << " does not load back" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Replay in simulation time: the first step replays the beginning of the
+  // log, then each step moves forward by its time step
+  vtkSlicerIMSTKReplayDeviceClient client(log);
+  client.SetRealTime(false);
+  const double dt = 0.25 * Period;
+  const double start = log->GetRecord(0).Time * 1e-9;
+  for (int step = 0; !client.IsFinished(); step++)
+  {
+    client.Advance(dt);
+    if (!IsClose(client.GetTime(), step * dt))
+    {
+      std::cerr << "Replay time " << client.GetTime() << " at step " << step << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::array<double, 3> position;
+    std::array<double, 4> orientation;
+    log->GetDevicePose(0, client.GetTime(), position, orientation);
+    const imstk::Vec3d clientPosition = client.getPosition();
+    if (!IsClose(clientPosition[0], position[0]) || !IsClose(client.getOrientation().w(), orientation[0]))
+    {
+      std::cerr << "Replayed pose differs from the log at step " << step << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (step > 4 * NumberOfPoses + static_cast<int>(start / dt) + 1)
+    {
+      std::cerr << "Replay does not finish" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  client.Rewind();
+  client.Advance(dt);
+  if (client.GetTime() != 0.0 || client.IsFinished())
+  {
+    std::cerr << "Rewind does not restart the replay" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
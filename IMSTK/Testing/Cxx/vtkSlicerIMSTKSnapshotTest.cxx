@@ -0,0 +1,159 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Checks the snapshots: records added to the memory reserved by Clear() do
+// not move it, and a snapshot written to the file given as argument loads
+// back with the same records, read from the mapping. Truncated, corrupted
+// and foreign files are rejected.
+
+// IMSTK Logic includes
+#include "vtkSlicerIMSTKSnapshot.h"
+
+// STD includes
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+//----------------------------------------------------------------------------
+/// Value i of the record of \a stream
+double Value(int stream, std::uint32_t i)
+{
+  return stream * 1000.0 + i + 0.5;
+}
+
+//----------------------------------------------------------------------------
+bool WritePrefix(const std::string& fileName, const vtkSlicerIMSTKSnapshot& snapshot, std::size_t size)
+{
+  std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+  file.write(snapshot.GetData(), static_cast<std::streamsize>(size));
+  return file.good();
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerIMSTKSnapshotTest(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: vtkSlicerIMSTKSnapshotTest <snapshot file>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string fileName = argv[1];
+  const int numberOfObjects = 8;
+  const std::uint32_t numberOfVertices = 1000;
+
+  vtkSlicerIMSTKSnapshot snapshot;
+  snapshot.Clear(2 * numberOfObjects, numberOfObjects * (16 + 3 * numberOfVertices));
+  const char* data = snapshot.GetData();
+  for (int stream = 0; stream < numberOfObjects; stream++)
+  {
+    double* transform = snapshot.AddRecord(vtkSlicerIMSTKSnapshot::TransformRecord, stream, 16);
+    for (std::uint32_t i = 0; i < 16; i++)
+    {
+      transform[i] = Value(stream, i);
+    }
+    double* vertices = snapshot.AddRecord(vtkSlicerIMSTKSnapshot::VerticesRecord, stream, 3 * numberOfVertices);
+    for (std::uint32_t i = 0; i < 3 * numberOfVertices; i++)
+    {
+      vertices[i] = Value(stream, i);
+    }
+  }
+  if (snapshot.GetData() != data)
+  {
+    std::cerr << "Adding the reserved records reallocated the snapshot" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!snapshot.Write(fileName))
+  {
+    std::cerr << "Cannot write " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  vtkSlicerIMSTKSnapshot loaded;
+  if (!loaded.Load(fileName) || loaded.GetSize() != snapshot.GetSize()
+    || loaded.GetNumberOfRecords() != snapshot.GetNumberOfRecords())
+  {
+    std::cerr << "Cannot load " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int stream = 0; stream < numberOfObjects; stream++)
+  {
+    const int index = loaded.FindRecord(vtkSlicerIMSTKSnapshot::VerticesRecord, stream);
+    if (index < 0 || loaded.GetRecord(index).NumberOfValues != 3 * numberOfVertices)
+    {
+      std::cerr << "Missing vertices of object " << stream << std::endl;
+      return EXIT_FAILURE;
+    }
+    const double* vertices = loaded.GetValues(index);
+    for (std::uint32_t i = 0; i < 3 * numberOfVertices; i++)
+    {
+      if (vertices[i] != Value(stream, i))
+      {
+        std::cerr << "Unexpected vertex value " << i << " of object " << stream << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  if (loaded.FindRecord(vtkSlicerIMSTKSnapshot::RigidBodyRecord, 0) != -1
+    || loaded.FindRecord(vtkSlicerIMSTKSnapshot::TransformRecord, numberOfObjects) != -1)
+  {
+    std::cerr << "Found records that were not added" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Adding to a loaded snapshot starts a new one in memory
+  loaded.AddRecord(vtkSlicerIMSTKSnapshot::ControllerRecord, 0, 8);
+  if (loaded.GetNumberOfRecords() != 1
+    || loaded.GetSize() != vtkSlicerIMSTKSnapshot::HeaderSize + sizeof(vtkSlicerIMSTKSnapshot::RecordHeader) + 8 * sizeof(double))
+  {
+    std::cerr << "Unexpected snapshot after adding to a loaded one" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Truncated snapshot, then a file that is not a snapshot
+  if (!WritePrefix(fileName, snapshot, snapshot.GetSize() - 8) || loaded.Load(fileName)
+    || loaded.GetNumberOfRecords() != 0)
+  {
+    std::cerr << "Truncated snapshot loaded" << std::endl;
+    return EXIT_FAILURE;
+  }
+  // Header size past the end of the file
+  vtkSlicerIMSTKSnapshot corrupted;
+  corrupted.Clear();
+  const std::uint32_t headerSize = 1 << 20;
+  const char* header = corrupted.GetData();
+  std::string bytes(header, vtkSlicerIMSTKSnapshot::HeaderSize);
+  std::memcpy(&bytes[12], &headerSize, sizeof(headerSize));
+  std::ofstream(fileName, std::ios::binary | std::ios::trunc) << bytes;
+  if (loaded.Load(fileName) || loaded.GetNumberOfRecords() != 0)
+  {
+    std::cerr << "Snapshot with a header larger than the file loaded" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string text = "IMSTKLOG and some other content, long enough for a header";
+  std::ofstream(fileName, std::ios::binary | std::ios::trunc) << text;
+  if (loaded.Load(fileName))
+  {
+    std::cerr << "Foreign file loaded" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -15,6 +15,9 @@
 
 ==============================================================================*/
 
+// Qt includes
+#include <QTimer>
+
 // IMSTK Logic includes
 #include <vtkSlicerIMSTKLogic.h>
 
@@ -27,6 +30,9 @@ class qSlicerIMSTKModulePrivate
 {
 public:
   qSlicerIMSTKModulePrivate();
+
+  /// Drains the poses published by the simulation threads into MRML
+  QTimer SyncTimer;
 };
 
 //-----------------------------------------------------------------------------
@@ -93,7 +99,24 @@ QStringList qSlicerIMSTKModule::dependencies() const
 //-----------------------------------------------------------------------------
 void qSlicerIMSTKModule::setup()
 {
+  Q_D(qSlicerIMSTKModule);
   this->Superclass::setup();
+
+  // Simulation threads never modify MRML nodes, synchronize at display rate
+  // from the main thread instead.
+  d->SyncTimer.setInterval(16);
+  QObject::connect(&d->SyncTimer, SIGNAL(timeout()), this, SLOT(onSyncTimerTimeout()));
+  d->SyncTimer.start();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerIMSTKModule::onSyncTimerTimeout()
+{
+  vtkSlicerIMSTKLogic* logic = vtkSlicerIMSTKLogic::SafeDownCast(this->logic());
+  if (logic)
+  {
+    logic->processPendingUpdates();
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -51,6 +51,11 @@ public:
   QStringList categories()const override;
   QStringList dependencies() const override;
 
+protected slots:
+
+  /// Apply to MRML the latest state published by the running simulations
+  void onSyncTimerTimeout();
+
 protected:
 
   /// Initialize the module. Register the volumes reader/writer
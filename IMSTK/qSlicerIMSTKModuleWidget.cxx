@@ -23,6 +23,7 @@
 #include "vtkMRMLModelNode.h"
 #include "vtkMRMLLinearTransformNode.h"
 #include "vtkMRMLModelDisplayNode.h"
+#include "vtkMRMLScene.h"
 #include "vtkMRMLTransformDisplayNode.h"
 
 // Slicer includes
@@ -85,6 +86,9 @@ void qSlicerIMSTKModuleWidget::setup()
   this->connect(d->HapticApplyButton, SIGNAL(clicked()), this, SLOT(onHapticApplyButton()));
   this->connect(d->RigidStopButton, SIGNAL(clicked()), this, SLOT(onRigidStopButton()));
   this->connect(d->HapticStopButton, SIGNAL(clicked()), this, SLOT(onHapticStopButton()));
+  this->connect(d->SceneApplyButton, SIGNAL(clicked()), this, SLOT(onSceneApplyButton()));
+  this->connect(d->SceneStopButton, SIGNAL(clicked()), this, SLOT(onSceneStopButton()));
+  this->connect(d->SceneRestartButton, SIGNAL(clicked()), this, SLOT(onSceneRestartButton()));
   this->connect(d->RigidBodyInputModelComboBox, SIGNAL(currentNodeChanged(vtkMRMLNode*)),this, SLOT(onRigidBodyInputsChanged(vtkMRMLNode*)));
   this->connect(d->RigidBodyOutputModelComboBox, SIGNAL(currentNodeChanged(vtkMRMLNode*)), this, SLOT(onRigidBodyInputsChanged(vtkMRMLNode*)));
   this->connect(d->RigidBodyOutputTransformComboBox, SIGNAL(currentNodeChanged(vtkMRMLNode*)), this, SLOT(onRigidBodyInputsChanged(vtkMRMLNode*)));
@@ -94,6 +98,8 @@ void qSlicerIMSTKModuleWidget::setup()
   d->HapticApplyButton->setEnabled(false);
   d->HapticStopButton->setEnabled(false);
   d->RigidStopButton->setEnabled(false);
+  d->SceneStopButton->setEnabled(false);
+  d->SceneRestartButton->setEnabled(false);
 }
 
 //-----------------------------------------------------------------------------
@@ -125,12 +131,39 @@ void qSlicerIMSTKModuleWidget::onHapticApplyButton()
   d->HapticStopButton->setEnabled(true);
   d->HapticApplyButton->setEnabled(false);
 
-  auto transform = vtkMRMLLinearTransformNode::SafeDownCast(d->HapticOutputTransformComboBox->currentNode());
-  transform->CreateDefaultDisplayNodes();
-  auto disp = vtkMRMLTransformDisplayNode::SafeDownCast(transform->GetDisplayNode());
-  disp->SetEditorVisibility(true);
-
-  d->logic()->runHapticDeviceExample("HapticDevice",d->HapticDeviceNameLineEdit->text().toStdString(), transform);
+  // Several devices can be given, separated by commas. The first one moves
+  // the selected transform, the others the transforms named after them.
+  std::vector<std::string> deviceNames;
+  std::vector<vtkMRMLLinearTransformNode*> transforms;
+  foreach (const QString& deviceName, d->HapticDeviceNameLineEdit->text().split(','))
+  {
+    if (deviceName.trimmed().isEmpty())
+    {
+      continue;
+    }
+    vtkMRMLLinearTransformNode* transform = nullptr;
+    if (transforms.empty())
+    {
+      transform = vtkMRMLLinearTransformNode::SafeDownCast(d->HapticOutputTransformComboBox->currentNode());
+    }
+    else
+    {
+      const std::string transformName = deviceName.trimmed().toStdString() + "Transform";
+      transform = vtkMRMLLinearTransformNode::SafeDownCast(this->mrmlScene()->GetFirstNodeByName(transformName.c_str()));
+      if (!transform)
+      {
+        transform = vtkMRMLLinearTransformNode::SafeDownCast(
+          this->mrmlScene()->AddNewNodeByClass("vtkMRMLLinearTransformNode", transformName));
+      }
+    }
+    transform->CreateDefaultDisplayNodes();
+    auto disp = vtkMRMLTransformDisplayNode::SafeDownCast(transform->GetDisplayNode());
+    disp->SetEditorVisibility(true);
+    deviceNames.push_back(deviceName.trimmed().toStdString());
+    transforms.push_back(transform);
+  }
+
+  d->logic()->runHapticDevicesExample("HapticDevice", deviceNames, transforms);
 }
 
 //-----------------------------------------------------------------------------
@@ -152,6 +185,37 @@ void qSlicerIMSTKModuleWidget::onHapticStopButton()
   this->onHapticInputsChanged(nullptr);
 }
 
+//-----------------------------------------------------------------------------
+void qSlicerIMSTKModuleWidget::onSceneApplyButton()
+{
+  Q_D(qSlicerIMSTKModuleWidget);
+  d->logic()->buildSceneFromMRML("Scene");
+  d->SceneApplyButton->setEnabled(false);
+  d->SceneStopButton->setEnabled(true);
+  d->SceneRestartButton->setEnabled(false);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerIMSTKModuleWidget::onSceneStopButton()
+{
+  Q_D(qSlicerIMSTKModuleWidget);
+  d->logic()->stopSimulation("Scene");
+  d->SceneApplyButton->setEnabled(true);
+  d->SceneStopButton->setEnabled(false);
+  d->SceneRestartButton->setEnabled(
+    d->logic()->getSimulationState("Scene") == vtkSlicerIMSTKLogic::SimulationStopped);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerIMSTKModuleWidget::onSceneRestartButton()
+{
+  Q_D(qSlicerIMSTKModuleWidget);
+  d->logic()->startSimulation("Scene");
+  d->SceneApplyButton->setEnabled(false);
+  d->SceneStopButton->setEnabled(true);
+  d->SceneRestartButton->setEnabled(false);
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerIMSTKModuleWidget::onRigidBodyInputsChanged(vtkMRMLNode* unused)
 {
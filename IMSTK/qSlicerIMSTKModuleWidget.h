@@ -44,6 +44,9 @@ public slots:
   void onHapticApplyButton();
   void onRigidStopButton();
   void onHapticStopButton();
+  void onSceneApplyButton();
+  void onSceneStopButton();
+  void onSceneRestartButton();
   void onRigidBodyInputsChanged(vtkMRMLNode* node);
   void onHapticInputsChanged(vtkMRMLNode* node);
 